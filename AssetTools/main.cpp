@@ -0,0 +1,1154 @@
+#include "stdafx.h"
+#include "AssetArchive.h"
+#include "ImageFile.h"
+#include "PipelineStateHash.h"
+#include "ResourceStateTracker.h"
+#include "RootSignatureCache.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "SubresourceCopy.h"
+#include "UploadEngine.h"
+#include <chrono>
+#include <functional>
+
+// Offline asset tools.
+//
+//   AssetTools pack <archive> <sourceDir> [-align 512|65536] [-compress]
+//   AssetTools list <archive>
+//   AssetTools bench <archive> [-iterations n] [-upload]
+//   AssetTools coldbench <archive> <sourceDir> [-iterations n]
+//   AssetTools copybench [-width n] [-height n] [-slices n] [-iterations n]
+//   AssetTools psobench [-pipelines n] [-iterations n]
+//   AssetTools rootsigbench [-signatures n] [-iterations n]
+//   AssetTools barrierbench [-frames n]
+//   AssetTools reloadbench [-iterations n]
+//   AssetTools precompile <cacheDir> <source.hlsl> <entry:target>... [-D name[=value]] [-debug]
+//              (every permutation of the keywords the source declares)
+//   AssetTools imgdiff <expected.ppm> <actual.ppm> [-tolerance n] [-maxDiffPixels n] [-diff out.ppm]
+
+// Command line arguments are ASCII in practice, shader names and defines too.
+static std::string WStringToAnsi(const std::wstring& str)
+{
+    std::string ansi;
+    for (WCHAR c : str)
+    {
+        ansi += static_cast<char>(c);
+    }
+    return ansi;
+}
+
+static void GatherFiles(const std::wstring& directory, const std::wstring& prefix, std::vector<std::wstring>& names)
+{
+    WIN32_FIND_DATAW findData;
+    HANDLE find = FindFirstFileW((directory + L"\\*").c_str(), &findData);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    do
+    {
+        const std::wstring name = findData.cFileName;
+        if (name == L"." || name == L"..")
+        {
+            continue;
+        }
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            GatherFiles(directory + L"\\" + name, prefix + name + L"/", names);
+        }
+        else
+        {
+            names.push_back(prefix + name);
+        }
+    } while (FindNextFileW(find, &findData));
+    FindClose(find);
+}
+
+static int Pack(int argc, wchar_t* argv[])
+{
+    if (argc < 4)
+    {
+        wprintf(L"usage: AssetTools pack <archive> <sourceDir> [-align 512|65536] [-compress]\n");
+        return 1;
+    }
+
+    const std::wstring archivePath = argv[2];
+    const std::wstring sourceDir = argv[3];
+    UINT64 alignment = AssetArchiveWriter::DefaultPayloadAlignment;
+    bool compress = false;
+    for (int i = 4; i < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-align") == 0 && i + 1 < argc)
+        {
+            alignment = _wcstoui64(argv[++i], nullptr, 10);
+        }
+        else if (wcscmp(argv[i], L"-compress") == 0)
+        {
+            compress = true;
+        }
+    }
+
+    std::vector<std::wstring> names;
+    GatherFiles(sourceDir, L"", names);
+    std::sort(names.begin(), names.end());
+
+    AssetArchiveWriter writer;
+    for (const std::wstring& name : names)
+    {
+        std::wstring filename = sourceDir + L"\\" + name;
+        std::replace(filename.begin(), filename.end(), L'/', L'\\');
+        writer.AddFile(name, filename);
+    }
+    writer.Write(archivePath, alignment, compress);
+
+    wprintf(L"packed %u assets into %s (%llu byte alignment)\n", static_cast<UINT>(names.size()), archivePath.c_str(), alignment);
+    return 0;
+}
+
+static int List(int argc, wchar_t* argv[])
+{
+    if (argc < 3)
+    {
+        wprintf(L"usage: AssetTools list <archive>\n");
+        return 1;
+    }
+
+    AssetArchive archive(argv[2]);
+    for (UINT i = 0; i < archive.GetEntryCount(); i++)
+    {
+        const AssetArchiveEntry& entry = archive.GetEntry(i);
+        wprintf(L"%016llx %12llu %12llu %12llu %s\n", entry.NameHash, entry.Offset, entry.Size, entry.StoredSize, archive.GetName(entry).c_str());
+    }
+    return 0;
+}
+
+// Default adapter, WARP if there is no hardware one.
+static ComPtr<ID3D12Device> CreateBenchDevice()
+{
+    ComPtr<ID3D12Device> device;
+    if (FAILED(D3D12CreateDevice(nullptr, D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device))))
+    {
+        ComPtr<IDXGIFactory4> factory;
+        ComPtr<IDXGIAdapter> warpAdapter;
+        ThrowIfFailed(CreateDXGIFactory1(IID_PPV_ARGS(&factory)));
+        ThrowIfFailed(factory->EnumWarpAdapter(IID_PPV_ARGS(&warpAdapter)));
+        ThrowIfFailed(D3D12CreateDevice(warpAdapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&device)));
+    }
+    return device;
+}
+
+// Time to get every compressed asset into upload memory on all cores:
+// decoded straight into the mapped staging buffer, against decoded on the
+// heap and copied in. Includes creating the staging buffers, which both pay.
+static void BenchUpload(const AssetArchive& archive, ThreadPool& pool, UINT iterations)
+{
+    ComPtr<ID3D12Device> device = CreateBenchDevice();
+    UploadEngine engine(device.Get(), &pool);
+
+    UINT64 decodedBytes = 0;
+    double directSeconds = 0.0;
+    double heapSeconds = 0.0;
+    std::vector<BYTE> decoded;
+    for (UINT i = 0; i < archive.GetEntryCount(); i++)
+    {
+        const AssetArchiveEntry& entry = archive.GetEntry(i);
+        if (!AssetArchive::IsCompressed(entry))
+        {
+            continue;
+        }
+        ComPtr<ID3D12Resource> buffer = CreateDefaultBufferResource(device.Get(), entry.Size, L"BenchBuffer");
+        for (UINT n = 0; n < iterations; n++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            engine.EnqueueAssetUpload(buffer.Get(), 0, archive, entry);
+            auto middle = std::chrono::steady_clock::now();
+            decoded.resize(static_cast<size_t>(entry.Size));
+            archive.Decode(entry, decoded.data(), &pool);
+            const UploadTicket ticket = engine.EnqueueBufferUpload(buffer.Get(), 0, decoded.data(), entry.Size);
+            auto end = std::chrono::steady_clock::now();
+            std::vector<BYTE>().swap(decoded);
+
+            directSeconds += std::chrono::duration<double>(middle - start).count();
+            heapSeconds += std::chrono::duration<double>(end - middle).count();
+
+            // Keep staging memory bounded, outside the measurement.
+            engine.WaitOnCpu(ticket);
+            engine.RetireCompletedUploads();
+        }
+        decodedBytes += entry.Size * iterations;
+    }
+
+    const double megabytes = decodedBytes / (1024.0 * 1024.0);
+    wprintf(L"upload direct   %.1f MB/s\n", megabytes / directSeconds);
+    wprintf(L"upload via heap %.1f MB/s\n", megabytes / heapSeconds);
+}
+
+// Decode throughput of the compressed assets, on one core and on all of them.
+static int Bench(int argc, wchar_t* argv[])
+{
+    if (argc < 3)
+    {
+        wprintf(L"usage: AssetTools bench <archive> [-iterations n] [-upload]\n");
+        return 1;
+    }
+
+    UINT iterations = 10;
+    bool upload = false;
+    for (int i = 3; i < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (wcscmp(argv[i], L"-upload") == 0)
+        {
+            upload = true;
+        }
+    }
+
+    AssetArchive archive(argv[2]);
+    ThreadPool pool;
+    const UINT cores = pool.GetThreadCount() + 1;
+
+    UINT64 decodedBytes = 0;
+    UINT64 storedBytes = 0;
+    double serialSeconds = 0.0;
+    double parallelSeconds = 0.0;
+    std::vector<BYTE> destination;
+    for (UINT i = 0; i < archive.GetEntryCount(); i++)
+    {
+        const AssetArchiveEntry& entry = archive.GetEntry(i);
+        if (!AssetArchive::IsCompressed(entry))
+        {
+            continue;
+        }
+        destination.resize(static_cast<size_t>(entry.Size));
+
+        // Warm the mapping so the disk is not part of the measurement.
+        archive.Decode(entry, destination.data());
+
+        auto start = std::chrono::steady_clock::now();
+        for (UINT n = 0; n < iterations; n++)
+        {
+            archive.Decode(entry, destination.data());
+        }
+        auto middle = std::chrono::steady_clock::now();
+        for (UINT n = 0; n < iterations; n++)
+        {
+            archive.Decode(entry, destination.data(), &pool);
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        serialSeconds += std::chrono::duration<double>(middle - start).count();
+        parallelSeconds += std::chrono::duration<double>(end - middle).count();
+        decodedBytes += entry.Size * iterations;
+        storedBytes += entry.StoredSize * iterations;
+    }
+
+    if (decodedBytes == 0)
+    {
+        wprintf(L"no compressed assets in %s\n", argv[2]);
+        return 0;
+    }
+
+    const double megabytes = decodedBytes / (1024.0 * 1024.0);
+    wprintf(L"ratio           %.3f\n", static_cast<double>(storedBytes) / decodedBytes);
+    wprintf(L"1 core          %.1f MB/s\n", megabytes / serialSeconds);
+    wprintf(L"%u cores        %.1f MB/s (%.1f MB/s per core)\n", cores, megabytes / parallelSeconds, megabytes / parallelSeconds / cores);
+    if (upload)
+    {
+        BenchUpload(archive, pool, iterations);
+    }
+    return 0;
+}
+
+// Drops the file from the system cache, so the next read goes to the disk.
+// Opening a file unbuffered purges its cached pages when nothing else has it
+// mapped. Best effort, pages of other processes' mappings stay resident.
+static void EvictFromCache(const std::wstring& filename)
+{
+    CREATEFILE2_EXTENDED_PARAMETERS extendedParams = {};
+    extendedParams.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+    extendedParams.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+    extendedParams.dwFileFlags = FILE_FLAG_NO_BUFFERING;
+    HANDLE file = CreateFile2(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &extendedParams);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+    }
+}
+
+// Reads every page of data the way AsyncIoService does for mapped assets.
+static UINT TouchPages(const ByteSpan& data)
+{
+    volatile BYTE sink = 0;
+    for (UINT64 offset = 0; offset < data.Size; offset += 4096)
+    {
+        sink += data.Data[offset];
+    }
+    return sink;
+}
+
+// Cold start: every asset read from disk once, as loose files against the
+// packed archive built from the same directory. The cache is dropped before
+// each run, the best run counts.
+static int ColdBench(int argc, wchar_t* argv[])
+{
+    if (argc < 4)
+    {
+        wprintf(L"usage: AssetTools coldbench <archive> <sourceDir> [-iterations n]\n");
+        return 1;
+    }
+
+    const std::wstring archivePath = argv[2];
+    const std::wstring sourceDir = argv[3];
+    UINT iterations = 5;
+    for (int i = 4; i + 1 < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-iterations") == 0)
+        {
+            iterations = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    std::vector<std::wstring> names;
+    GatherFiles(sourceDir, L"", names);
+    std::sort(names.begin(), names.end());
+    std::vector<std::wstring> filenames;
+    for (const std::wstring& name : names)
+    {
+        std::wstring filename = sourceDir + L"\\" + name;
+        std::replace(filename.begin(), filename.end(), L'/', L'\\');
+        filenames.push_back(filename);
+    }
+
+    double looseSeconds = 1e30;
+    double archiveSeconds = 1e30;
+    UINT64 bytes = 0;
+    std::vector<BYTE> decoded;
+    for (UINT n = 0; n < iterations; n++)
+    {
+        for (const std::wstring& filename : filenames)
+        {
+            EvictFromCache(filename);
+        }
+        auto start = std::chrono::steady_clock::now();
+        bytes = 0;
+        for (const std::wstring& filename : filenames)
+        {
+            MappedFile file(filename);
+            TouchPages(file.GetSpan());
+            bytes += file.Size();
+        }
+        looseSeconds = std::min(looseSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+        EvictFromCache(archivePath);
+        start = std::chrono::steady_clock::now();
+        {
+            AssetArchive archive(archivePath);
+            for (const std::wstring& name : names)
+            {
+                const AssetArchiveEntry* entry = archive.Find(name.c_str());
+                if (!entry)
+                {
+                    wprintf(L"%s is not in %s\n", name.c_str(), archivePath.c_str());
+                    return 1;
+                }
+                if (AssetArchive::IsCompressed(*entry))
+                {
+                    decoded.resize(static_cast<size_t>(entry->Size));
+                    archive.Decode(*entry, decoded.data());
+                }
+                else
+                {
+                    TouchPages(archive.GetData(*entry));
+                }
+            }
+        }
+        archiveSeconds = std::min(archiveSeconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    const double megabytes = bytes / (1024.0 * 1024.0);
+    wprintf(L"assets          %u, %.1f MB\n", static_cast<UINT>(names.size()), megabytes);
+    wprintf(L"loose files     %.2f ms (%.1f MB/s)\n", looseSeconds * 1000.0, megabytes / looseSeconds);
+    wprintf(L"archive         %.2f ms (%.1f MB/s)\n", archiveSeconds * 1000.0, megabytes / archiveSeconds);
+    wprintf(L"speedup         %.2fx\n", looseSeconds / archiveSeconds);
+    return 0;
+}
+
+// CPU side of a texture array upload: UpdateSubresources from d3dx12.h
+// against UpdateSubresourcesParallel on one thread and on the pool. Only the
+// copies into the mapped upload buffer are timed, the commands are recorded
+// but never executed. A width whose rows are not a multiple of 256 bytes
+// exercises the row by row path, 4096 wide RGBA the contiguous one.
+static int CopyBench(int argc, wchar_t* argv[])
+{
+    UINT width = 4096;
+    UINT height = 4096;
+    UINT slices = 4;
+    UINT iterations = 5;
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-width") == 0)
+        {
+            width = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (wcscmp(argv[i], L"-height") == 0)
+        {
+            height = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (wcscmp(argv[i], L"-slices") == 0)
+        {
+            slices = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (wcscmp(argv[i], L"-iterations") == 0)
+        {
+            iterations = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    ComPtr<ID3D12Device> device = CreateBenchDevice();
+    ComPtr<ID3D12CommandAllocator> allocator;
+    ComPtr<ID3D12GraphicsCommandList> commandList;
+    ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+    ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+
+    const UINT pixelSize = 4;
+    ComPtr<ID3D12Resource> texture;
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, static_cast<UINT16>(height), static_cast<UINT16>(slices), 1),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&texture)));
+    const UINT64 intermediateSize = GetRequiredIntermediateSize(texture.Get(), 0, slices);
+    ComPtr<ID3D12Resource> intermediate;
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(intermediateSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&intermediate)));
+
+    const UINT64 sliceSize = UINT64(width) * height * pixelSize;
+    std::vector<BYTE> pixels(static_cast<size_t>(sliceSize * slices));
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        pixels[i] = static_cast<BYTE>(i * 7);
+    }
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources(slices);
+    for (UINT i = 0; i < slices; i++)
+    {
+        subresources[i].pData = pixels.data() + sliceSize * i;
+        subresources[i].RowPitch = width * pixelSize;
+        subresources[i].SlicePitch = static_cast<LONG_PTR>(sliceSize);
+    }
+
+    ThreadPool pool;
+    auto measure = [&](const std::function<UINT64()>& upload)
+    {
+        upload();   // Touch the upload buffer once.
+        double best = 1e30;
+        for (UINT n = 0; n < iterations; n++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (upload() == 0)
+            {
+                ThrowIfFailed(E_FAIL);
+            }
+            best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        return best;
+    };
+    const double d3dx12Seconds = measure([&]()
+    {
+        return UpdateSubresources(commandList.Get(), texture.Get(), intermediate.Get(), 0, 0, slices, subresources.data());
+    });
+    const double serialSeconds = measure([&]()
+    {
+        return UpdateSubresourcesParallel(commandList.Get(), texture.Get(), intermediate.Get(), 0, 0, slices, subresources.data());
+    });
+    const double parallelSeconds = measure([&]()
+    {
+        return UpdateSubresourcesParallel(commandList.Get(), texture.Get(), intermediate.Get(), 0, 0, slices, subresources.data(), &pool);
+    });
+    ThrowIfFailed(commandList->Close());
+
+    const double megabytes = sliceSize * slices / (1024.0 * 1024.0);
+    wprintf(L"%ux%u RGBA8, %u slices, %.0f MB, best of %u\n", width, height, slices, megabytes, iterations);
+    wprintf(L"d3dx12          %8.2f ms %8.1f MB/s\n", d3dx12Seconds * 1000.0, megabytes / d3dx12Seconds);
+    wprintf(L"1 thread        %8.2f ms %8.1f MB/s %5.2fx\n", serialSeconds * 1000.0, megabytes / serialSeconds, d3dx12Seconds / serialSeconds);
+    wprintf(L"%u threads      %8.2f ms %8.1f MB/s %5.2fx\n", pool.GetThreadCount() + 1, parallelSeconds * 1000.0,
+        megabytes / parallelSeconds, d3dx12Seconds / parallelSeconds);
+    return 0;
+}
+
+// Cost of keying the pipeline state cache: hashing a desc and finding it
+// among pipelines. Runs on made up descs, no device needed.
+static int PsoBench(int argc, wchar_t* argv[])
+{
+    UINT pipelineCount = 256;
+    UINT iterations = 100;
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-pipelines") == 0)
+        {
+            pipelineCount = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (wcscmp(argv[i], L"-iterations") == 0)
+        {
+            iterations = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    // 4 KiB shaders, the size of a small DXBC blob. Random checksums, one
+    // set with a DXBC header and one without so the whole blob gets hashed.
+    const SIZE_T shaderSize = 4096;
+    std::vector<BYTE> shaders[2][2];
+    for (UINT container = 0; container < 2; container++)
+    {
+        for (std::vector<BYTE>& shader : shaders[container])
+        {
+            shader.resize(shaderSize);
+            for (BYTE& b : shader)
+            {
+                b = static_cast<BYTE>(rand());
+            }
+            if (container == 0)
+            {
+                memcpy(shader.data(), "DXBC", 4);
+            }
+        }
+    }
+
+    const D3D12_INPUT_ELEMENT_DESC inputLayout[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
+    };
+
+    for (UINT container = 0; container < 2; container++)
+    {
+        // Variants differ in the state that usually varies: formats, MSAA and blending.
+        std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC> descs(pipelineCount);
+        for (UINT i = 0; i < pipelineCount; i++)
+        {
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc = descs[i];
+            desc = {};
+            desc.InputLayout = { inputLayout, _countof(inputLayout) };
+            desc.VS = { shaders[container][0].data(), shaderSize };
+            desc.PS = { shaders[container][1].data(), shaderSize };
+            desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+            desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+            desc.BlendState.RenderTarget[0].BlendEnable = (i & 1) ? TRUE : FALSE;
+            desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+            desc.SampleMask = UINT_MAX;
+            desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+            desc.NumRenderTargets = 1;
+            desc.RTVFormats[0] = static_cast<DXGI_FORMAT>(DXGI_FORMAT_R32G32B32A32_TYPELESS + (i >> 2) % 100);
+            desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+            desc.SampleDesc.Count = (i & 2) ? 4 : 1;
+        }
+
+        std::unordered_map<UINT64, UINT> table;
+        for (UINT i = 0; i < pipelineCount; i++)
+        {
+            table[HashGraphicsPipelineStateDesc(descs[i], 1)] = i;
+        }
+
+        UINT found = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (UINT n = 0; n < iterations; n++)
+        {
+            for (const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc : descs)
+            {
+                found += table.count(HashGraphicsPipelineStateDesc(desc, 1)) ? 1 : 0;
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        const double lookups = static_cast<double>(pipelineCount) * iterations;
+        wprintf(L"%-16s %u distinct of %u, %.0f ns per hash and lookup\n",
+            container == 0 ? L"DXBC checksum" : L"full bytecode", static_cast<UINT>(table.size()), pipelineCount,
+            std::chrono::duration<double, std::nano>(end - start).count() / lookups);
+        if (found != pipelineCount * iterations)
+        {
+            wprintf(L"lookup failed\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Deletes the blobs rootsigbench wrote, and the directory.
+static void RemoveRootSignatureBlobs(const std::wstring& directory)
+{
+    WIN32_FIND_DATAW data;
+    HANDLE find = FindFirstFileW((directory + L"*.rs").c_str(), &data);
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            DeleteFileW((directory + data.cFileName).c_str());
+        } while (FindNextFileW(find, &data));
+        FindClose(find);
+    }
+    RemoveDirectoryW(directory.c_str());
+}
+
+// Getting root signatures the way the samples used to, serialized and
+// created every time, against RootSignatureCache on a first run (serialize
+// and write the blob), a later run (blob from disk) and a repeated desc in
+// the same run (memory). Descs vary in their table ranges and constants.
+static int RootSigBench(int argc, wchar_t* argv[])
+{
+    UINT signatureCount = 64;
+    UINT iterations = 10;
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-signatures") == 0)
+        {
+            signatureCount = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (wcscmp(argv[i], L"-iterations") == 0)
+        {
+            iterations = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    ComPtr<ID3D12Device> device = CreateBenchDevice();
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+    featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+    {
+        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+    }
+
+    std::vector<std::array<CD3DX12_DESCRIPTOR_RANGE1, 2>> ranges(signatureCount);
+    std::vector<std::array<CD3DX12_ROOT_PARAMETER1, 3>> parameters(signatureCount);
+    std::vector<CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC> descs(signatureCount);
+    const CD3DX12_STATIC_SAMPLER_DESC sampler(0);
+    for (UINT i = 0; i < signatureCount; i++)
+    {
+        ranges[i][0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1 + i % 8, 0);
+        ranges[i][1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1 + i / 8 % 4, 1);
+        parameters[i][0].InitAsDescriptorTable(2, ranges[i].data(), D3D12_SHADER_VISIBILITY_ALL);
+        parameters[i][1].InitAsConstantBufferView(0);
+        parameters[i][2].InitAsConstants(4 + i / 32, 1, 1);
+        descs[i].Init_1_1(3, parameters[i].data(), 1, &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+    }
+
+    WCHAR tempPath[MAX_PATH];
+    GetTempPathW(MAX_PATH, tempPath);
+    const std::wstring directory = std::wstring(tempPath) + L"RootSigBench\\";
+    RemoveRootSignatureBlobs(directory);
+
+    double direct = 0.0;
+    double firstRun = 0.0;
+    double laterRun = 0.0;
+    double memory = 0.0;
+    UINT serializes = 0;
+    UINT diskHits = 0;
+    UINT memoryHits = 0;
+    for (UINT n = 0; n < iterations; n++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& desc : descs)
+        {
+            ComPtr<ID3DBlob> signature;
+            ComPtr<ID3DBlob> error;
+            ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&desc, featureData.HighestVersion, &signature, &error));
+            ComPtr<ID3D12RootSignature> rootSignature;
+            ThrowIfFailed(device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
+        }
+        auto end = std::chrono::steady_clock::now();
+        direct += std::chrono::duration<double, std::micro>(end - start).count();
+
+        for (UINT run = 0; run < 2; run++)
+        {
+            RootSignatureCache cache(device.Get(), directory);
+            start = std::chrono::steady_clock::now();
+            for (const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& desc : descs)
+            {
+                cache.GetOrCreate(desc);
+            }
+            end = std::chrono::steady_clock::now();
+            (run == 0 ? firstRun : laterRun) += std::chrono::duration<double, std::micro>(end - start).count();
+
+            if (run == 1)
+            {
+                start = std::chrono::steady_clock::now();
+                for (const CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC& desc : descs)
+                {
+                    cache.GetOrCreate(desc);
+                }
+                end = std::chrono::steady_clock::now();
+                memory += std::chrono::duration<double, std::micro>(end - start).count();
+            }
+            serializes += cache.GetSerializeCount();
+            diskHits += cache.GetDiskHitCount();
+            memoryHits += cache.GetMemoryHitCount();
+        }
+        RemoveRootSignatureBlobs(directory);
+    }
+
+    const double lookups = static_cast<double>(signatureCount) * iterations;
+    wprintf(L"%u root signatures, version 1.%u, %u iterations\n", signatureCount,
+        featureData.HighestVersion == D3D_ROOT_SIGNATURE_VERSION_1_1 ? 1 : 0, iterations);
+    wprintf(L"serialize and create %8.2f us each\n", direct / lookups);
+    wprintf(L"cache, first run     %8.2f us each, %u serialized\n", firstRun / lookups, serializes);
+    wprintf(L"cache, later run     %8.2f us each, %u from disk\n", laterRun / lookups, diskHits);
+    wprintf(L"cache, same run      %8.2f us each, %u from memory\n", memory / lookups, memoryHits);
+    return 0;
+}
+
+// Barriers a HelloWindow frame records for its render targets: hand written,
+// as the samples did before the state tracker, against the requests the
+// samples make of ResourceStateTracker now. Each frame is 1X or 4X MSAA,
+// with or without a screenshot. Runs on made up resources, no device needed.
+struct BarrierCounts
+{
+    UINT Calls = 0;
+    UINT Barriers = 0;
+
+    void Add(const std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+    {
+        Calls += barriers.empty() ? 0 : 1;
+        Barriers += static_cast<UINT>(barriers.size());
+    }
+};
+
+static void RecordFrameByHand(bool msaa, bool screenshot, ID3D12Resource* backBuffer, ID3D12Resource* msaaTarget,
+    std::vector<D3D12_RESOURCE_BARRIER>& barriers, BarrierCounts& counts)
+{
+    auto record = [&](std::initializer_list<D3D12_RESOURCE_BARRIER> call)
+    {
+        barriers.assign(call.begin(), call.end());
+        counts.Add(barriers);
+    };
+
+    record({ CD3DX12_RESOURCE_BARRIER::Transition(msaa ? msaaTarget : backBuffer,
+        msaa ? D3D12_RESOURCE_STATE_RESOLVE_SOURCE : D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET) });
+    if (msaa)
+    {
+        record({
+            CD3DX12_RESOURCE_BARRIER::Transition(msaaTarget, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_RESOLVE_SOURCE),
+            CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RESOLVE_DEST) });
+        record({ CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET) });
+    }
+    if (screenshot)
+    {
+        record({ CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE) });
+        record({ CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET) });
+    }
+    record({ CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT) });
+}
+
+// The requests of BeginSceneRendering, EndSceneRendering, RecordScreenshot
+// and PrepareToPresent.
+static void RecordFrameWithTracker(bool msaa, bool screenshot, ID3D12Resource* backBuffer, ID3D12Resource* msaaTarget,
+    ResourceStateTracker& tracker, std::vector<D3D12_RESOURCE_BARRIER>& barriers, BarrierCounts& counts)
+{
+    auto flush = [&]()
+    {
+        barriers.clear();
+        tracker.Flush(barriers);
+        counts.Add(barriers);
+    };
+
+    tracker.Transition(msaa ? msaaTarget : backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    flush();
+    if (msaa)
+    {
+        tracker.Transition(msaaTarget, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+        tracker.Transition(backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST);
+        flush();
+        tracker.Transition(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+    if (screenshot)
+    {
+        const D3D12_RESOURCE_STATES state = tracker.GetState(backBuffer);
+        tracker.Transition(backBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        flush();
+        tracker.Transition(backBuffer, state);
+    }
+    tracker.Transition(backBuffer, D3D12_RESOURCE_STATE_PRESENT);
+    flush();
+}
+
+static int BarrierBench(int argc, wchar_t* argv[])
+{
+    UINT frames = 100000;
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-frames") == 0)
+        {
+            frames = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    ID3D12Resource* backBuffer = reinterpret_cast<ID3D12Resource*>(0x1000);
+    ID3D12Resource* msaaTarget = reinterpret_cast<ID3D12Resource*>(0x2000);
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    wprintf(L"%u frames each         by hand                      state tracker\n", frames);
+    for (UINT variant = 0; variant < 4; variant++)
+    {
+        const bool msaa = (variant & 2) != 0;
+        const bool screenshot = (variant & 1) != 0;
+
+        BarrierCounts byHand;
+        auto start = std::chrono::steady_clock::now();
+        for (UINT frame = 0; frame < frames; frame++)
+        {
+            RecordFrameByHand(msaa, screenshot, backBuffer, msaaTarget, barriers, byHand);
+        }
+        const double byHandNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+
+        ResourceStateTracker tracker;
+        tracker.Register(backBuffer, D3D12_RESOURCE_STATE_PRESENT, 1);
+        tracker.Register(msaaTarget, D3D12_RESOURCE_STATE_RESOLVE_SOURCE, 1);
+        BarrierCounts withTracker;
+        start = std::chrono::steady_clock::now();
+        for (UINT frame = 0; frame < frames; frame++)
+        {
+            RecordFrameWithTracker(msaa, screenshot, backBuffer, msaaTarget, tracker, barriers, withTracker);
+        }
+        const double trackerNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+
+        wprintf(L"%s%-12s  %u calls %u barriers %6.0f ns   %u calls %u barriers %6.0f ns\n",
+            msaa ? L"4X" : L"1X", screenshot ? L" screenshot" : L"",
+            byHand.Calls / frames, byHand.Barriers / frames, byHandNs,
+            withTracker.Calls / frames, withTracker.Barriers / frames, trackerNs);
+    }
+    return 0;
+}
+
+// Shader source for reloadbench: three keywords, and a pixel shader include
+// the vertex shaders never open.
+static const char ReloadBenchSource[] =
+    "// keywords: GRAYSCALE FOG TINT\n"
+    "cbuffer ObjectConstants : register(b0) { float4x4 WorldViewProj; };\n"
+    "struct VertexOut { float4 Position : SV_POSITION; float4 Color : COLOR; };\n"
+    "VertexOut VSMain(float3 position : POSITION, float4 color : COLOR)\n"
+    "{\n"
+    "    VertexOut vout;\n"
+    "    vout.Position = mul(float4(position, 1.0f), WorldViewProj);\n"
+    "    vout.Color = color;\n"
+    "    return vout;\n"
+    "}\n"
+    "#if PIXEL_SHADER\n"
+    "#include \"Lighting.hlsli\"\n"
+    "float4 PSMain(VertexOut pin) : SV_Target\n"
+    "{\n"
+    "    float4 color = Shade(pin.Color);\n"
+    "#if GRAYSCALE\n"
+    "    color.rgb = dot(color.rgb, float3(0.299f, 0.587f, 0.114f));\n"
+    "#endif\n"
+    "#if FOG\n"
+    "    color.rgb = lerp(color.rgb, float3(0.5f, 0.5f, 0.5f), saturate(pin.Position.z));\n"
+    "#endif\n"
+    "#if TINT\n"
+    "    color.rgb *= float3(1.0f, 0.9f, 0.8f);\n"
+    "#endif\n"
+    "    return color;\n"
+    "}\n"
+    "#endif\n";
+
+static void WriteLightingInclude(const std::wstring& path, UINT edit)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "float4 Shade(float4 color) { return color * " << (0.5f + (edit % 50) * 0.01f) << "f; }\n";
+}
+
+// What a hot reload costs with the shader cache, as HelloWindow rebuilds its
+// vertex and pixel shader permutations, against compiling everything again:
+// - a save that changed nothing, every permutation is a cache hit
+// - an edit to an include only the pixel shaders use, only they compile
+// - no cache, every reload compiles every permutation
+static int ReloadBench(int argc, wchar_t* argv[])
+{
+    UINT iterations = 5;
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-iterations") == 0)
+        {
+            iterations = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+    }
+
+    WCHAR tempPath[MAX_PATH];
+    GetTempPathW(MAX_PATH, tempPath);
+    const std::wstring directory = std::wstring(tempPath) + L"ReloadBench\\";
+    CreateDirectoryW(directory.c_str(), nullptr);
+    const std::wstring includePath = directory + L"Lighting.hlsli";
+    WriteLightingInclude(includePath, 0);
+
+    ShaderCompileDesc vertexDesc;
+    vertexDesc.SourceName = "Reload.hlsl";
+    vertexDesc.Source.Data = reinterpret_cast<const uint8_t*>(ReloadBenchSource);
+    vertexDesc.Source.Size = sizeof(ReloadBenchSource) - 1;
+    vertexDesc.Defines = { { "PIXEL_SHADER", "0" } };
+    vertexDesc.EntryPoint = "VSMain";
+    vertexDesc.Target = "vs_5_0";
+    ShaderCompileDesc pixelDesc = vertexDesc;
+    pixelDesc.Defines = { { "PIXEL_SHADER", "1" } };
+    pixelDesc.EntryPoint = "PSMain";
+    pixelDesc.Target = "ps_5_0";
+    const std::vector<std::string> keywords = ParseShaderKeywords(vertexDesc.Source);
+
+    ThreadPool pool;
+    auto reload = [&](ShaderCache& cache)
+    {
+        ShaderPermutationSet vertexShaders(vertexDesc, keywords);
+        ShaderPermutationSet pixelShaders(pixelDesc, keywords);
+        const UINT misses = cache.GetMissCount();
+        const auto start = std::chrono::steady_clock::now();
+        vertexShaders.Compile(cache, &pool);
+        pixelShaders.Compile(cache, &pool);
+        const auto end = std::chrono::steady_clock::now();
+        return std::make_pair(std::chrono::duration<double, std::milli>(end - start).count(), cache.GetMissCount() - misses);
+    };
+
+    ShaderCache cache(L"", directory);
+    const std::pair<double, UINT> first = reload(cache);
+    double unchanged = 0.0;
+    double edited = 0.0;
+    double uncached = 0.0;
+    UINT unchangedCompiles = 0;
+    UINT editedCompiles = 0;
+    UINT uncachedCompiles = 0;
+    for (UINT n = 0; n < iterations; n++)
+    {
+        cache.NotifyFilesChanged({ L"Lighting.hlsli" });
+        std::pair<double, UINT> result = reload(cache);
+        unchanged += result.first;
+        unchangedCompiles += result.second;
+
+        WriteLightingInclude(includePath, n + 1);
+        cache.NotifyFilesChanged({ L"Lighting.hlsli" });
+        result = reload(cache);
+        edited += result.first;
+        editedCompiles += result.second;
+
+        ShaderCache noCache(L"", directory);
+        result = reload(noCache);
+        uncached += result.first;
+        uncachedCompiles += result.second;
+    }
+    DeleteFileW(includePath.c_str());
+    RemoveDirectoryW(directory.c_str());
+
+    wprintf(L"%zu keywords, %u permutations per stage, %u threads, %u iterations\n", keywords.size(),
+        1u << keywords.size(), pool.GetThreadCount() + 1, iterations);
+    wprintf(L"first load       %8.2f ms, %u compiled\n", first.first, first.second);
+    wprintf(L"unchanged save   %8.2f ms, %u compiled\n", unchanged / iterations, unchangedCompiles / iterations);
+    wprintf(L"include edit     %8.2f ms, %u compiled\n", edited / iterations, editedCompiles / iterations);
+    wprintf(L"without cache    %8.2f ms, %u compiled\n", uncached / iterations, uncachedCompiles / iterations);
+    return 0;
+}
+
+// Fills a shader cache directory ahead of time, the samples look in
+// ShaderCache\ next to the executable. -debug matches debug builds of the
+// samples, which compile with debug info and without optimization.
+static int Precompile(int argc, wchar_t* argv[])
+{
+    if (argc < 5)
+    {
+        wprintf(L"usage: AssetTools precompile <cacheDir> <source.hlsl> <entry:target>... [-D name[=value]] [-debug]\n");
+        return 1;
+    }
+
+    std::wstring cacheDir = argv[2];
+    if (cacheDir.back() != L'\\' && cacheDir.back() != L'/')
+    {
+        cacheDir += L'\\';
+    }
+
+    // The source name is what the samples pass, the bare file name.
+    const std::wstring sourcePath = argv[3];
+    const size_t separator = sourcePath.find_last_of(L"\\/");
+    const std::wstring sourceDir = separator == std::wstring::npos ? L"" : sourcePath.substr(0, separator + 1);
+    const std::wstring sourceName = separator == std::wstring::npos ? sourcePath : sourcePath.substr(separator + 1);
+
+    std::vector<std::pair<std::string, std::string>> entryPoints;
+    ShaderCompileDesc desc;
+    desc.SourceName = WStringToAnsi(sourceName);
+    for (int i = 4; i < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-D") == 0 && i + 1 < argc)
+        {
+            const std::string define = WStringToAnsi(argv[++i]);
+            const size_t equals = define.find('=');
+            if (equals == std::string::npos)
+            {
+                desc.Defines.push_back({ define, "1" });
+            }
+            else
+            {
+                desc.Defines.push_back({ define.substr(0, equals), define.substr(equals + 1) });
+            }
+        }
+        else if (wcscmp(argv[i], L"-debug") == 0)
+        {
+            desc.Flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+        }
+        else
+        {
+            const std::string entry = WStringToAnsi(argv[i]);
+            const size_t colon = entry.find(':');
+            if (colon == std::string::npos)
+            {
+                wprintf(L"expected entry:target, got %s\n", argv[i]);
+                return 1;
+            }
+            entryPoints.push_back({ entry.substr(0, colon), entry.substr(colon + 1) });
+        }
+    }
+
+    MappedFile source(sourcePath);
+    desc.Source = source.GetSpan();
+    const std::vector<std::string> keywords = ParseShaderKeywords(desc.Source);
+    ShaderCache cache(cacheDir, sourceDir);
+    ThreadPool pool;
+    for (const auto& entryPoint : entryPoints)
+    {
+        desc.EntryPoint = entryPoint.first;
+        desc.Target = entryPoint.second;
+        ShaderPermutationSet permutations(desc, keywords);
+        const UINT misses = cache.GetMissCount();
+        permutations.Compile(cache, &pool);
+
+        for (ShaderPermutationKey key = 0; key < permutations.GetPermutationCount(); key++)
+        {
+            std::string enabled;
+            for (size_t i = 0; i < keywords.size(); i++)
+            {
+                if ((key >> i) & 1)
+                {
+                    enabled += " " + keywords[i];
+                }
+            }
+            wprintf(L"%016llx %8zu %S:%S%S\n", ShaderCache::ComputeKey(permutations.GetPermutationDesc(key)),
+                permutations.Get(key)->GetBufferSize(), desc.EntryPoint.c_str(), desc.Target.c_str(), enabled.c_str());
+        }
+        wprintf(L"%S: %u permutations, %u unique, %u compiled\n", desc.EntryPoint.c_str(),
+            permutations.GetPermutationCount(), permutations.GetUniqueCount(), cache.GetMissCount() - misses);
+    }
+    return 0;
+}
+
+// Golden image check for frames captured with -headless -capture. Exits with 1
+// when more than maxDiffPixels pixels differ by more than tolerance.
+static int ImageDiff(int argc, wchar_t* argv[])
+{
+    if (argc < 4)
+    {
+        wprintf(L"usage: AssetTools imgdiff <expected.ppm> <actual.ppm> [-tolerance n] [-maxDiffPixels n] [-diff out.ppm]\n");
+        return 1;
+    }
+
+    UINT tolerance = 0;
+    UINT maxDiffPixels = 0;
+    std::wstring diffPath;
+    for (int i = 4; i + 1 < argc; i++)
+    {
+        if (wcscmp(argv[i], L"-tolerance") == 0)
+        {
+            tolerance = wcstoul(argv[++i], nullptr, 10);
+        }
+        else if (wcscmp(argv[i], L"-maxDiffPixels") == 0)
+        {
+            maxDiffPixels = wcstoul(argv[++i], nullptr, 10);
+        }
+        else if (wcscmp(argv[i], L"-diff") == 0)
+        {
+            diffPath = argv[++i];
+        }
+    }
+
+    const Image expected = ReadPpm(argv[2]);
+    const Image actual = ReadPpm(argv[3]);
+    if (expected.Width != actual.Width || expected.Height != actual.Height)
+    {
+        wprintf(L"FAIL size %ux%u, expected %ux%u\n", actual.Width, actual.Height, expected.Width, expected.Height);
+        return 1;
+    }
+
+    Image diff;
+    const ImageComparison comparison = CompareImages(expected, actual, tolerance, diffPath.empty() ? nullptr : &diff);
+    if (!diffPath.empty())
+    {
+        WritePpm(diffPath, diff);
+    }
+
+    const bool pass = comparison.DifferentPixels <= maxDiffPixels;
+    wprintf(L"%s %u pixels differ, max difference %u\n", pass ? L"PASS" : L"FAIL", comparison.DifferentPixels, comparison.MaxDifference);
+    return pass ? 0 : 1;
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+    if (argc < 2)
+    {
+        wprintf(L"usage: AssetTools <pack|list|bench|coldbench|copybench|psobench|rootsigbench|barrierbench|reloadbench|precompile|imgdiff> ...\n");
+        return 1;
+    }
+
+    try
+    {
+        if (wcscmp(argv[1], L"pack") == 0)
+        {
+            return Pack(argc, argv);
+        }
+        if (wcscmp(argv[1], L"list") == 0)
+        {
+            return List(argc, argv);
+        }
+        if (wcscmp(argv[1], L"bench") == 0)
+        {
+            return Bench(argc, argv);
+        }
+        if (wcscmp(argv[1], L"coldbench") == 0)
+        {
+            return ColdBench(argc, argv);
+        }
+        if (wcscmp(argv[1], L"copybench") == 0)
+        {
+            return CopyBench(argc, argv);
+        }
+        if (wcscmp(argv[1], L"psobench") == 0)
+        {
+            return PsoBench(argc, argv);
+        }
+        if (wcscmp(argv[1], L"rootsigbench") == 0)
+        {
+            return RootSigBench(argc, argv);
+        }
+        if (wcscmp(argv[1], L"barrierbench") == 0)
+        {
+            return BarrierBench(argc, argv);
+        }
+        if (wcscmp(argv[1], L"reloadbench") == 0)
+        {
+            return ReloadBench(argc, argv);
+        }
+        if (wcscmp(argv[1], L"precompile") == 0)
+        {
+            return Precompile(argc, argv);
+        }
+        if (wcscmp(argv[1], L"imgdiff") == 0)
+        {
+            return ImageDiff(argc, argv);
+        }
+        wprintf(L"unknown command %s\n", argv[1]);
+        return 1;
+    }
+    catch (const HrException& e)
+    {
+        wprintf(L"%s\n", e.ToString().c_str());
+        return static_cast<int>(e.Error());
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// A fixed amount of CPU work standing in for a stage or a job, such as
+// compiling shaders or recording draws. Measured in loop iterations rather
+// than by the clock, which keeps going while a thread waits for a core and
+// would make oversubscribed runs look faster than they are.
+class BenchmarkWork
+{
+public:
+    // Times the loop on the calling thread.
+    BenchmarkWork()
+    {
+        typedef std::chrono::steady_clock Clock;
+        for (uint64_t count = 1 << 16; ; count *= 2)
+        {
+            const Clock::time_point start = Clock::now();
+            volatile uint32_t sink = Run(count);
+            (void)sink;
+            const double nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            if (nanoseconds > 50e6)
+            {
+                m_iterationsPerNanosecond = count / nanoseconds;
+                return;
+            }
+        }
+    }
+
+    // About nanoseconds of work on an otherwise idle core.
+    uint32_t Do(double nanoseconds)const
+    {
+        return Run(static_cast<uint64_t>(nanoseconds * m_iterationsPerNanosecond));
+    }
+
+private:
+    static uint32_t Run(uint64_t count)
+    {
+        uint32_t state = 1;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            state = state * 1664525u + 1013904223u;
+        }
+        return state;
+    }
+
+    double m_iterationsPerNanosecond = 0.0;
+};
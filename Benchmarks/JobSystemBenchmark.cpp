@@ -0,0 +1,115 @@
+// Scaling of the job system on frame sized batches of small jobs, from one
+// thread up to every hardware thread. ThreadPool::ParallelFor, whose workers
+// share one queue, runs the same batches for comparison.
+//
+//   JobSystemBenchmark [--jobs <per frame>] [--work <ns per job>] [--frames <n>]
+//                      [--threads <max>]
+//
+// Thread counts past the hardware threads only measure oversubscription.
+#include "BenchmarkWork.h"
+#include "JobSystem.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t jobCount = 4096;
+    double workNs = 2000.0;
+    uint32_t frames = 100;
+    uint32_t maxThreads = std::max(2u, std::thread::hardware_concurrency());
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--jobs") == 0)
+        {
+            jobCount = std::max(1ul, std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--work") == 0)
+        {
+            workNs = std::strtod(argv[i + 1], nullptr);
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0)
+        {
+            frames = std::max(1ul, std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            maxThreads = std::max(2ul, std::strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    const BenchmarkWork work;
+    std::atomic<uint64_t> sink(0);
+    auto body = [&](uint32_t begin, uint32_t end)
+    {
+        uint64_t value = 0;
+        for (uint32_t i = begin; i < end; i++)
+        {
+            value += work.Do(workNs);
+        }
+        sink.fetch_add(value, std::memory_order_relaxed);
+    };
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        body(0, jobCount);
+    }
+    const double serialSeconds = SecondsSince(start);
+
+    std::printf("%u jobs of %.0f ns per frame, %u frames, %u hardware threads\n", jobCount, workNs, frames,
+        std::thread::hardware_concurrency());
+    std::printf("threads  job system                                thread pool\n");
+    std::printf("%7u  %8.2f ms  %5.2fx  %3.0f%%  %7s steals  %8.2f ms  %5.2fx\n", 1u,
+        serialSeconds * 1000.0 / frames, 1.0, 100.0, "-", serialSeconds * 1000.0 / frames, 1.0);
+
+    // Powers of two and the maximum. The calling thread works too, threads counts it.
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threads = 2; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (uint32_t threads : threadCounts)
+    {
+        double jobSeconds;
+        uint64_t steals;
+        {
+            JobSystem jobs(threads - 1);
+            start = Clock::now();
+            for (uint32_t frame = 0; frame < frames; frame++)
+            {
+                jobs.ParallelFor(jobCount, 1, body);
+            }
+            jobSeconds = SecondsSince(start);
+            steals = jobs.GetStealCount();
+        }
+
+        double poolSeconds;
+        {
+            ThreadPool pool(threads - 1);
+            start = Clock::now();
+            for (uint32_t frame = 0; frame < frames; frame++)
+            {
+                pool.ParallelFor(jobCount, [&body](uint32_t i) { body(i, i + 1); });
+            }
+            poolSeconds = SecondsSince(start);
+        }
+
+        const double jobSpeedup = serialSeconds / jobSeconds;
+        std::printf("%7u  %8.2f ms  %5.2fx  %3.0f%%  %7llu steals  %8.2f ms  %5.2fx\n", threads,
+            jobSeconds * 1000.0 / frames, jobSpeedup, jobSpeedup * 100.0 / threads,
+            static_cast<unsigned long long>(steals), poolSeconds * 1000.0 / frames, serialSeconds / poolSeconds);
+    }
+    return 0;
+}
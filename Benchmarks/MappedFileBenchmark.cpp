@@ -0,0 +1,152 @@
+// Loading an asset into upload memory: ReadDataFromFile style read into a
+// malloc'ed buffer and copy, against MappedFile and a copy straight from the
+// mapping. Both end in the same memcpy into a stand-in for the upload heap.
+//
+//   MappedFileBenchmark [--size <MiB>] [--iterations <n>] [--file <path>]
+//
+// Cold runs drop the file from the page cache first, which needs Linux.
+#include "MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void WriteTestFile(const std::string& path, uint64_t size)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        std::perror(path.c_str());
+        std::exit(1);
+    }
+    std::vector<uint8_t> block(1 << 20);
+    uint32_t state = 12345;
+    for (uint64_t written = 0; written < size; written += block.size())
+    {
+        for (uint8_t& b : block)
+        {
+            state = state * 1664525u + 1013904223u;
+            b = static_cast<uint8_t>(state >> 24);
+        }
+        std::fwrite(block.data(), 1, static_cast<size_t>(std::min<uint64_t>(block.size(), size - written)), file);
+    }
+    std::fclose(file);
+}
+
+// Returns false where the page cache can not be dropped without privileges.
+static bool EvictFromCache(const std::string& path)
+{
+#ifdef __linux__
+    const int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+    fdatasync(file);
+    const bool evicted = posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(file);
+    return evicted;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+static void ReadAndCopy(const std::string& path, uint8_t* upload)
+{
+    FILE* file = std::fopen(path.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    uint8_t* data = static_cast<uint8_t*>(std::malloc(size));
+    if (std::fread(data, 1, size, file) != static_cast<size_t>(size))
+    {
+        std::fprintf(stderr, "short read\n");
+        std::exit(1);
+    }
+    std::fclose(file);
+    std::memcpy(upload, data, size);
+    std::free(data);
+}
+
+static void MapAndCopy(const std::string& path, uint8_t* upload)
+{
+    MappedFile file(std::wstring(path.begin(), path.end()));
+    std::memcpy(upload, file.Data(), static_cast<size_t>(file.Size()));
+}
+
+// Best time of iterations runs, in seconds.
+static double Measure(void (*load)(const std::string&, uint8_t*), const std::string& path,
+    uint8_t* upload, int iterations, bool cold)
+{
+    double best = 1e30;
+    for (int i = 0; i < iterations; i++)
+    {
+        if (cold)
+        {
+            EvictFromCache(path);
+        }
+        const Clock::time_point start = Clock::now();
+        load(path, upload);
+        best = std::min(best, SecondsSince(start));
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t sizeMiB = 256;
+    int iterations = 5;
+    std::string path = "MappedFileBenchmark.bin";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const std::string option = argv[i];
+        if (option == "--size")
+        {
+            sizeMiB = std::strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (option == "--iterations")
+        {
+            iterations = std::max(1, std::atoi(argv[i + 1]));
+        }
+        else if (option == "--file")
+        {
+            path = argv[i + 1];
+        }
+    }
+
+    const uint64_t size = sizeMiB << 20;
+    WriteTestFile(path, size);
+    std::vector<uint8_t> upload(static_cast<size_t>(size));
+    const bool canEvict = EvictFromCache(path);
+
+    std::printf("%llu MiB, best of %d\n", static_cast<unsigned long long>(sizeMiB), iterations);
+    std::printf("%-6s %14s %14s %8s\n", "cache", "read+copy ms", "map+copy ms", "speedup");
+    for (int cold = 0; cold < (canEvict ? 2 : 1); cold++)
+    {
+        const double read = Measure(ReadAndCopy, path, upload.data(), iterations, cold != 0);
+        const double map = Measure(MapAndCopy, path, upload.data(), iterations, cold != 0);
+        std::printf("%-6s %14.2f %14.2f %7.2fx\n", cold ? "cold" : "warm", read * 1000.0, map * 1000.0, read / map);
+    }
+    if (!canEvict)
+    {
+        std::printf("cold runs skipped, the page cache can not be dropped here\n");
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
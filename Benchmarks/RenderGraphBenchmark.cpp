@@ -0,0 +1,98 @@
+// Building and compiling a synthetic render graph, as a frame would every
+// frame. Each pass renders a transient in one of a few sizes, reads some of
+// the transients the last 32 passes wrote and every 16th pass has a side
+// effect. Passes whose output nobody reads get culled.
+//
+//   RenderGraphBenchmark [--passes <n>] [--reads <n>] [--iterations <n>]
+#include "RenderGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+int main(int argc, char* argv[])
+{
+    uint32_t passCount = 4096;
+    uint32_t readCount = 3;
+    uint32_t iterations = 100;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--passes") == 0)
+        {
+            passCount = std::max(1ul, std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--reads") == 0)
+        {
+            readCount = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--iterations") == 0)
+        {
+            iterations = std::max(1ul, std::strtoul(argv[i + 1], nullptr, 10));
+        }
+    }
+
+    // The same graph every iteration, its shape is drawn once.
+    std::mt19937 random(1);
+    std::vector<std::vector<uint32_t>> reads(passCount);
+    std::vector<uint32_t> sizes(passCount);
+    for (uint32_t p = 0; p < passCount; p++)
+    {
+        sizes[p] = random() % 4;
+        for (uint32_t i = 0; p > 0 && i < readCount; i++)
+        {
+            reads[p].push_back(p - 1 - random() % std::min(p, 32u));
+        }
+    }
+
+    RenderGraph graph;
+    double buildSeconds = 0.0;
+    double compileSeconds = 0.0;
+    for (uint32_t n = 0; n < iterations; n++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        graph.Clear();
+        const RenderGraphResource backBuffer = graph.ImportResource(L"BackBuffer", RenderGraphUsage_Present, RenderGraphUsage_Present);
+        std::vector<RenderGraphResource> outputs(passCount);
+        for (uint32_t p = 0; p < passCount; p++)
+        {
+            RenderGraphTextureDesc desc;
+            desc.Width = 1920 >> sizes[p];
+            desc.Height = 1080 >> sizes[p];
+            desc.Format = 10;   // DXGI_FORMAT_R16G16B16A16_FLOAT
+            outputs[p] = graph.CreateTexture(L"Transient", desc);
+
+            const RenderGraphPass pass = graph.AddPass(L"Pass", p % 16 == 15);
+            graph.Write(pass, outputs[p], RenderGraphUsage_RenderTarget);
+            for (uint32_t input : reads[p])
+            {
+                graph.Read(pass, outputs[input], p % 2 ? RenderGraphUsage_ShaderResource : RenderGraphUsage_CopySource);
+            }
+            if (p == passCount - 1)
+            {
+                graph.Write(pass, backBuffer, RenderGraphUsage_RenderTarget);
+            }
+        }
+        auto middle = std::chrono::steady_clock::now();
+        graph.Compile();
+        auto end = std::chrono::steady_clock::now();
+
+        buildSeconds += std::chrono::duration<double>(middle - start).count();
+        compileSeconds += std::chrono::duration<double>(end - middle).count();
+    }
+
+    const uint32_t keptCount = static_cast<uint32_t>(graph.GetExecutionOrder().size());
+    uint32_t transientCount = 0;
+    for (RenderGraphResource r = 0; r < graph.GetResourceCount(); r++)
+    {
+        transientCount += !graph.IsImported(r) && graph.GetLifetime(r).First != RenderGraphInvalid ? 1 : 0;
+    }
+    std::printf("passes          %u, %u culled\n", passCount, passCount - keptCount);
+    std::printf("barriers        %u\n", graph.GetBarrierCount());
+    std::printf("transients      %u in %u textures\n", transientCount, graph.GetTextureSlotCount());
+    std::printf("build           %.3f ms\n", buildSeconds * 1000.0 / iterations);
+    std::printf("compile         %.3f ms (%.0f ns per pass)\n", compileSeconds * 1000.0 / iterations,
+        compileSeconds * 1e9 / iterations / passCount);
+    return 0;
+}
@@ -0,0 +1,96 @@
+// HelloWindow's init graph run serially, as -serialInit does, and on the
+// worker pool. The stages are busy loops of the given length, so the result
+// shows how close the scheduler gets to the critical path and what it costs
+// on top, not what the D3D12 stages themselves take.
+//
+//   TaskGraphBenchmark [--stages <heaps,buffers,shaders,rootsig,geometry,pso ms>]
+//                      [--threads <n>] [--iterations <n>]
+//
+// For the sample itself, run it with -initReport <file>, once with and once
+// without -serialInit, and feed the serial durations in here to see what a
+// machine with more cores would get.
+#include "BenchmarkWork.h"
+#include "TaskGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void Spin(const BenchmarkWork& work, double milliseconds)
+{
+    volatile uint32_t sink = work.Do(milliseconds * 1e6);
+    (void)sink;
+}
+
+static double RunGraph(const BenchmarkWork& work, const double* stageMilliseconds, ThreadPool* pool)
+{
+    TaskGraph graph;
+    const TaskGraphNode heaps = graph.Add(L"BuildConstantDescriptorHeaps", [&work, stageMilliseconds] { Spin(work, stageMilliseconds[0]); });
+    graph.Add(L"BuildConstantBuffers", [&work, stageMilliseconds] { Spin(work, stageMilliseconds[1]); }, { heaps });
+    const TaskGraphNode shaders = graph.Add(L"BuildShaderAndInputLayout", [&work, stageMilliseconds] { Spin(work, stageMilliseconds[2]); });
+    const TaskGraphNode rootSignature = graph.Add(L"BuildRootSignature", [&work, stageMilliseconds] { Spin(work, stageMilliseconds[3]); }, { shaders });
+    graph.Add(L"BuildOwnGeometry", [&work, stageMilliseconds] { Spin(work, stageMilliseconds[4]); });
+    graph.Add(L"BuildPSO", [&work, stageMilliseconds] { Spin(work, stageMilliseconds[5]); }, { rootSignature, shaders });
+    graph.Run(pool);
+    return graph.GetElapsedMilliseconds();
+}
+
+static double Median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char* argv[])
+{
+    double stageMilliseconds[6] = { 1.0, 1.0, 40.0, 5.0, 10.0, 20.0 };
+    uint32_t threads = 0;
+    int iterations = 20;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--stages") == 0)
+        {
+            char* stage = argv[i + 1];
+            for (double& milliseconds : stageMilliseconds)
+            {
+                milliseconds = std::strtod(stage, &stage);
+                stage += *stage == ',';
+            }
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0)
+        {
+            threads = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--iterations") == 0)
+        {
+            iterations = std::max(1, std::atoi(argv[i + 1]));
+        }
+    }
+
+    // Shaders, root signature and PSO form the longest chain.
+    const double* ms = stageMilliseconds;
+    const double serialWork = ms[0] + ms[1] + ms[2] + ms[3] + ms[4] + ms[5];
+    const double criticalPath = std::max({ ms[0] + ms[1], ms[2] + ms[3] + ms[5], ms[4] });
+
+    const BenchmarkWork work;
+    ThreadPool pool(threads);
+    std::vector<double> serial;
+    std::vector<double> parallel;
+    for (int i = 0; i < iterations; i++)
+    {
+        serial.push_back(RunGraph(work, stageMilliseconds, nullptr));
+        parallel.push_back(RunGraph(work, stageMilliseconds, &pool));
+    }
+
+    const double serialMedian = Median(serial);
+    const double parallelMedian = Median(parallel);
+    std::printf("%u hardware threads, pool of %u, %d iterations\n",
+        std::thread::hardware_concurrency(), pool.GetThreadCount(), iterations);
+    std::printf("stage work %.2f ms, critical path %.2f ms\n", serialWork, criticalPath);
+    std::printf("serial   %8.2f ms\n", serialMedian);
+    std::printf("parallel %8.2f ms  %.2fx, %.2f ms over the critical path\n",
+        parallelMedian, serialMedian / parallelMedian, parallelMedian - criticalPath);
+    return 0;
+}
@@ -0,0 +1,448 @@
+#include "stdafx.h"
+#include "AssetArchive.h"
+#include "AssetCodec.h"
+#include "SubresourceCopy.h"
+
+static_assert(sizeof(AssetArchiveHeader) == 64, "AssetArchiveHeader is part of the file format.");
+static_assert(sizeof(AssetArchiveEntry) == 48, "AssetArchiveEntry is part of the file format.");
+
+static WCHAR NormalizeAssetNameChar(WCHAR c)
+{
+    if (c == L'\\')
+    {
+        return L'/';
+    }
+    if (c >= L'A' && c <= L'Z')
+    {
+        return c - L'A' + L'a';
+    }
+    return c;
+}
+
+static bool AssetNamesEqual(const WCHAR* a, size_t aLength, const WCHAR* b, size_t bLength)
+{
+    if (aLength != bLength)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < aLength; i++)
+    {
+        if (NormalizeAssetNameChar(a[i]) != NormalizeAssetNameChar(b[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether count elements starting at offset lie within size bytes. Written
+// so that no sum or product can wrap around on a hostile header.
+static bool RangeFits(UINT64 offset, UINT64 count, UINT64 elementSize, UINT64 size)
+{
+    return offset <= size && count <= (size - offset) / elementSize;
+}
+
+static UINT64 AlignUp(UINT64 value, UINT64 alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// 64-bit FNV-1a over the normalized UTF-16 code units.
+UINT64 HashAssetName(LPCWSTR name)
+{
+    UINT64 hash = 14695981039346656037ull;
+    for (; *name; name++)
+    {
+        const WCHAR c = NormalizeAssetNameChar(*name);
+        hash = (hash ^ (c & 0xff)) * 1099511628211ull;
+        hash = (hash ^ (c >> 8)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+AssetArchive::AssetArchive(const std::wstring& filename)
+{
+    Open(filename);
+}
+
+void AssetArchive::Open(const std::wstring& filename)
+{
+    m_file.Open(filename);
+    const BYTE* data = m_file.Data();
+    const UINT64 size = m_file.Size();
+
+    // Validate everything once here so lookups don't have to.
+    if (size < sizeof(AssetArchiveHeader))
+    {
+        m_file.Close();
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+    }
+    const AssetArchiveHeader* header = reinterpret_cast<const AssetArchiveHeader*>(data);
+    bool valid = header->Magic == AssetArchiveMagic &&
+        header->Version == AssetArchiveVersion &&
+        header->SlotCount != 0 && (header->SlotCount & (header->SlotCount - 1)) == 0 &&
+        header->SlotCount >= header->EntryCount &&
+        header->ChunkSize == AssetChunkSize &&
+        RangeFits(header->EntriesOffset, header->EntryCount, sizeof(AssetArchiveEntry), size) &&
+        RangeFits(header->SlotsOffset, header->SlotCount, sizeof(UINT32), size) &&
+        RangeFits(header->NamesOffset, header->NamesSize, sizeof(WCHAR), size) &&
+        header->EntriesOffset % alignof(AssetArchiveEntry) == 0 &&
+        header->SlotsOffset % sizeof(UINT32) == 0 &&
+        header->NamesOffset % sizeof(WCHAR) == 0;
+
+    const AssetArchiveEntry* entries = reinterpret_cast<const AssetArchiveEntry*>(data + header->EntriesOffset);
+    for (UINT i = 0; valid && i < header->EntryCount; i++)
+    {
+        const AssetArchiveEntry& entry = entries[i];
+        valid = entry.Offset <= size && entry.StoredSize <= size - entry.Offset &&
+            RangeFits(entry.NameOffset, entry.NameLength, 1, header->NamesSize);
+        if (IsCompressed(entry))
+        {
+            valid = valid && entry.ChunkCount == entry.Size / AssetChunkSize + (entry.Size % AssetChunkSize != 0) &&
+                RangeFits(0, entry.ChunkCount, sizeof(UINT32), entry.StoredSize) &&
+                entry.Offset % sizeof(UINT32) == 0;
+        }
+        else
+        {
+            valid = valid && entry.StoredSize == entry.Size;
+        }
+    }
+    if (!valid)
+    {
+        m_file.Close();
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+    }
+
+    m_header = header;
+    m_entries = entries;
+    m_slots = reinterpret_cast<const UINT32*>(data + header->SlotsOffset);
+    m_names = reinterpret_cast<const WCHAR*>(data + header->NamesOffset);
+}
+
+const AssetArchiveEntry* AssetArchive::Find(LPCWSTR name)const
+{
+    if (!m_header)
+    {
+        return nullptr;
+    }
+
+    const UINT64 hash = HashAssetName(name);
+    const size_t nameLength = wcslen(name);
+    const UINT32 mask = m_header->SlotCount - 1;
+    for (UINT32 probe = 0, slot = static_cast<UINT32>(hash) & mask; probe < m_header->SlotCount; probe++, slot = (slot + 1) & mask)
+    {
+        if (m_slots[slot] == 0 || m_slots[slot] > m_header->EntryCount)
+        {
+            return nullptr;
+        }
+        const AssetArchiveEntry& entry = m_entries[m_slots[slot] - 1];
+        if (entry.NameHash == hash &&
+            AssetNamesEqual(m_names + entry.NameOffset, entry.NameLength, name, nameLength))
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const AssetArchiveEntry* AssetArchive::FindByHash(UINT64 nameHash)const
+{
+    if (!m_header)
+    {
+        return nullptr;
+    }
+
+    const UINT32 mask = m_header->SlotCount - 1;
+    for (UINT32 probe = 0, slot = static_cast<UINT32>(nameHash) & mask; probe < m_header->SlotCount; probe++, slot = (slot + 1) & mask)
+    {
+        if (m_slots[slot] == 0 || m_slots[slot] > m_header->EntryCount)
+        {
+            return nullptr;
+        }
+        const AssetArchiveEntry& entry = m_entries[m_slots[slot] - 1];
+        if (entry.NameHash == nameHash)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+ByteSpan AssetArchive::GetData(const AssetArchiveEntry& entry)const
+{
+    return m_file.GetSpan().Slice(entry.Offset, entry.StoredSize);
+}
+
+void AssetArchive::Decode(const AssetArchiveEntry& entry, void* destination, ThreadPool* pool, bool writeCombined)const
+{
+    const ByteSpan stored = GetData(entry);
+    BYTE* dest = static_cast<BYTE*>(destination);
+    if (!IsCompressed(entry))
+    {
+        if (writeCombined)
+        {
+            StreamingCopy(dest, stored.Data, static_cast<size_t>(stored.Size));
+        }
+        else
+        {
+            memcpy(dest, stored.Data, static_cast<size_t>(stored.Size));
+        }
+        return;
+    }
+
+    // Chunk offsets follow from the size table, check them before anyone decodes.
+    const UINT32* chunkSizes = reinterpret_cast<const UINT32*>(stored.Data);
+    std::vector<UINT64> chunkOffsets(entry.ChunkCount);
+    UINT64 offset = UINT64(entry.ChunkCount) * sizeof(UINT32);
+    for (UINT32 i = 0; i < entry.ChunkCount && offset <= stored.Size; i++)
+    {
+        chunkOffsets[i] = offset;
+        offset += chunkSizes[i] & ~AssetChunkStoredRaw;
+    }
+    if (offset != stored.Size)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+    }
+
+    auto decodeChunk = [&](UINT i)
+    {
+        const BYTE* src = stored.Data + chunkOffsets[i];
+        const size_t srcSize = chunkSizes[i] & ~AssetChunkStoredRaw;
+        BYTE* dst = dest + UINT64(i) * AssetChunkSize;
+        const size_t dstSize = static_cast<size_t>(std::min<UINT64>(entry.Size - UINT64(i) * AssetChunkSize, AssetChunkSize));
+        if (chunkSizes[i] & AssetChunkStoredRaw)
+        {
+            if (srcSize != dstSize)
+            {
+                ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+            }
+            if (writeCombined)
+            {
+                StreamingCopy(dst, src, dstSize);
+            }
+            else
+            {
+                memcpy(dst, src, dstSize);
+            }
+        }
+        else if (writeCombined)
+        {
+            // One chunk per thread at a time, small enough to stay in L2.
+            thread_local std::unique_ptr<BYTE[]> scratch;
+            if (!scratch)
+            {
+                scratch.reset(new BYTE[AssetChunkSize]);
+            }
+            if (!DecompressAssetChunk(src, srcSize, scratch.get(), dstSize))
+            {
+                ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+            }
+            StreamingCopy(dst, scratch.get(), dstSize);
+        }
+        else if (!DecompressAssetChunk(src, srcSize, dst, dstSize))
+        {
+            ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+        }
+    };
+
+    if (pool && entry.ChunkCount > 1)
+    {
+        pool->ParallelFor(entry.ChunkCount, decodeChunk);
+    }
+    else
+    {
+        for (UINT32 i = 0; i < entry.ChunkCount; i++)
+        {
+            decodeChunk(i);
+        }
+    }
+}
+
+// Chunk size table followed by the chunks, see the format description.
+static std::vector<BYTE> EncodeAssetPayload(const ByteSpan& data, ThreadPool& pool)
+{
+    const UINT32 chunkCount = static_cast<UINT32>((data.Size + AssetChunkSize - 1) / AssetChunkSize);
+    std::vector<std::vector<BYTE>> chunks(chunkCount);
+    std::vector<UINT32> chunkSizes(chunkCount);
+    pool.ParallelFor(chunkCount, [&](UINT i)
+    {
+        const BYTE* src = data.Data + UINT64(i) * AssetChunkSize;
+        const size_t srcSize = static_cast<size_t>(std::min<UINT64>(data.Size - UINT64(i) * AssetChunkSize, AssetChunkSize));
+        chunks[i].resize(srcSize);
+        const size_t compressedSize = CompressAssetChunk(src, srcSize, chunks[i].data(), srcSize);
+        if (compressedSize == 0)
+        {
+            memcpy(chunks[i].data(), src, srcSize);
+            chunkSizes[i] = static_cast<UINT32>(srcSize) | AssetChunkStoredRaw;
+        }
+        else
+        {
+            chunks[i].resize(compressedSize);
+            chunkSizes[i] = static_cast<UINT32>(compressedSize);
+        }
+    });
+
+    std::vector<BYTE> encoded(chunkSizes.size() * sizeof(UINT32));
+    memcpy(encoded.data(), chunkSizes.data(), encoded.size());
+    for (const std::vector<BYTE>& chunk : chunks)
+    {
+        encoded.insert(encoded.end(), chunk.begin(), chunk.end());
+    }
+    return encoded;
+}
+
+std::wstring AssetArchive::GetName(const AssetArchiveEntry& entry)const
+{
+    return std::wstring(m_names + entry.NameOffset, entry.NameLength);
+}
+
+void AssetArchiveWriter::AddFile(const std::wstring& name, const std::wstring& filename)
+{
+    Source source;
+    source.Name = name;
+    source.Filename = filename;
+    m_sources.push_back(std::move(source));
+}
+
+void AssetArchiveWriter::AddData(const std::wstring& name, std::vector<BYTE> data)
+{
+    Source source;
+    source.Name = name;
+    source.Data = std::move(data);
+    m_sources.push_back(std::move(source));
+}
+
+void AssetArchiveWriter::Write(const std::wstring& filename, UINT64 payloadAlignment, bool compress)
+{
+    if (payloadAlignment == 0 || (payloadAlignment & (payloadAlignment - 1)) != 0)
+    {
+        ThrowIfFailed(E_INVALIDARG);
+    }
+
+    const UINT32 entryCount = static_cast<UINT32>(m_sources.size());
+    UINT32 slotCount = 1;
+    while (slotCount < entryCount * 2)
+    {
+        slotCount <<= 1;
+    }
+
+    // Map the source files to learn their sizes, they are copied from the mapping below.
+    std::vector<MappedFile> files(entryCount);
+    std::vector<ByteSpan> payloads(entryCount);
+    for (UINT32 i = 0; i < entryCount; i++)
+    {
+        if (m_sources[i].Filename.empty())
+        {
+            payloads[i].Data = m_sources[i].Data.data();
+            payloads[i].Size = m_sources[i].Data.size();
+        }
+        else
+        {
+            files[i].Open(m_sources[i].Filename);
+            payloads[i] = files[i].GetSpan();
+        }
+    }
+
+    // Keep compressed payloads only where they pay off.
+    std::vector<std::vector<BYTE>> encoded(entryCount);
+    if (compress)
+    {
+        ThreadPool pool;
+        for (UINT32 i = 0; i < entryCount; i++)
+        {
+            if (payloads[i].Empty())
+            {
+                continue;
+            }
+            encoded[i] = EncodeAssetPayload(payloads[i], pool);
+            if (encoded[i].size() >= payloads[i].Size)
+            {
+                encoded[i].clear();
+            }
+        }
+    }
+
+    std::vector<AssetArchiveEntry> entries(entryCount);
+    std::vector<UINT32> slots(slotCount, 0);
+    std::vector<WCHAR> names;
+    for (UINT32 i = 0; i < entryCount; i++)
+    {
+        const std::wstring& name = m_sources[i].Name;
+        AssetArchiveEntry& entry = entries[i];
+        entry.NameHash = HashAssetName(name.c_str());
+        entry.NameOffset = static_cast<UINT32>(names.size());
+        entry.NameLength = static_cast<UINT32>(name.size());
+        entry.Size = payloads[i].Size;
+        entry.StoredSize = payloads[i].Size;
+        if (!encoded[i].empty())
+        {
+            entry.StoredSize = encoded[i].size();
+            entry.Flags = AssetEntryFlagCompressed;
+            entry.ChunkCount = static_cast<UINT32>((entry.Size + AssetChunkSize - 1) / AssetChunkSize);
+        }
+        names.insert(names.end(), name.begin(), name.end());
+
+        UINT32 slot = static_cast<UINT32>(entry.NameHash) & (slotCount - 1);
+        while (slots[slot] != 0)
+        {
+            const AssetArchiveEntry& other = entries[slots[slot] - 1];
+            if (other.NameHash == entry.NameHash &&
+                AssetNamesEqual(&names[other.NameOffset], other.NameLength, name.c_str(), name.size()))
+            {
+                // Two sources with the same asset name.
+                ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS));
+            }
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = i + 1;
+    }
+
+    AssetArchiveHeader header = {};
+    header.Magic = AssetArchiveMagic;
+    header.Version = AssetArchiveVersion;
+    header.EntryCount = entryCount;
+    header.SlotCount = slotCount;
+    header.ChunkSize = AssetChunkSize;
+    header.PayloadAlignment = payloadAlignment;
+    header.EntriesOffset = sizeof(AssetArchiveHeader);
+    header.SlotsOffset = header.EntriesOffset + sizeof(AssetArchiveEntry) * entryCount;
+    header.NamesOffset = header.SlotsOffset + sizeof(UINT32) * slotCount;
+    header.NamesSize = names.size();
+
+    UINT64 offset = AlignUp(header.NamesOffset + header.NamesSize * sizeof(WCHAR), payloadAlignment);
+    for (AssetArchiveEntry& entry : entries)
+    {
+        entry.Offset = offset;
+        offset = AlignUp(offset + entry.StoredSize, payloadAlignment);
+    }
+
+    std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED));
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), sizeof(AssetArchiveEntry) * entries.size());
+    file.write(reinterpret_cast<const char*>(slots.data()), sizeof(UINT32) * slots.size());
+    file.write(reinterpret_cast<const char*>(names.data()), sizeof(WCHAR) * names.size());
+
+    UINT64 position = header.NamesOffset + header.NamesSize * sizeof(WCHAR);
+    const std::vector<char> padding(static_cast<size_t>(std::min<UINT64>(payloadAlignment, 64 * 1024)), 0);
+    for (UINT32 i = 0; i < entryCount; i++)
+    {
+        while (position < entries[i].Offset)
+        {
+            const UINT64 count = std::min<UINT64>(entries[i].Offset - position, padding.size());
+            file.write(padding.data(), static_cast<std::streamsize>(count));
+            position += count;
+        }
+        const ByteSpan stored = encoded[i].empty() ? payloads[i] : ByteSpan{ encoded[i].data(), encoded[i].size() };
+        file.write(reinterpret_cast<const char*>(stored.Data), static_cast<std::streamsize>(stored.Size));
+        position += stored.Size;
+    }
+
+    if (!file)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_WRITE_FAULT));
+    }
+}
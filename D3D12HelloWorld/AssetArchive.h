@@ -0,0 +1,120 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+// Packed asset archive layout. All offsets are from the start of the file.
+//
+//   AssetArchiveHeader
+//   AssetArchiveEntry[EntryCount]
+//   UINT32 slots[SlotCount]     open addressing hash table, entry index + 1, 0 is empty
+//   WCHAR names[NamesSize]      not null terminated
+//   payloads, each aligned to PayloadAlignment
+//
+// Compressed payloads start with UINT32 chunkSizes[ChunkCount] followed by
+// the chunks, each decoding to ChunkSize bytes but the last. Chunks that did
+// not compress are stored as is and flagged with AssetChunkStoredRaw.
+//
+// Payloads are aligned so they can be read with unbuffered I/O (512) or
+// mapped and placed directly (64 KiB), the archive is mapped once and assets
+// are served as spans into the mapping.
+static const UINT32 AssetArchiveMagic = 0x314B4150; // "PAK1"
+static const UINT32 AssetArchiveVersion = 2;
+
+static const UINT32 AssetEntryFlagCompressed = 0x1;
+static const UINT32 AssetChunkStoredRaw = 0x80000000;
+
+struct AssetArchiveHeader
+{
+    UINT32 Magic;
+    UINT32 Version;
+    UINT32 EntryCount;
+    UINT32 SlotCount;
+    UINT32 ChunkSize;
+    UINT32 Reserved;
+    UINT64 PayloadAlignment;
+    UINT64 EntriesOffset;
+    UINT64 SlotsOffset;
+    UINT64 NamesOffset;
+    UINT64 NamesSize;
+};
+
+struct AssetArchiveEntry
+{
+    UINT64 NameHash;
+    UINT64 Offset;
+    UINT64 Size;            // Decoded size.
+    UINT64 StoredSize;      // Size in the archive, equals Size unless compressed.
+    UINT32 NameOffset;
+    UINT32 NameLength;
+    UINT32 Flags;
+    UINT32 ChunkCount;
+};
+
+// Asset names compare case insensitive and treat '\' and '/' alike.
+UINT64 HashAssetName(LPCWSTR name);
+
+// Runtime reader, maps the archive once and looks assets up in O(1).
+class AssetArchive
+{
+public:
+    AssetArchive() = default;
+    explicit AssetArchive(const std::wstring& filename);
+
+    AssetArchive(const AssetArchive& rhs) = delete;
+    AssetArchive& operator=(const AssetArchive& rhs) = delete;
+
+    // Throws HrException if the file is missing or not a valid archive.
+    void Open(const std::wstring& filename);
+    bool IsOpen()const { return m_file.IsOpen(); }
+
+    const AssetArchiveEntry* Find(LPCWSTR name)const;
+    const AssetArchiveEntry* FindByHash(UINT64 nameHash)const;
+
+    // Stored payload of the entry, valid as long as the archive is open.
+    // Only usable as is when the entry is not compressed.
+    ByteSpan GetData(const AssetArchiveEntry& entry)const;
+    static bool IsCompressed(const AssetArchiveEntry& entry) { return (entry.Flags & AssetEntryFlagCompressed) != 0; }
+
+    // Decode entry.Size bytes into destination. Chunks are decoded in parallel
+    // on the pool if one is given. With writeCombined, destination is mapped
+    // upload memory: matches read back what was decoded, so each chunk is
+    // decoded in cache and then streamed out, destination is never read.
+    // Throws HrException with ERROR_INVALID_DATA if the payload is corrupt.
+    void Decode(const AssetArchiveEntry& entry, void* destination, ThreadPool* pool = nullptr, bool writeCombined = false)const;
+    std::wstring GetName(const AssetArchiveEntry& entry)const;
+
+    UINT GetEntryCount()const { return m_header ? m_header->EntryCount : 0; }
+    const AssetArchiveEntry& GetEntry(UINT index)const { return m_entries[index]; }
+
+private:
+    MappedFile m_file;
+    const AssetArchiveHeader* m_header = nullptr;
+    const AssetArchiveEntry* m_entries = nullptr;
+    const UINT32* m_slots = nullptr;
+    const WCHAR* m_names = nullptr;
+};
+
+// Offline builder used by the AssetTools project.
+class AssetArchiveWriter
+{
+public:
+    static const UINT64 DefaultPayloadAlignment = 64 * 1024;
+
+    void AddFile(const std::wstring& name, const std::wstring& filename);
+    void AddData(const std::wstring& name, std::vector<BYTE> data);
+
+    // payloadAlignment must be a power of two, typically 512 or 64 KiB.
+    // With compress, payloads are stored compressed when that makes them smaller.
+    void Write(const std::wstring& filename, UINT64 payloadAlignment = DefaultPayloadAlignment, bool compress = false);
+
+private:
+    struct Source
+    {
+        std::wstring Name;
+        std::wstring Filename;
+        std::vector<BYTE> Data;
+    };
+
+    std::vector<Source> m_sources;
+};
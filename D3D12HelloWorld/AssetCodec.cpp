@@ -0,0 +1,188 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#endif
+#include "AssetCodec.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iterator>
+
+static const size_t MinMatchLength = 4;
+static const unsigned HashBits = 12;
+static const uint32_t EmptySlot = UINT32_MAX;
+
+static uint32_t HashSequence(const uint8_t* data)
+{
+    uint32_t sequence;
+    memcpy(&sequence, data, sizeof(sequence));
+    return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+static bool WriteLength(uint8_t*& dst, const uint8_t* dstEnd, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (dst == dstEnd)
+        {
+            return false;
+        }
+        *dst++ = 255;
+    }
+    if (dst == dstEnd)
+    {
+        return false;
+    }
+    *dst++ = static_cast<uint8_t>(length);
+    return true;
+}
+
+static bool ReadLength(const uint8_t*& src, const uint8_t* srcEnd, size_t& length)
+{
+    uint8_t value;
+    do
+    {
+        if (src == srcEnd)
+        {
+            return false;
+        }
+        value = *src++;
+        length += value;
+    } while (value == 255);
+    return true;
+}
+
+// Literals followed by a match, or just literals when matchLength is 0.
+static bool WriteSequence(uint8_t*& dst, const uint8_t* dstEnd, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+{
+    if (dst == dstEnd)
+    {
+        return false;
+    }
+    const size_t matchCode = matchLength ? matchLength - MinMatchLength : 0;
+    *dst++ = static_cast<uint8_t>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15));
+    if (literalCount >= 15 && !WriteLength(dst, dstEnd, literalCount - 15))
+    {
+        return false;
+    }
+    if (static_cast<size_t>(dstEnd - dst) < literalCount)
+    {
+        return false;
+    }
+    memcpy(dst, literals, literalCount);
+    dst += literalCount;
+
+    if (matchLength == 0)
+    {
+        return true;
+    }
+    if (dstEnd - dst < 2)
+    {
+        return false;
+    }
+    *dst++ = static_cast<uint8_t>(offset);
+    *dst++ = static_cast<uint8_t>(offset >> 8);
+    return matchCode < 15 || WriteLength(dst, dstEnd, matchCode - 15);
+}
+
+size_t CompressAssetChunk(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+    assert(srcSize <= AssetChunkSize);
+
+    uint32_t table[1 << HashBits];
+    std::fill(std::begin(table), std::end(table), EmptySlot);
+
+    uint8_t* out = dst;
+    const uint8_t* outEnd = dst + dstCapacity;
+    size_t anchor = 0;
+    size_t position = 0;
+    while (position + MinMatchLength <= srcSize)
+    {
+        const uint32_t hash = HashSequence(src + position);
+        const uint32_t candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(position);
+
+        if (candidate == EmptySlot || position - candidate > 0xffff ||
+            memcmp(src + candidate, src + position, MinMatchLength) != 0)
+        {
+            position++;
+            continue;
+        }
+
+        size_t matchLength = MinMatchLength;
+        while (position + matchLength < srcSize && src[candidate + matchLength] == src[position + matchLength])
+        {
+            matchLength++;
+        }
+        if (!WriteSequence(out, outEnd, src + anchor, position - anchor, position - candidate, matchLength))
+        {
+            return 0;
+        }
+        position += matchLength;
+        anchor = position;
+    }
+
+    if (!WriteSequence(out, outEnd, src + anchor, srcSize - anchor, 0, 0))
+    {
+        return 0;
+    }
+    const size_t compressedSize = out - dst;
+    return compressedSize < dstCapacity ? compressedSize : 0;
+}
+
+bool DecompressAssetChunk(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    const uint8_t* in = src;
+    const uint8_t* inEnd = src + srcSize;
+    uint8_t* out = dst;
+    uint8_t* outEnd = dst + dstSize;
+
+    while (in < inEnd)
+    {
+        const uint8_t token = *in++;
+
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !ReadLength(in, inEnd, literalCount))
+        {
+            return false;
+        }
+        if (static_cast<size_t>(inEnd - in) < literalCount || static_cast<size_t>(outEnd - out) < literalCount)
+        {
+            return false;
+        }
+        memcpy(out, in, literalCount);
+        in += literalCount;
+        out += literalCount;
+
+        // The last sequence ends after its literals.
+        if (in == inEnd)
+        {
+            break;
+        }
+
+        if (inEnd - in < 2)
+        {
+            return false;
+        }
+        const size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+        {
+            return false;
+        }
+        matchLength += MinMatchLength;
+        if (offset == 0 || offset > static_cast<size_t>(out - dst) || static_cast<size_t>(outEnd - out) < matchLength)
+        {
+            return false;
+        }
+
+        // Byte by byte, the match may overlap what it produces.
+        const uint8_t* match = out - offset;
+        for (size_t i = 0; i < matchLength; i++)
+        {
+            out[i] = match[i];
+        }
+        out += matchLength;
+    }
+    return out == outEnd;
+}
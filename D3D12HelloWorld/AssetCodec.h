@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Byte oriented LZ77 codec for archive payloads, in the spirit of LZ4.
+// Payloads are split into independent chunks so they can be decoded in
+// parallel and straight into their destination.
+//
+// A chunk is a sequence of
+//   token           high nibble literal count, low nibble match length - 4,
+//                   15 means more length bytes follow (255 continues)
+//   literals
+//   UINT16 offset   back reference distance, omitted after the last literals
+static const uint32_t AssetChunkSize = 64 * 1024;
+
+// Compress one chunk of at most AssetChunkSize bytes.
+// Returns the compressed size, or 0 if it would not be smaller than dstCapacity.
+size_t CompressAssetChunk(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+// Returns false if the chunk is corrupt or does not decode to exactly dstSize bytes.
+bool DecompressAssetChunk(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
@@ -0,0 +1,216 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#include "AssetArchive.h"
+#endif
+#include "AsyncIoService.h"
+#include <cassert>
+#include <exception>
+#include <iterator>
+#include <mutex>
+
+AsyncIoService::AsyncIoService(uint32_t threadCount) :
+    m_decodeWorkers(0),
+    m_workers(threadCount)
+{
+}
+
+AsyncIoService::~AsyncIoService()
+{
+    // Nobody will dispatch anymore, skip whatever has not been read yet.
+    std::lock_guard<std::mutex> lock(m_lock);
+    for (auto& request : m_requests)
+    {
+        request.second->Cancelled = true;
+    }
+}
+
+IoRequestId AsyncIoService::ReadFile(const std::wstring& filename, IoPriority priority, IoCompletion completion)
+{
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->Filename = filename;
+    request->Completion = std::move(completion);
+    return Submit(request, priority);
+}
+
+IoRequestId AsyncIoService::ReadArchiveAsset(const std::shared_ptr<AssetArchive>& archive, const std::wstring& assetName, IoPriority priority, IoCompletion completion)
+{
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->Filename = assetName;
+    request->Archive = archive;
+    request->Completion = std::move(completion);
+    return Submit(request, priority);
+}
+
+IoRequestId AsyncIoService::Submit(const std::shared_ptr<Request>& request, IoPriority priority)
+{
+    request->Cancelled = false;
+    request->Queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        request->Id = m_nextId++;
+        m_requests[request->Id] = request;
+    }
+
+    m_workers.Submit([this, request]() { ExecuteRequest(request); }, static_cast<int>(priority));
+    return request->Id;
+}
+
+bool AsyncIoService::Cancel(IoRequestId id)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_requests.find(id);
+    if (it == m_requests.end() || it->second->Queued)
+    {
+        return false;
+    }
+    it->second->Cancelled = true;
+    return true;
+}
+
+void AsyncIoService::ExecuteRequest(const std::shared_ptr<Request>& request)
+{
+    IoResult result;
+    result.Id = request->Id;
+    result.Filename = request->Filename;
+
+    if (request->Cancelled)
+    {
+        result.Status = IoStatusAborted;
+    }
+    else
+    {
+        try
+        {
+            Read(request->Filename, request->Archive, result);
+
+            // Mapping is lazy. Touch every page here so the actual disk reads
+            // happen on this thread and not when the frame loop uses the data.
+            volatile uint8_t sink = 0;
+            for (uint64_t offset = 0; !result.Decoded && offset < result.Data.Size && !request->Cancelled; offset += 4096)
+            {
+                sink += result.Data.Data[offset];
+            }
+        }
+#ifdef _WIN32
+        catch (const HrException& e)
+        {
+            result.Status = e.Error();
+        }
+#endif
+        catch (const std::exception&)
+        {
+            // Nothing may escape a pool task, the request still completes.
+            result.Status = IoStatusFailed;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    // Cancel returned true for anything cancelled up to here, including while
+    // paging in, so it completes with E_ABORT even if the read finished.
+    if (request->Cancelled && result.Status != IoStatusAborted)
+    {
+        result.Status = IoStatusAborted;
+        result.Data = ByteSpan();
+        result.File.reset();
+        result.Archive.reset();
+        result.Decoded.reset();
+    }
+    request->Queued = true;
+    Completion completion;
+    completion.Result = std::move(result);
+    completion.Callback = std::move(request->Completion);
+    m_completions.push_back(std::move(completion));
+}
+
+IoResult AsyncIoService::ReadNow(const std::wstring& filename, const std::shared_ptr<AssetArchive>& archive)
+{
+    IoResult result;
+    result.Filename = filename;
+    try
+    {
+        Read(filename, archive, result);
+    }
+#ifdef _WIN32
+    catch (const HrException& e)
+    {
+        result.Status = e.Error();
+    }
+#endif
+    catch (const std::exception&)
+    {
+        result.Status = IoStatusFailed;
+    }
+    return result;
+}
+
+void AsyncIoService::Read(const std::wstring& filename, const std::shared_ptr<AssetArchive>& archive, IoResult& result)
+{
+#ifdef _WIN32
+    if (archive)
+    {
+        const AssetArchiveEntry* entry = archive->Find(filename.c_str());
+        if (!entry)
+        {
+            ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+        }
+        result.Archive = archive;
+        if (AssetArchive::IsCompressed(*entry))
+        {
+            // Decoding reads every page itself.
+            result.Decoded = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(entry->Size));
+            result.Archive->Decode(*entry, result.Decoded->data(), &m_decodeWorkers);
+            result.Data.Data = result.Decoded->data();
+            result.Data.Size = entry->Size;
+        }
+        else
+        {
+            result.Data = result.Archive->GetData(*entry);
+        }
+        return;
+    }
+#else
+    // Archives are only built on Windows, there is none to read from here.
+    assert(!archive);
+#endif
+    result.File = std::make_shared<MappedFile>(filename);
+    result.Data = result.File->GetSpan();
+}
+
+uint32_t AsyncIoService::DispatchCompletions(uint32_t maxCompletions)
+{
+    std::vector<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_completions.size() <= maxCompletions)
+        {
+            completions.swap(m_completions);
+        }
+        else
+        {
+            completions.assign(
+                std::make_move_iterator(m_completions.begin()),
+                std::make_move_iterator(m_completions.begin() + maxCompletions));
+            m_completions.erase(m_completions.begin(), m_completions.begin() + maxCompletions);
+        }
+        for (const Completion& completion : completions)
+        {
+            m_requests.erase(completion.Result.Id);
+        }
+    }
+
+    // Callbacks run without the lock so they can issue new requests.
+    for (Completion& completion : completions)
+    {
+        if (completion.Callback)
+        {
+            completion.Callback(completion.Result);
+        }
+    }
+    return static_cast<uint32_t>(completions.size());
+}
+
+uint32_t AsyncIoService::GetPendingCount()const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return static_cast<uint32_t>(m_requests.size());
+}
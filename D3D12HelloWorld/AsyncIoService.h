@@ -0,0 +1,114 @@
+#pragma once
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AssetArchive;
+
+enum class IoPriority
+{
+    Low = 0,
+    Normal,
+    High
+};
+
+typedef uint64_t IoRequestId;
+
+// Status values, HRESULTs so Windows code can hand them to ThrowIfFailed.
+static const int32_t IoStatusOk = 0;                                        // S_OK
+static const int32_t IoStatusAborted = static_cast<int32_t>(0x80004004);    // E_ABORT
+static const int32_t IoStatusFailed = static_cast<int32_t>(0x80004005);     // E_FAIL
+
+struct IoResult
+{
+    IoRequestId Id = 0;
+    std::wstring Filename;
+
+    // S_OK, E_ABORT when cancelled, or the error opening the file. Errors
+    // that are not an HrException, such as the std::system_error MappedFile
+    // throws outside Windows, are E_FAIL.
+    int32_t Status = IoStatusOk;
+
+    // Data is valid while File, Archive or Decoded, whichever holds it, is alive.
+    // Compressed archive assets arrive already decoded.
+    ByteSpan Data;
+    std::shared_ptr<MappedFile> File;
+    std::shared_ptr<AssetArchive> Archive;
+    std::shared_ptr<std::vector<uint8_t>> Decoded;
+};
+
+typedef std::function<void(const IoResult&)> IoCompletion;
+
+// Loads files on worker threads so asset loading never blocks frame production.
+// Requests are served by priority. Completion callbacks are queued and only run
+// when the frame loop calls DispatchCompletions(), on the frame loop thread.
+// Asset archives store UTF-16 names and are only read on Windows, loose
+// files everywhere.
+class AsyncIoService
+{
+public:
+    explicit AsyncIoService(uint32_t threadCount = 2);
+    ~AsyncIoService();
+
+    AsyncIoService(const AsyncIoService& rhs) = delete;
+    AsyncIoService& operator=(const AsyncIoService& rhs) = delete;
+
+    IoRequestId ReadFile(const std::wstring& filename, IoPriority priority, IoCompletion completion);
+
+    // Serves an asset out of an already mapped archive, only paging in its payload.
+    // Completes with HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) if the archive has no such asset.
+    IoRequestId ReadArchiveAsset(const std::shared_ptr<AssetArchive>& archive, const std::wstring& assetName, IoPriority priority, IoCompletion completion);
+
+    // Reads on the calling thread, for code that already runs on a worker.
+    // Same rules as the asynchronous reads, an archive is used when given.
+    // Errors are returned in Status rather than thrown.
+    IoResult ReadNow(const std::wstring& filename, const std::shared_ptr<AssetArchive>& archive = nullptr);
+
+    // The request completes with E_ABORT, even if it was already read.
+    // Returns false and changes nothing once its completion is queued, or if
+    // the id is unknown.
+    bool Cancel(IoRequestId id);
+
+    // Run queued completion callbacks. Returns how many were run.
+    uint32_t DispatchCompletions(uint32_t maxCompletions = UINT_MAX);
+
+    // Requests issued but whose completion has not been dispatched yet.
+    uint32_t GetPendingCount()const;
+
+private:
+    struct Request
+    {
+        IoRequestId Id;
+        std::wstring Filename;
+        std::shared_ptr<AssetArchive> Archive;
+        IoCompletion Completion;
+        std::atomic<bool> Cancelled;
+        bool Queued;    // The completion has its final status, guarded by m_lock.
+    };
+
+    struct Completion
+    {
+        IoResult Result;
+        IoCompletion Callback;
+    };
+
+    IoRequestId Submit(const std::shared_ptr<Request>& request, IoPriority priority);
+    void ExecuteRequest(const std::shared_ptr<Request>& request);
+    void Read(const std::wstring& filename, const std::shared_ptr<AssetArchive>& archive, IoResult& result);
+
+    std::unordered_map<IoRequestId, std::shared_ptr<Request>> m_requests;
+    std::vector<Completion> m_completions;
+    IoRequestId m_nextId = 1;
+    mutable std::mutex m_lock;
+
+    // Splits decoding of compressed assets across cores.
+    ThreadPool m_decodeWorkers;
+
+    // Declared last so workers are joined before the state they use goes away.
+    ThreadPool m_workers;
+};
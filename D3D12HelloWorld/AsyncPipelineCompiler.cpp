@@ -0,0 +1,222 @@
+#include "stdafx.h"
+#include "AsyncPipelineCompiler.h"
+#include "PipelineStateHash.h"
+
+struct PipelineHandle::State
+{
+    std::atomic<PipelineStatus> Status;
+    ComPtr<ID3D12PipelineState> Pipeline;   // Written before Status becomes Ready.
+    ComPtr<ID3D12PipelineState> Fallback;
+    HRESULT Error = S_OK;
+
+    std::mutex Lock;
+    std::condition_variable Finished;
+};
+
+PipelineStatus PipelineHandle::GetStatus()const
+{
+    assert(m_state);
+    return m_state->Status.load(std::memory_order_acquire);
+}
+
+ID3D12PipelineState* PipelineHandle::Get()const
+{
+    if (!m_state)
+    {
+        return nullptr;
+    }
+    if (m_state->Status.load(std::memory_order_acquire) == PipelineStatus::Ready)
+    {
+        return m_state->Pipeline.Get();
+    }
+    return m_state->Fallback.Get();
+}
+
+HRESULT PipelineHandle::GetError()const
+{
+    assert(m_state);
+    std::lock_guard<std::mutex> lock(m_state->Lock);
+    return m_state->Error;
+}
+
+void PipelineHandle::Wait()const
+{
+    assert(m_state);
+    std::unique_lock<std::mutex> lock(m_state->Lock);
+    m_state->Finished.wait(lock, [this] { return m_state->Status != PipelineStatus::Pending; });
+}
+
+// A desc with everything it points to copied next to it.
+struct AsyncPipelineCompiler::Request
+{
+    UINT64 Key;
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+    ComPtr<ID3D12RootSignature> RootSignature;
+    std::vector<BYTE> Shaders[5];
+    std::vector<D3D12_INPUT_ELEMENT_DESC> InputElements;
+    std::vector<D3D12_SO_DECLARATION_ENTRY> StreamOutputEntries;
+    std::vector<UINT> StreamOutputStrides;
+    std::vector<std::string> SemanticNames;
+    std::shared_ptr<PipelineHandle::State> State;
+};
+
+// Shared with the pool tasks, which can outlive the compiler.
+struct AsyncPipelineCompiler::Queue
+{
+    PipelineCreateFunction Create;
+    std::unordered_map<UINT64, std::shared_ptr<PipelineHandle::State>> InFlight;
+    UINT Running = 0;
+    bool Stopping = false;
+
+    mutable std::mutex Lock;
+    std::condition_variable Idle;
+};
+
+static D3D12_SHADER_BYTECODE CopyShader(const D3D12_SHADER_BYTECODE& shader, std::vector<BYTE>& storage)
+{
+    const BYTE* bytes = static_cast<const BYTE*>(shader.pShaderBytecode);
+    if (!bytes)
+    {
+        return shader;
+    }
+    storage.assign(bytes, bytes + shader.BytecodeLength);
+    return { storage.data(), storage.size() };
+}
+
+AsyncPipelineCompiler::AsyncPipelineCompiler(ThreadPool* pool, PipelineCreateFunction create) :
+    m_pool(pool),
+    m_queue(std::make_shared<Queue>())
+{
+    m_queue->Create = std::move(create);
+}
+
+AsyncPipelineCompiler::~AsyncPipelineCompiler()
+{
+    // Whatever create refers to may be destroyed right after this.
+    std::unique_lock<std::mutex> lock(m_queue->Lock);
+    m_queue->Stopping = true;
+    m_queue->Idle.wait(lock, [this] { return m_queue->Running == 0; });
+}
+
+PipelineHandle AsyncPipelineCompiler::Compile(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState* fallback, int priority)
+{
+    std::shared_ptr<Request> request = std::make_shared<Request>();
+    request->Key = HashGraphicsPipelineStateDesc(desc, reinterpret_cast<UINT64>(desc.pRootSignature));
+
+    PipelineHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(m_queue->Lock);
+        auto it = m_queue->InFlight.find(request->Key);
+        if (it != m_queue->InFlight.end())
+        {
+            handle.m_state = it->second;
+            return handle;
+        }
+
+        handle.m_state = std::make_shared<PipelineHandle::State>();
+        handle.m_state->Status = PipelineStatus::Pending;
+        handle.m_state->Fallback = fallback;
+        m_queue->InFlight[request->Key] = handle.m_state;
+    }
+    request->State = handle.m_state;
+
+    Request& copy = *request;
+    copy.Desc = desc;
+    copy.RootSignature = desc.pRootSignature;
+    copy.Desc.VS = CopyShader(desc.VS, copy.Shaders[0]);
+    copy.Desc.PS = CopyShader(desc.PS, copy.Shaders[1]);
+    copy.Desc.DS = CopyShader(desc.DS, copy.Shaders[2]);
+    copy.Desc.HS = CopyShader(desc.HS, copy.Shaders[3]);
+    copy.Desc.GS = CopyShader(desc.GS, copy.Shaders[4]);
+    copy.Desc.CachedPSO = {};
+
+    // Names are copied first, the vector must not grow once pointers into it are taken.
+    const UINT inputCount = desc.InputLayout.pInputElementDescs ? desc.InputLayout.NumElements : 0;
+    const UINT streamOutputCount = desc.StreamOutput.pSODeclaration ? desc.StreamOutput.NumEntries : 0;
+    copy.SemanticNames.reserve(inputCount + streamOutputCount);
+    copy.InputElements.assign(desc.InputLayout.pInputElementDescs, desc.InputLayout.pInputElementDescs + inputCount);
+    for (D3D12_INPUT_ELEMENT_DESC& element : copy.InputElements)
+    {
+        copy.SemanticNames.push_back(element.SemanticName);
+        element.SemanticName = copy.SemanticNames.back().c_str();
+    }
+    copy.Desc.InputLayout = { copy.InputElements.data(), inputCount };
+
+    copy.StreamOutputEntries.assign(desc.StreamOutput.pSODeclaration, desc.StreamOutput.pSODeclaration + streamOutputCount);
+    for (D3D12_SO_DECLARATION_ENTRY& entry : copy.StreamOutputEntries)
+    {
+        if (entry.SemanticName)
+        {
+            copy.SemanticNames.push_back(entry.SemanticName);
+            entry.SemanticName = copy.SemanticNames.back().c_str();
+        }
+    }
+    if (desc.StreamOutput.pBufferStrides)
+    {
+        copy.StreamOutputStrides.assign(desc.StreamOutput.pBufferStrides, desc.StreamOutput.pBufferStrides + desc.StreamOutput.NumStrides);
+    }
+    copy.Desc.StreamOutput.pSODeclaration = copy.StreamOutputEntries.empty() ? nullptr : copy.StreamOutputEntries.data();
+    copy.Desc.StreamOutput.pBufferStrides = copy.StreamOutputStrides.empty() ? nullptr : copy.StreamOutputStrides.data();
+
+    std::shared_ptr<Queue> queue = m_queue;
+    m_pool->Submit([queue, request]() { Execute(queue, request); }, priority);
+    return handle;
+}
+
+UINT AsyncPipelineCompiler::GetPendingCount()const
+{
+    std::lock_guard<std::mutex> lock(m_queue->Lock);
+    return static_cast<UINT>(m_queue->InFlight.size());
+}
+
+void AsyncPipelineCompiler::Execute(const std::shared_ptr<Queue>& queue, const std::shared_ptr<Request>& request)
+{
+    bool stopping;
+    {
+        std::lock_guard<std::mutex> lock(queue->Lock);
+        stopping = queue->Stopping;
+        if (!stopping)
+        {
+            queue->Running++;
+        }
+    }
+
+    ComPtr<ID3D12PipelineState> pipeline;
+    HRESULT error = stopping ? E_ABORT : S_OK;
+    if (!stopping)
+    {
+        try
+        {
+            pipeline = queue->Create(request->Desc);
+        }
+        catch (const HrException& e)
+        {
+            error = e.Error();
+        }
+        catch (...)
+        {
+            // Nothing may escape a pool task, and Running has to come down below.
+            error = E_FAIL;
+        }
+        if (SUCCEEDED(error) && !pipeline)
+        {
+            error = E_FAIL;
+        }
+    }
+
+    PipelineHandle::State& state = *request->State;
+    {
+        std::lock_guard<std::mutex> lock(state.Lock);
+        state.Error = error;
+        state.Pipeline = pipeline;
+        state.Status.store(SUCCEEDED(error) ? PipelineStatus::Ready : PipelineStatus::Failed, std::memory_order_release);
+    }
+    state.Finished.notify_all();
+
+    std::lock_guard<std::mutex> lock(queue->Lock);
+    queue->InFlight.erase(request->Key);
+    if (!stopping && --queue->Running == 0)
+    {
+        queue->Idle.notify_all();
+    }
+}
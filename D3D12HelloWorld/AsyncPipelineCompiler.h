@@ -0,0 +1,73 @@
+#pragma once
+#include "ThreadPool.h"
+#include "DXSampleHelper.h"
+
+enum class PipelineStatus
+{
+    Pending,    // Queued or being created.
+    Ready,
+    Failed
+};
+
+// Handle to a pipeline being created in the background. Cheap to copy and to
+// poll every frame, Get never blocks.
+class PipelineHandle
+{
+public:
+    PipelineHandle() = default;
+
+    bool IsValid()const { return m_state != nullptr; }
+    PipelineStatus GetStatus()const;
+    bool IsReady()const { return GetStatus() == PipelineStatus::Ready; }
+
+    // The pipeline once ready, the fallback until then or if creation failed.
+    // Null when there is neither, draws using it should be skipped then.
+    ID3D12PipelineState* Get()const;
+
+    // S_OK unless creation failed, E_ABORT if the compiler went away first.
+    HRESULT GetError()const;
+
+    // Blocks until the pipeline is ready or failed, for loading screens and tools.
+    void Wait()const;
+
+private:
+    friend class AsyncPipelineCompiler;
+    struct State;
+    std::shared_ptr<State> m_state;
+};
+
+typedef std::function<ComPtr<ID3D12PipelineState>(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)> PipelineCreateFunction;
+
+// Creates pipelines on worker threads so new variants never stall the frame
+// loop. The desc is copied, shader bytecode and input layout included, so the
+// caller's memory can go away right after Compile returns.
+//
+// Creation is injected, normally PipelineStateCache::GetOrCreate. A fake that
+// sleeps exercises the queue and the handle states without a device.
+class AsyncPipelineCompiler
+{
+public:
+    AsyncPipelineCompiler(ThreadPool* pool, PipelineCreateFunction create);
+
+    // Requests still queued complete with E_ABORT, running ones are waited for.
+    ~AsyncPipelineCompiler();
+
+    AsyncPipelineCompiler(const AsyncPipelineCompiler& rhs) = delete;
+    AsyncPipelineCompiler& operator=(const AsyncPipelineCompiler& rhs) = delete;
+
+    // A desc already in flight returns the handle of that request, fallback
+    // included. Higher priorities are created first.
+    PipelineHandle Compile(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState* fallback = nullptr, int priority = 0);
+
+    // Requests not finished yet.
+    UINT GetPendingCount()const;
+
+private:
+    struct Request;
+    struct Queue;
+
+    static void Execute(const std::shared_ptr<Queue>& queue, const std::shared_ptr<Request>& request);
+
+    ThreadPool* m_pool;
+    std::shared_ptr<Queue> m_queue;
+};
@@ -0,0 +1,47 @@
+#include "stdafx.h"
+#include "CommandListPool.h"
+
+CommandListPool::CommandListPool(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, const FenceSource& fence, UINT initialSize) :
+    m_device(device),
+    m_type(type),
+    m_contexts(fence)
+{
+    assert(m_device);
+
+    // Pre-create contexts so the first frames do not pay for creation.
+    for (UINT i = 0; i < initialSize; i++)
+    {
+        CommandContext* context = m_contexts.Add(CreateContext(nullptr));
+        ThrowIfFailed(context->CommandList->Close());
+        m_contexts.Release(context, 0);
+    }
+}
+
+std::unique_ptr<CommandContext> CommandListPool::CreateContext(ID3D12PipelineState* initialState)
+{
+    std::unique_ptr<CommandContext> context = std::make_unique<CommandContext>();
+    ThrowIfFailed(m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(&context->Allocator)));
+    ThrowIfFailed(m_device->CreateCommandList(
+        0,
+        m_type,
+        context->Allocator.Get(),
+        initialState,
+        IID_PPV_ARGS(&context->CommandList)
+    ));
+    return context;
+}
+
+CommandContext* CommandListPool::Acquire(ID3D12PipelineState* initialState)
+{
+    CommandContext* context = m_contexts.TryRecycle();
+    if (context)
+    {
+        // The GPU is done with it, so the memory can be reused.
+        ThrowIfFailed(context->Allocator->Reset());
+        ThrowIfFailed(context->CommandList->Reset(context->Allocator.Get(), initialState));
+        return context;
+    }
+
+    // Nothing has completed yet, grow the pool. A freshly created list is open.
+    return m_contexts.Add(CreateContext(initialState));
+}
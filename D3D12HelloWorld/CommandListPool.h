@@ -0,0 +1,60 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include "FencedPool.h"
+
+// A command allocator together with the command list recording into it.
+struct CommandContext
+{
+    ComPtr<ID3D12CommandAllocator> Allocator;
+    ComPtr<ID3D12GraphicsCommandList> CommandList;
+};
+
+// Completed value of a D3D12 fence. Reads the fence through the ComPtr, so
+// it can be set up before the fence is created.
+class D3D12FenceSource : public FenceSource
+{
+public:
+    explicit D3D12FenceSource(const ComPtr<ID3D12Fence>& fence) :
+        m_fence(fence)
+    {
+    }
+
+    virtual uint64_t GetCompletedValue()const override { return m_fence->GetCompletedValue(); }
+
+private:
+    const ComPtr<ID3D12Fence>& m_fence;
+};
+
+// Hands out allocator/list pairs for one queue type.
+// Contexts are returned tagged with the fence value of their submission and
+// are only recycled once fence has passed that value, so an allocator is
+// never reset while the GPU may still execute from its memory.
+class CommandListPool
+{
+public:
+    CommandListPool(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, const FenceSource& fence, UINT initialSize = 0);
+
+    CommandListPool(const CommandListPool& rhs) = delete;
+    CommandListPool& operator=(const CommandListPool& rhs) = delete;
+
+    // Get a context ready for recording. Its command list is open.
+    CommandContext* Acquire(ID3D12PipelineState* initialState = nullptr);
+
+    // Give a context back after its command list was closed and submitted.
+    // fenceValue is the value signaled on the queue after that submission.
+    void Release(CommandContext* context, UINT64 fenceValue) { m_contexts.Release(context, fenceValue); }
+
+    D3D12_COMMAND_LIST_TYPE GetType()const { return m_type; }
+
+    // Number of contexts ever created by this pool.
+    size_t GetCreatedCount()const { return m_contexts.GetCreatedCount(); }
+    // Number of contexts waiting in the pool, completed or not.
+    size_t GetRetiredCount()const { return m_contexts.GetRetiredCount(); }
+
+private:
+    std::unique_ptr<CommandContext> CreateContext(ID3D12PipelineState* initialState);
+
+    ID3D12Device* m_device;
+    D3D12_COMMAND_LIST_TYPE m_type;
+    FencedPool<CommandContext> m_contexts;
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include "stdafx.h"
+
+// C++ half of ConstantBufferSchema.hlsli. A schema file lists the fields of
+// a constant buffer once:
+//
+//     #define OBJECT_CONSTANTS_FIELDS(FIELD) FIELD(Float4x4, WorldViewProj)
+//     CONSTANT_BUFFER(ObjectConstants, 0, OBJECT_CONSTANTS_FIELDS)
+//
+// HLSL sees a cbuffer, C++ a struct of the same name whose layout is checked
+// against the HLSL packing rules at compile time. Fields never straddle a 16
+// byte register and matrices start a new one; when the C++ layout differs,
+// reorder the fields or add explicit padding fields. Matrices are row_major
+// on both sides, so they upload without a transpose.
+namespace ConstantBufferTypes
+{
+    typedef float Float;
+    typedef DirectX::XMFLOAT2 Float2;
+    typedef DirectX::XMFLOAT3 Float3;
+    typedef DirectX::XMFLOAT4 Float4;
+    typedef INT Int;
+    typedef DirectX::XMINT2 Int2;
+    typedef DirectX::XMINT3 Int3;
+    typedef DirectX::XMINT4 Int4;
+    typedef UINT Uint;
+    typedef DirectX::XMUINT2 Uint2;
+    typedef DirectX::XMUINT3 Uint3;
+    typedef DirectX::XMUINT4 Uint4;
+    typedef DirectX::XMFLOAT4X4 Float4x4;
+
+    template<class T> struct StartsRegister { static constexpr bool Value = false; };
+    template<> struct StartsRegister<Float4x4> { static constexpr bool Value = true; };
+}
+
+struct ConstantBufferField
+{
+    UINT Offset;        // In the C++ struct.
+    UINT Size;
+    bool StartsRegister;
+};
+
+// True when every C++ offset is where HLSL puts the field and the struct has
+// no trailing padding, so uploads copy exactly what the shader reads.
+template<size_t N>
+constexpr bool MatchesHlslPacking(const ConstantBufferField(&fields)[N], size_t structSize)
+{
+    UINT offset = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+        if (fields[i].StartsRegister || (offset % 16) + fields[i].Size > 16)
+        {
+            offset = (offset + 15) & ~15u;
+        }
+        if (fields[i].Offset != offset)
+        {
+            return false;
+        }
+        offset += fields[i].Size;
+    }
+    return offset == structSize;
+}
+
+// Bytes a view of T covers. Views start on 256 byte boundaries, the rest
+// past sizeof(T) is never written nor read.
+template<class T>
+constexpr UINT GetConstantBufferViewSize()
+{
+    return (static_cast<UINT>(sizeof(T)) + (D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1)) &
+        ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+}
+
+#define CONSTANT_BUFFER_MEMBER(type, member) ConstantBufferTypes::type member;
+#define CONSTANT_BUFFER_FIELD(type, member) \
+    { static_cast<UINT>(offsetof(ConstantBufferType, member)), static_cast<UINT>(sizeof(ConstantBufferTypes::type)), \
+        ConstantBufferTypes::StartsRegister<ConstantBufferTypes::type>::Value },
+
+#define CONSTANT_BUFFER(name, slot, FIELDS) \
+    struct name \
+    { \
+        static constexpr UINT Register = slot; \
+        FIELDS(CONSTANT_BUFFER_MEMBER) \
+        static constexpr bool MatchesHlslPacking() \
+        { \
+            typedef name ConstantBufferType; \
+            const ConstantBufferField fields[] = { FIELDS(CONSTANT_BUFFER_FIELD) }; \
+            return ::MatchesHlslPacking(fields, sizeof(name)); \
+        } \
+    }; \
+    static_assert(name::MatchesHlslPacking(), #name " does not match the HLSL packing, reorder its fields or add padding");
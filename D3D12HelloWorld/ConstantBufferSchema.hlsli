@@ -0,0 +1,33 @@
+// Declares constant buffers for HLSL and C++ from one field list, see
+// ConstantBufferSchema.h for the C++ half and how to write a schema.
+#ifndef CONSTANT_BUFFER_SCHEMA_HLSLI
+#define CONSTANT_BUFFER_SCHEMA_HLSLI
+
+#ifdef __cplusplus
+#include "ConstantBufferSchema.h"
+#else
+
+#define Float float
+#define Float2 float2
+#define Float3 float3
+#define Float4 float4
+#define Int int
+#define Int2 int2
+#define Int3 int3
+#define Int4 int4
+#define Uint uint
+#define Uint2 uint2
+#define Uint3 uint3
+#define Uint4 uint4
+#define Float4x4 row_major float4x4
+
+#define CONSTANT_BUFFER_MEMBER(type, member) type member;
+#define CONSTANT_BUFFER(name, slot, FIELDS) \
+    cbuffer name : register(b##slot) \
+    { \
+        FIELDS(CONSTANT_BUFFER_MEMBER) \
+    };
+
+#endif
+
+#endif
@@ -5,6 +5,7 @@
 D3D12HelloTexture::D3D12HelloTexture(UINT width, UINT height, std::wstring name) :
     DXSample(width, height, name),
     m_frameIndex(0),
+    m_textureId(0),
     m_viewport(0.0f, 0.0f, static_cast<FLOAT>(width), static_cast<FLOAT>(height)),
     m_scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height)),
     m_rtvDescriptorSize(0)
@@ -61,6 +62,14 @@ void D3D12HelloTexture::LoadPipeline()
     queueDesc.Type = D3D12HelloTexture::CommandListType;
     ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
 
+    // This sample creates its device itself instead of going through
+    // CreateCommandObjects, so it creates the state caches and the frame's
+    // render graph here.
+    CreateStateCaches();
+    m_sceneRecorder = std::make_unique<ParallelCommandRecorder>(m_device.Get(), D3D12HelloTexture::CommandListType, FrameCount);
+    m_renderGraph = std::make_unique<RenderGraphExecutor>(m_device.Get(), *m_stateTracker, *m_sceneRecorder,
+        *m_jobSystem, FrameCount);
+
     // Create command allocator.
     ThrowIfFailed(m_device->CreateCommandAllocator(D3D12HelloTexture::CommandListType, IID_PPV_ARGS(&m_commandAllocators)));
 
@@ -120,6 +129,8 @@ void D3D12HelloTexture::LoadPipeline()
         {
             ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTarget[n])));
             m_device->CreateRenderTargetView(m_renderTarget[n].Get(), nullptr, rtvHandle);
+            GpuMemoryTracker::TrackResource(m_renderTarget[n].Get(), GpuMemoryCategory::RenderTarget, L"m_renderTarget");
+            m_stateTracker->Register(m_renderTarget[n].Get(), D3D12_RESOURCE_STATE_PRESENT);
             rtvHandle.Offset(1, m_rtvDescriptorSize);
         }
     }
@@ -131,16 +142,7 @@ void D3D12HelloTexture::LoadAssets()
 {
     // Create the root signature.
     {
-        D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
-
-        // This is the highest version the sample supports. 
-        // If CheckFeatureSupport succeeds, the HighestVersion 
-        // returned will not be greater than this.
-        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-        if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
-        {
-            featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
-        }
+        // The root signature cache serializes at the highest version the device supports.
         CD3DX12_DESCRIPTOR_RANGE1 ranges[1] = {};
         ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC);
         CD3DX12_ROOT_PARAMETER1 rootParameters[1];
@@ -166,25 +168,17 @@ void D3D12HelloTexture::LoadAssets()
             _countof(rootParameters), rootParameters, 1,
             &sampler, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
         );
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> error;
-        ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDesc, featureData.HighestVersion, &signature, &error));
-        ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
-
+        m_rootSignature = CreateRootSignature(rootSignatureDesc);
     }
 
     // Create the pipeline state, which includes compiling and loading shaders.
     {
         ComPtr<ID3DBlob> vertexShader;
         ComPtr<ID3DBlob> pixelShader;
-#if defined(_DEBUG)
-        // Enable better shader debugging with the graphics debugging tools.
-        UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-        UINT compileFlags = 0;
-#endif
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
+        // Debug builds compile with debug info, the shader cache skips unchanged shaders.
+        MappedFile source(GetAssetFullPath(L"shaders.hlsl"));
+        vertexShader = CompileShaderCached("shaders.hlsl", source.GetSpan(), "VSMain", "vs_5_0");
+        pixelShader = CompileShaderCached("shaders.hlsl", source.GetSpan(), "PSMain", "ps_5_0");
 
         // Define the vertex input layout.
         D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
@@ -208,7 +202,7 @@ void D3D12HelloTexture::LoadAssets()
         psoDesc.NumRenderTargets = 1;
         psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
         psoDesc.SampleDesc.Count = 1;
-        ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
+        m_pipelineState = m_pipelineStateCache->GetOrCreate(psoDesc);
     }
     // Create command list.
     ThrowIfFailed(m_device->CreateCommandList(
@@ -236,6 +230,7 @@ void D3D12HelloTexture::LoadAssets()
             nullptr,
             IID_PPV_ARGS(&m_vertexBuffer)
         ));
+        GpuMemoryTracker::TrackResource(m_vertexBuffer.Get(), GpuMemoryCategory::Buffer, L"m_vertexBuffer");
 
         // Copy triangle data to the vertex buffer.
         UINT8* pVertexDataBegin;
@@ -252,17 +247,16 @@ void D3D12HelloTexture::LoadAssets()
     }
 
 
-    // Note: ComPtr's are CPU objects but this resource needs to stay in scope until
-    // the command list that references it has finished executing on the GPU.
-    // We will flush the GPU at the end of the method to ensure the resource is not 
-    // prematurely destroyed.
-    ComPtr<ID3D12Resource> textureUploadHeap;
+    // The texture is streamed in on the copy queue over several frames. The
+    // upload engine keeps its staging memory alive until the copies have finished.
+    m_uploadEngine = std::make_unique<UploadEngine>(m_device.Get(), m_workerPool.get());
+    m_textureStreamer = std::make_unique<TextureStreamer>(m_device.Get(), m_uploadEngine.get(), TextureStreamingBytesPerFrame);
 
     // Create the texture.
     {
         // Describe and create a Texture2D
         D3D12_RESOURCE_DESC textureDesc = {};
-        textureDesc.MipLevels = 1;
+        textureDesc.MipLevels = TextureMipLevels;
         textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
         textureDesc.Width = TextureWidth;
         textureDesc.Height = TextureHeight;
@@ -276,45 +270,17 @@ void D3D12HelloTexture::LoadAssets()
             &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
             D3D12_HEAP_FLAG_NONE,
             &textureDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
+            D3D12_RESOURCE_STATE_COMMON,
             nullptr,
             IID_PPV_ARGS(&m_texture)
         ));
+        GpuMemoryTracker::TrackResource(m_texture.Get(), GpuMemoryCategory::Texture, L"m_texture");
 
-        const UINT64 uploadBufferSize = GetRequiredIntermediateSize(m_texture.Get(), 0, 1);
-
-        // Create the GPU upload buffer.
-        ThrowIfFailed(m_device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(&textureUploadHeap)
-        ));
-
-        // Copy data to the intermediate upload heap and then schedule a copy
-        // from the upload heap to the Texture2D.
-        std::vector<UINT8> texture = GenerateTextureData();
-        D3D12_SUBRESOURCE_DATA textureData = {};
-        textureData.pData = &(*texture.begin());
-        textureData.RowPitch = TextureWidth * TexturePixelSize;
-        textureData.SlicePitch = TextureHeight * TexturePixelSize;
-
-        UpdateSubresources(m_commandList.Get(), m_texture.Get(), textureUploadHeap.Get(), NULL, 0, 1, &textureData);
-        m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_texture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
-
-        // Describe and create a SRV for the texture.
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.Format = textureDesc.Format;
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = 1;
-        m_device->CreateShaderResourceView(
-            m_texture.Get(),
-            &srvDesc,
-            m_srvHeap->GetCPUDescriptorHandleForHeapStart()
-        );
+        // The streamer uploads the mips smallest first from the copy queue and
+        // writes the SRV, which only ever covers the mips that have landed.
+        // Mips decay back to COMMON after their copy and are promoted to a pixel
+        // shader resource on first use.
+        m_textureId = m_textureStreamer->Add(m_texture.Get(), GenerateTextureMips(), m_srvHeap->GetCPUDescriptorHandleForHeapStart());
     }
 
     // Close the command list and execute it to begin the initial GPU setup.
@@ -324,7 +290,8 @@ void D3D12HelloTexture::LoadAssets()
 
 
 
-    // Create synchronization objects and wait until assets have been uploaded to the GPU.
+    // Create synchronization objects. The texture upload is not waited for,
+    // frames skip the draw until the streamer reports a resident mip.
     {
         ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
         m_fenceValues = 1;
@@ -378,6 +345,47 @@ std::vector<UINT8> D3D12HelloTexture::GenerateTextureData()
     return data;
 }
 
+// Build the full mip chain with a 2x2 box filter.
+std::vector<TextureMipData> D3D12HelloTexture::GenerateTextureMips()
+{
+    std::vector<TextureMipData> mips(TextureMipLevels);
+    mips[0].Pixels = GenerateTextureData();
+    mips[0].RowPitch = TextureWidth * TexturePixelSize;
+
+    for (UINT mip = 1; mip < TextureMipLevels; mip++)
+    {
+        const TextureMipData& source = mips[mip - 1];
+        const UINT width = std::max(1u, TextureWidth >> mip);
+        const UINT height = std::max(1u, TextureHeight >> mip);
+        const UINT sourceWidth = std::max(1u, TextureWidth >> (mip - 1));
+        const UINT sourceHeight = std::max(1u, TextureHeight >> (mip - 1));
+
+        TextureMipData& data = mips[mip];
+        data.RowPitch = width * TexturePixelSize;
+        data.Pixels.resize(data.RowPitch * height);
+        for (UINT y = 0; y < height; y++)
+        {
+            const UINT y0 = std::min(y * 2, sourceHeight - 1);
+            const UINT y1 = std::min(y * 2 + 1, sourceHeight - 1);
+            for (UINT x = 0; x < width; x++)
+            {
+                const UINT x0 = std::min(x * 2, sourceWidth - 1);
+                const UINT x1 = std::min(x * 2 + 1, sourceWidth - 1);
+                for (UINT c = 0; c < TexturePixelSize; c++)
+                {
+                    const UINT sum =
+                        source.Pixels[y0 * source.RowPitch + x0 * TexturePixelSize + c] +
+                        source.Pixels[y0 * source.RowPitch + x1 * TexturePixelSize + c] +
+                        source.Pixels[y1 * source.RowPitch + x0 * TexturePixelSize + c] +
+                        source.Pixels[y1 * source.RowPitch + x1 * TexturePixelSize + c];
+                    data.Pixels[y * data.RowPitch + x * TexturePixelSize + c] = static_cast<UINT8>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+    return mips;
+}
+
 // Update frame-based values.
 void D3D12HelloTexture::OnUpdate()
 {
@@ -387,12 +395,15 @@ void D3D12HelloTexture::OnUpdate()
 // Render the scene.
 void D3D12HelloTexture::OnRender()
 {
+    // The previous frame has finished, so the texture view can be rewritten.
+    // Mips are only swapped in after the copy queue finished writing them.
+    m_textureStreamer->Update();
+
     // Record all the commands we need to render the scene into the command list.
     PopulateCommandList();
 
-    // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    // Execute the command lists.
+    m_sceneRecorder->Submit(m_commandQueue.Get());
 
     // Present the frame.
     ThrowIfFailed(m_swapChain->Present(1, 0));
@@ -406,48 +417,57 @@ void D3D12HelloTexture::OnDestroy()
     // cleaned up by the destructor.
     WaitForPreviousFrame();
 
+    // The copy queue may still be streaming into the texture.
+    UploadTicket uploads;
+    uploads.FenceValue = m_uploadEngine->Flush();
+    if (uploads.IsValid())
+    {
+        m_uploadEngine->WaitOnCpu(uploads);
+    }
+
     CloseHandle(m_fenceEvent);
 }
 
 void D3D12HelloTexture::PopulateCommandList()
 {
-    // Command list allocators can only be reset when the associated
-    // command lists have finished execution on the GPU. apps should use
-    // fences to determine GPU execution progress.
-    ThrowIfFailed(m_commandAllocators->Reset());
-
-    // However, when ExecuteCommandList() is called on a particular command 
-    // list, that command list can then be reset at any time and must be before 
-    // re-recording.
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators.Get(), m_pipelineState.Get()));
-
-    // Set necessary state.
-    m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-
-    ID3D12DescriptorHeap* ppHeaps[] = { m_srvHeap.Get() };
-    m_commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+    // WaitForPreviousFrame left the GPU idle, so every list can be reused.
+    m_sceneRecorder->BeginFrame(m_frameIndex);
+    m_renderGraph->Reset(m_frameIndex);
+
+    // One pass drawing into the back buffer. The streamed texture stays out
+    // of the graph, its mips are promoted from COMMON on first use.
+    const RenderGraphResource backBuffer = m_renderGraph->Import(L"BackBuffer", m_renderTarget[m_frameIndex].Get(), RenderGraphUsage_Present);
+    const RenderGraphPass texturePass = m_renderGraph->AddPass(L"Texture", [this](RenderGraphContext& context)
+    {
+        ID3D12GraphicsCommandList* commandList = context.GetCommandList();
 
-    m_commandList->SetGraphicsRootDescriptorTable(0, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
-    m_commandList->RSSetViewports(1, &m_viewport);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
+        // Set necessary state.
+        commandList->SetPipelineState(m_pipelineState.Get());
+        commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 
-    // Indicate that the back buffer will be used as a render target.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+        ID3D12DescriptorHeap* ppHeaps[] = { m_srvHeap.Get() };
+        commandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
-    m_commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
+        commandList->SetGraphicsRootDescriptorTable(0, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
+        commandList->RSSetViewports(1, &m_viewport);
+        commandList->RSSetScissorRects(1, &m_scissorRect);
 
-    // Record commands.
-    const float clearColor[] = { 0.0f,0.2f,0.4f,1.0f };
-    m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-    m_commandList->DrawInstanced(3, 1, 0, 0);
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(), m_frameIndex, m_rtvDescriptorSize);
+        commandList->OMSetRenderTargets(1, &rtvHandle, FALSE, nullptr);
 
-    // Indicate that the back buffer will now be used to present.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTarget[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+        // Record commands.
+        const float clearColor[] = { 0.0f,0.2f,0.4f,1.0f };
+        commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+        commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+        if (m_textureStreamer->IsResident(m_textureId))
+        {
+            commandList->DrawInstanced(3, 1, 0, 0);
+        }
+    });
+    m_renderGraph->Write(texturePass, backBuffer, RenderGraphUsage_RenderTarget);
 
-    ThrowIfFailed(m_commandList->Close());
+    m_renderGraph->Execute();
 }
 
 void D3D12HelloTexture::WaitForPreviousFrame()
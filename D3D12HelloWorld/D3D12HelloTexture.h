@@ -1,5 +1,6 @@
 #pragma once
 #include "DXSample.h"
+#include "TextureStreamer.h"
 
 using namespace DirectX;
 
@@ -22,9 +23,11 @@ public:
 
 private:
     static const UINT FrameCount = 2;
-    static const UINT TextureWidth = 256;
-    static const UINT TextureHeight = 256;
+    static const UINT TextureWidth = 2048;
+    static const UINT TextureHeight = 2048;
+    static const UINT TextureMipLevels = 12;
     static const UINT TexturePixelSize = 4;
+    static const UINT64 TextureStreamingBytesPerFrame = 1024 * 1024;
     static const D3D12_COMMAND_LIST_TYPE CommandListType = D3D12_COMMAND_LIST_TYPE::D3D12_COMMAND_LIST_TYPE_DIRECT;
 
     struct Vertex
@@ -37,10 +40,8 @@ private:
     CD3DX12_VIEWPORT m_viewport;
     CD3DX12_RECT m_scissorRect;
     ComPtr<IDXGISwapChain3> m_swapChain;
-    ComPtr<ID3D12Device> m_device;
     ComPtr<ID3D12Resource>m_renderTarget[FrameCount];
     ComPtr<ID3D12CommandAllocator> m_commandAllocators;
-    ComPtr<ID3D12CommandQueue> m_commandQueue;
     ComPtr<ID3D12RootSignature> m_rootSignature;
     ComPtr<ID3D12DescriptorHeap> m_rtvHeap;
     ComPtr<ID3D12DescriptorHeap> m_srvHeap;
@@ -52,6 +53,8 @@ private:
     ComPtr<ID3D12Resource> m_vertexBuffer;
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
     ComPtr<ID3D12Resource> m_texture;
+    std::unique_ptr<TextureStreamer> m_textureStreamer;
+    StreamedTextureId m_textureId;
 
     // Synchronization objects.
     ComPtr<ID3D12Fence> m_fence;
@@ -64,4 +67,5 @@ private:
     void PopulateCommandList();
     void WaitForPreviousFrame();
     std::vector<UINT8> GenerateTextureData();
+    std::vector<TextureMipData> GenerateTextureMips();
 };
\ No newline at end of file
@@ -67,6 +67,14 @@ void D3D12HelloTriangle::LoadPipeline()
 
 
     ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_commandQueue)));
+
+    // This sample creates its device itself instead of going through
+    // CreateCommandObjects, so it creates the state caches and the frame's
+    // render graph here.
+    CreateStateCaches();
+    m_sceneRecorder = std::make_unique<ParallelCommandRecorder>(m_device.Get(), D3D12_COMMAND_LIST_TYPE_DIRECT, FrameCount);
+    m_renderGraph = std::make_unique<RenderGraphExecutor>(m_device.Get(), *m_stateTracker, *m_sceneRecorder,
+        *m_jobSystem, FrameCount);
     
     // Describe and create the swap chain
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
@@ -115,11 +123,11 @@ void D3D12HelloTriangle::LoadPipeline()
         {
             ThrowIfFailed(m_swapChain->GetBuffer(n, IID_PPV_ARGS(&m_renderTargets[n])));
             m_device->CreateRenderTargetView(m_renderTargets[n].Get(), nullptr, rtvHandle);
+            GpuMemoryTracker::TrackResource(m_renderTargets[n].Get(), GpuMemoryCategory::RenderTarget, L"m_renderTargets");
+            m_stateTracker->Register(m_renderTargets[n].Get(), D3D12_RESOURCE_STATE_PRESENT);
             rtvHandle.Offset(1, m_rtvDescritorSize);
         }
     }
-
-    ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&m_commandAllocators)));
 }
 
 // Load the sample assets.
@@ -127,14 +135,10 @@ void D3D12HelloTriangle::LoadAssets()
 {
     // Create an empty root signature.
     {
-        CD3DX12_ROOT_SIGNATURE_DESC rootSignatureDesc;
-        rootSignatureDesc.Init(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-        
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> error;
-        ThrowIfFailed(D3D12SerializeRootSignature(&rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION_1, &signature, &error));
-        ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
+        rootSignatureDesc.Init_1_0(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
+        m_rootSignature = CreateRootSignature(rootSignatureDesc);
     }
 
     // Create the pipeline state, which includes compiling and loading shaders.
@@ -142,15 +146,10 @@ void D3D12HelloTriangle::LoadAssets()
         ComPtr<ID3DBlob> vertexShader;
         ComPtr<ID3DBlob> pixelShader;
 
-#if defined(_DEBUG)
-        // Enable better shader debugging with the graphics debugging tools.
-        UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-        UINT compileFlags = 0;
-#endif
-      
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertexShader, nullptr));
-        ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
+        // Debug builds compile with debug info, the shader cache skips unchanged shaders.
+        MappedFile source(GetAssetFullPath(L"shaders.hlsl"));
+        vertexShader = CompileShaderCached("shaders.hlsl", source.GetSpan(), "VSMain", "vs_5_0");
+        pixelShader = CompileShaderCached("shaders.hlsl", source.GetSpan(), "PSMain", "ps_5_0");
 
         // Define the vertex input layout.
         D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
@@ -174,23 +173,10 @@ void D3D12HelloTriangle::LoadAssets()
         psoDesc.NumRenderTargets = 1;
         psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
         psoDesc.SampleDesc.Count = 1;
-        ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
+        m_pipelineState = m_pipelineStateCache->GetOrCreate(psoDesc);
 
     }
 
-    // Create the command list.
-    ThrowIfFailed(m_device->CreateCommandList(
-        0,
-        D3D12_COMMAND_LIST_TYPE_DIRECT,
-        m_commandAllocators.Get(),
-        m_pipelineState.Get(),
-        IID_PPV_ARGS(&m_commandList)
-    ));
-
-    // Command lists are created in the recording state, but there is nothing
-    // to record yet. The main loop expects it to be closed, so close it now.
-    ThrowIfFailed(m_commandList->Close());
-
     // Create the vertex buffer.
     {
         // Define the geometry for a triangle.
@@ -217,6 +203,7 @@ void D3D12HelloTriangle::LoadAssets()
             nullptr,
             IID_PPV_ARGS(&m_vertexBuffer)
         ));
+        GpuMemoryTracker::TrackResource(m_vertexBuffer.Get(), GpuMemoryCategory::Buffer, L"m_vertexBuffer");
 
         // Copy the triangle data to the vertex buffer.
         UINT8* pVertexDataBegin;
@@ -260,9 +247,8 @@ void D3D12HelloTriangle::OnRender()
     // Record all the commands we need to render the scene into the command list.
     PopulateCommandList();
 
-    // Execute the command list.
-    ID3D12CommandList* ppCommandLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
+    // Execute the command lists.
+    m_sceneRecorder->Submit(m_commandQueue.Get());
 
     // Present the frame.
     ThrowIfFailed(m_swapChain->Present(1, 0));
@@ -279,37 +265,36 @@ void D3D12HelloTriangle::OnDestroy()
 
 void D3D12HelloTriangle::PopulateCommandList()
 {
-    // Command list allocators can only be reset when the associated
-    // command lists have finished execution on the GPU; apps should use
-    // fences to determine GPU execution progress.
-    ThrowIfFailed(m_commandAllocators->Reset());
-
-    // However, when ExecuteCommandList() is called on a particular command
-    // list, that command list can then be reset at any time and must before
-    // re-recording.
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators.Get(), m_pipelineState.Get()));
-
-    // Set necessary state.
-    m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
-    m_commandList->RSSetViewports(1, &m_viewPort);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
-
-    // Indicate that the back buffer will be used as a render target.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),m_frameIndex,m_rtvDescritorSize);
-    m_commandList->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
-
-
-    // Record commands.
-    const float clearColor[] = { 0.0f,0.2f,0.4f,1.0f };
-    m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-    m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-    m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-    m_commandList->DrawInstanced(m_vertexBufferView.SizeInBytes, 1, 0, 0);
-
-    // Indicate that the back buffer will now be used to present.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
-    ThrowIfFailed(m_commandList->Close());
+    // WaitForPreviousFrame left the GPU idle, so every list can be reused.
+    m_sceneRecorder->BeginFrame(m_frameIndex);
+    m_renderGraph->Reset(m_frameIndex);
+
+    // One pass drawing into the back buffer. The graph takes it from
+    // PRESENT to RENDER_TARGET before the pass and back after it.
+    const RenderGraphResource backBuffer = m_renderGraph->Import(L"BackBuffer", m_renderTargets[m_frameIndex].Get(), RenderGraphUsage_Present);
+    const RenderGraphPass trianglePass = m_renderGraph->AddPass(L"Triangle", [this](RenderGraphContext& context)
+    {
+        ID3D12GraphicsCommandList* commandList = context.GetCommandList();
+
+        // Set necessary state.
+        commandList->SetPipelineState(m_pipelineState.Get());
+        commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+        commandList->RSSetViewports(1, &m_viewPort);
+        commandList->RSSetScissorRects(1, &m_scissorRect);
+
+        CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),m_frameIndex,m_rtvDescritorSize);
+        commandList->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
+
+        // Record commands.
+        const float clearColor[] = { 0.0f,0.2f,0.4f,1.0f };
+        commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+        commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+        commandList->DrawInstanced(m_vertexBufferView.SizeInBytes, 1, 0, 0);
+    });
+    m_renderGraph->Write(trianglePass, backBuffer, RenderGraphUsage_RenderTarget);
+
+    m_renderGraph->Execute();
 }
 
 void D3D12HelloTriangle::WaitForPreviousFrame()
@@ -7,12 +7,29 @@ struct Vertex
     XMFLOAT4 Color;
 };
 
+// Matched against VSInput in shaders.hlsl when the shaders are loaded.
+static constexpr VertexAttribute VertexAttributes[] =
+{
+    VERTEX_ATTRIBUTE(Vertex, Pos, "POSITION", 0),
+    VERTEX_ATTRIBUTE(Vertex, Color, "COLOR", 0)
+};
+static_assert(IsTightlyPacked(VertexAttributes, sizeof(Vertex)), "VertexAttributes must list every member of Vertex in order");
+
 D3D12HelloWindow::D3D12HelloWindow(UINT width, UINT height, std::wstring name,UINT frameCount):
     DXSample(width,height,name,frameCount)
 {
 
 }
 
+D3D12HelloWindow::~D3D12HelloWindow()
+{
+    // OnDestroy waited already unless initialization failed.
+    if (m_shaderReload.valid())
+    {
+        m_shaderReload.wait();
+    }
+}
+
 void D3D12HelloWindow::OnInit()
 {
     assert(DXSample::Initialize());
@@ -24,21 +41,30 @@ void D3D12HelloWindow::OnInit()
         ThrowIfFailed(m_commandList->Reset(m_commandAllocators[i].Get(), nullptr));
         m_commandList->Close();
     }
-    BuildConstantDescriptorHeaps();
-    BuildConstantBuffers();
-    BuildRootSignature();
-    BuildShaderAndInputLayout();
-    BuildOwnGeometry();
-    BuildPSO();
 
-    // Execute the initialization commands.
-    //ThrowIfFailed(m_commandList->Close());
+    // The root signature is reflected from the shaders, the constant buffer view
+    // and queueing the PSO depend on other stages too. The rest runs
+    // concurrently on the worker pool.
+    TaskGraph init;
+    const TaskGraphNode heaps = init.Add(L"BuildConstantDescriptorHeaps", [this] { BuildConstantDescriptorHeaps(); });
+    init.Add(L"BuildConstantBuffers", [this] { BuildConstantBuffers(); }, { heaps });
+    const TaskGraphNode shaders = init.Add(L"BuildShaderAndInputLayout", [this] { BuildShaderAndInputLayout(); });
+    const TaskGraphNode rootSignature = init.Add(L"BuildRootSignature", [this] { BuildRootSignature(); }, { shaders });
+    init.Add(L"BuildOwnGeometry", [this] { BuildOwnGeometry(); });
+    init.Add(L"BuildPSO", [this] { BuildPSO(); }, { rootSignature, shaders });
+    RunInitGraph(init);
+
+    // Kick off the geometry uploads, rendering waits for them on the GPU.
+    m_uploadEngine->Flush();
 }
 
 
 // Update frame-based values.
 void D3D12HelloWindow::OnUpdate()
 {
+    // Swap in reloaded shaders between frames.
+    FinishShaderReload();
+
     // Convert Spherical to Cartesian coordinates.
     float x = m_radius * sinf(m_phi) * cosf(m_theta);
     float y = m_radius * cosf(m_phi);
@@ -52,9 +78,9 @@ void D3D12HelloWindow::OnUpdate()
     m_viewMatrix = XMMatrixLookAtLH(pos, target, up);
     XMMATRIX worldViewProj = m_worldMatrix * m_viewMatrix * m_projMatrix;
 
-    // Update the constant buffer with the latest worldViewProj
+    // Update the constant buffer with the latest worldViewProj, row_major in the shader so no transpose.
     ObjectConstants objConstants;
-    objConstants.worldViewProj = XMMatrixTranspose(worldViewProj);
+    XMStoreFloat4x4(&objConstants.WorldViewProj, worldViewProj);
     m_objectConstantBuffer->CopyData(0, objConstants);
 }
 
@@ -65,73 +91,125 @@ void D3D12HelloWindow::OnRender()
     // We can only reset when the associated command lists 
     // have finished execution on the GPU.
     WaitForGPU();
-    ThrowIfFailed(m_commandAllocators[m_frameIndex]->Reset());
-
-    // A command list can be reset after it has been added to
-    // the command queue via ExecuteCommandList.
-    // Reusing the command list reuses memory.
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
-
-    m_commandList->RSSetViewports(1, &m_screenViewport);
-    m_commandList->RSSetScissorRects(1, &m_scissorRect);
+    m_sceneRecorder->BeginFrame(m_frameIndex);
+    m_renderGraph->Reset(m_frameIndex);
+
+    // The frame as a graph: barriers between passes come from what each
+    // pass declares, and passes nothing needs are left out.
+    const RenderGraphResource backBuffer = m_renderGraph->Import(L"BackBuffer", GetCurrentBackBuffer(), RenderGraphUsage_Present);
+    const RenderGraphResource sceneTarget = m_4xMsaaState ?
+        m_renderGraph->Import(L"MsaaTarget", m_msaaRenderTarget.Get()) : backBuffer;
+    const RenderGraphResource depthStencil = m_renderGraph->Import(L"DepthStencil", GetSceneDepthStencil());
+
+    // Clear the scene target and depth buffer, then draw the box once its
+    // pipeline has been created in the background. The draws are recorded
+    // in parallel, chunks of them per command list.
+    const RenderGraphPass scenePass = m_renderGraph->AddPass(L"Scene", [this](RenderGraphContext& context)
+    {
+        ID3D12GraphicsCommandList* commandList = context.GetCommandList();
+        commandList->ClearRenderTargetView(
+            GetSceneRenderTargetView(),
+            Colors::SteelBlue,
+            0,
+            nullptr
+        );
+        commandList->ClearDepthStencilView(
+            GetDepthStencilView(),
+            D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
+            1.0f,0,0,nullptr
+        );
+
+        ID3D12PipelineState* pipelineState = m_pipelines[m_4xMsaaState ? 1 : 0].Get();
+        if (pipelineState)
+        {
+            context.RecordParallel(m_drawCount, DrawsPerCommandList,
+                [this, pipelineState](ID3D12GraphicsCommandList* commandList, UINT begin, UINT end)
+            {
+                RecordDraws(commandList, pipelineState, begin, end);
+            });
+        }
+    });
+    m_renderGraph->Write(scenePass, sceneTarget, RenderGraphUsage_RenderTarget);
+    m_renderGraph->Write(scenePass, depthStencil, RenderGraphUsage_DepthWrite);
 
-    // Indicate a state transition on resource usage.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(),
-        D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    if (m_4xMsaaState)
+    {
+        const RenderGraphPass resolvePass = m_renderGraph->AddPass(L"Resolve", [this](RenderGraphContext& context)
+        {
+            context.GetCommandList()->ResolveSubresource(GetCurrentBackBuffer(), 0, m_msaaRenderTarget.Get(), 0, m_backBufferFormat);
+        });
+        m_renderGraph->Read(resolvePass, sceneTarget, RenderGraphUsage_ResolveSource);
+        m_renderGraph->Write(resolvePass, backBuffer, RenderGraphUsage_ResolveDest);
+    }
 
-    // Clear the back buffer and depth buffer.
-    m_commandList->ClearRenderTargetView(
-        GetCurrentBackBufferView(),
-        Colors::SteelBlue,
-        0,
-        nullptr
-    );
-    m_commandList->ClearDepthStencilView(
-        GetDepthStencilView(),
-        D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
-        1.0f,0,0,nullptr
-    );
+    // Copies the back buffer out, which nothing in the graph reads.
+    if (IsScreenshotDue())
+    {
+        const RenderGraphPass screenshotPass = m_renderGraph->AddPass(L"Screenshot", [this](RenderGraphContext& context)
+        {
+            RecordScreenshot(context.GetCommandList(), GetCurrentBackBuffer());
+        }, true);
+        m_renderGraph->Read(screenshotPass, backBuffer, RenderGraphUsage_CopySource);
+    }
 
-    // Specify the buffers we are going to render to.
-    m_commandList->OMSetRenderTargets(1, 
-        &GetCurrentBackBufferView(), false, 
-        &GetDepthStencilView()
-    );
+    // Records the passes, the back buffer ends up in PRESENT.
+    m_renderGraph->Execute();
 
-    ID3D12DescriptorHeap* descriptorHeap[] = { m_cbvHeap.Get() };
-    m_commandList->SetDescriptorHeaps(_countof(descriptorHeap), descriptorHeap);
+    // The first frame drawing the box must not run before its buffers landed.
+    if (m_geometryUploadTicket.IsValid())
+    {
+        m_uploadEngine->WaitOnQueue(m_commandQueue.Get(), m_geometryUploadTicket);
+        m_geometryUploadTicket = UploadTicket();
+    }
 
-    m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+    // Close the lists and execute them in recording order.
+    m_sceneRecorder->Submit(m_commandQueue.Get());
 
-    m_commandList->IASetVertexBuffers(0, 1, &m_geometry->VertexBufferView());
-    m_commandList->IASetIndexBuffer(&m_geometry->IndexBufferView());
-    m_commandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    // Swap the back and front buffers.
+    PresentFrame();
+    MoveToNextFrame();
+}
 
-    m_commandList->SetGraphicsRootDescriptorTable(0, m_cbvHeap->GetGPUDescriptorHandleForHeapStart());
+// Runs on a job. Lists start without state, so each sets everything it draws with.
+void D3D12HelloWindow::RecordDraws(ID3D12GraphicsCommandList* commandList, ID3D12PipelineState* pipelineState, UINT begin, UINT end)
+{
+    commandList->RSSetViewports(1, &m_screenViewport);
+    commandList->RSSetScissorRects(1, &m_scissorRect);
 
-    m_commandList->DrawIndexedInstanced(
-        m_geometry->DrawArgs["box"].IndexCount,
-        1, 0, 0, 0
+    // Specify the buffers we are going to render to.
+    commandList->OMSetRenderTargets(1,
+        &GetSceneRenderTargetView(), false,
+        &GetDepthStencilView()
     );
 
-    // Indicate a state transition on the resource usage.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
-        GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    ID3D12DescriptorHeap* descriptorHeap[] = { m_cbvHeap.Get() };
+    commandList->SetDescriptorHeaps(_countof(descriptorHeap), descriptorHeap);
 
-    // Done recording commands.
-    ThrowIfFailed(m_commandList->Close());
+    commandList->SetGraphicsRootSignature(m_rootSignature.Get());
+    commandList->SetPipelineState(pipelineState);
+    commandList->IASetVertexBuffers(0, 1, &m_geometry->VertexBufferView());
+    commandList->IASetIndexBuffer(&m_geometry->IndexBufferView());
+    commandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-    // Add command list to the queue for execution.
-    ID3D12CommandList* cmdLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+    commandList->SetGraphicsRootDescriptorTable(m_objectConstantsParameter, m_cbvHeap->GetGPUDescriptorHandleForHeapStart());
 
-    // Swap the back and front buffers.
-    ThrowIfFailed(m_swapChain->Present(0, 0));
-    MoveToNextFrame();
+    // Every copy after the first fails the depth test, see -drawCount.
+    const SubmeshGeometry& box = m_geometry->DrawArgs.at("box");
+    for (UINT i = begin; i < end; i++)
+    {
+        commandList->DrawIndexedInstanced(box.IndexCount, 1, 0, 0, 0);
+    }
 }
 
 void D3D12HelloWindow::OnDestroy()
 {
+    // The reload task uses the shader, root signature and pipeline caches,
+    // which DXSample destroys before the worker pool stops.
+    if (m_shaderReload.valid())
+    {
+        m_shaderReload.wait();
+    }
+
     // Ensure that the GPU is no longer referencing resources
     // that are about to be cleaned up by the destructor.
     WaitForGPU();
@@ -148,10 +226,11 @@ void D3D12HelloWindow::PopulateCommandList()
     // However, when ExecuteCommandList() is called on a particular
     // command list, that command list can then be reset at any time
     // and must be before re-recording.
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelines[0].Get()));
 
     // Indicate that the back buffer will be used as a render target.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    m_stateTracker->Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_stateTracker->Flush(m_commandList.Get());
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),m_frameIndex,m_rtvDescriptorSize);
 
@@ -160,7 +239,7 @@ void D3D12HelloWindow::PopulateCommandList()
     m_commandList->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
 
     // Indicate that the back buffer will now be used to present.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameIndex].Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    PrepareToPresent(m_commandList.Get());
     
     ThrowIfFailed(m_commandList->Close());
 }
@@ -181,7 +260,7 @@ void D3D12HelloWindow::BuildConstantBuffers()
 {
     m_objectConstantBuffer = std::make_unique<UploadBuffer<ObjectConstants>>(m_device.Get(), 1, true);
 
-    UINT64 objectConstantBufferByteSize = CalculateConstantBufferByteSize(sizeof(ObjectConstants));
+    const UINT64 objectConstantBufferByteSize = GetConstantBufferViewSize<ObjectConstants>();
 
     D3D12_GPU_VIRTUAL_ADDRESS cbAddress = m_objectConstantBuffer->Resource()->GetGPUVirtualAddress();
 
@@ -191,7 +270,7 @@ void D3D12HelloWindow::BuildConstantBuffers()
 
     D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
     cbvDesc.BufferLocation = cbAddress;
-    cbvDesc.SizeInBytes = CalculateConstantBufferByteSize(sizeof(ObjectConstants));
+    cbvDesc.SizeInBytes = GetConstantBufferViewSize<ObjectConstants>();
 
     // Bind constant buffer view to a subregion of the buffer
     m_device->CreateConstantBufferView(
@@ -202,44 +281,162 @@ void D3D12HelloWindow::BuildConstantBuffers()
 
 void D3D12HelloWindow::BuildRootSignature()
 {
-    // Root parameter can be a table, root descriptor or root constants.
-    CD3DX12_ROOT_PARAMETER slotRootParameter[1];
-
-    // Create a single descriptor table of CBVs.
-    CD3DX12_DESCRIPTOR_RANGE cbvTable;
-    cbvTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
-    slotRootParameter[0].InitAsDescriptorTable(1, &cbvTable);
-
-    // A root signature is an array of root parameters.
-    CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(1, slotRootParameter, 0, nullptr,
-        D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
-
-    // Create a root signature with a single slot which points to a descriptor range consisting 
-    // of a single constant buffer.
-    ComPtr<ID3DBlob> serializedRootSig = nullptr;
-    ComPtr<ID3DBlob> errorBlob = nullptr;
-    ThrowIfFailed(D3D12SerializeRootSignature(&rootSigDesc, D3D_ROOT_SIGNATURE_VERSION_1,
-        serializedRootSig.GetAddressOf(), errorBlob.GetAddressOf()));
-    ThrowIfFailed(m_device->CreateRootSignature(
-        0,
-        serializedRootSig->GetBufferPointer(),
-        serializedRootSig->GetBufferSize(),
-        IID_PPV_ARGS(&m_rootSignature)
-    ));
+    m_rootSignature = CreateShaderRootSignature(*m_vsPermutations, *m_psPermutations, m_objectConstantsParameter);
+}
+
+// Runs on a worker for a reload and only reads shared state. Throws if the
+// shaders no longer bind ObjectConstants where the frame loop sets it.
+ComPtr<ID3D12RootSignature> D3D12HelloWindow::CreateShaderRootSignature(const ShaderPermutationSet& vertexShaders,
+    const ShaderPermutationSet& pixelShaders, UINT& objectConstantsParameter)
+{
+    // Every permutation goes in, so switching keywords never needs another root signature.
+    ShaderBindingLayout layout;
+    for (ShaderPermutationKey key = 0; key < vertexShaders.GetPermutationCount(); key++)
+    {
+        layout.AddShader(vertexShaders.Get(key));
+        layout.AddShader(pixelShaders.Get(key));
+    }
+
+    UINT tableOffset;
+    if (!layout.FindBinding("ObjectConstants", objectConstantsParameter, tableOffset) || tableOffset != 0)
+    {
+        ThrowIfFailed(E_INVALIDARG);
+    }
+
+    // The reflected layout is a single descriptor table with the one constant
+    // buffer. Serialized once, later runs load the blob.
+    return CreateRootSignature(layout.GetRootSignatureDesc(D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT));
 }
 
 void D3D12HelloWindow::BuildShaderAndInputLayout()
 {
-#if defined (_DEBUG)
-    // Enable better shader debugging with the graphics debugging tools.
-    UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#else
-    UINT compileFlags = 0;
-#endif // (_DEBUG)
-    ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &m_vsByteCode, nullptr));
-    ThrowIfFailed(D3DCompileFromFile(GetAssetFullPath(L"shaders.hlsl").c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &m_psByteCode, nullptr));
-    m_inputLayout.push_back(InitInputLayoutDescription((LPSTR)"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0));
-    m_inputLayout.push_back(InitInputLayoutDescription((LPSTR)"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0));
+    ShaderBuild build = BuildShaders();
+    m_vsPermutations = std::move(build.VertexShaders);
+    m_psPermutations = std::move(build.PixelShaders);
+    m_inputLayouts = std::move(build.InputLayouts);
+}
+
+// Runs on a worker, as an init stage or for a reload, and only reads shared state.
+D3D12HelloWindow::ShaderBuild D3D12HelloWindow::BuildShaders()
+{
+    const IoResult source = LoadAsset(L"shaders.hlsl");
+    ThrowIfFailed(source.Status);
+
+    // Every permutation is compiled up front, switching keywords later only needs a new pipeline.
+    // On reload the shader cache only compiles what the edit touched.
+    ShaderBuild build;
+    const std::vector<std::string> keywords = ParseShaderKeywords(source.Data);
+    build.VertexShaders = CreateShaderPermutations("shaders.hlsl", source.Data, "VSMain", "vs_5_0", keywords);
+    build.PixelShaders = CreateShaderPermutations("shaders.hlsl", source.Data, "PSMain", "ps_5_0", keywords);
+
+    // Each vertex shader permutation is checked against Vertex here, a mismatch fails at startup.
+    build.InputLayouts.resize(build.VertexShaders->GetPermutationCount());
+    for (ShaderPermutationKey key = 0; key < build.VertexShaders->GetPermutationCount(); key++)
+    {
+        build.InputLayouts[key] = BuildInputLayout(build.VertexShaders->Get(key), VertexAttributes);
+    }
+    return build;
+}
+
+void D3D12HelloWindow::OnFilesChanged(const std::vector<std::wstring>& fileNames)
+{
+    const bool affected = std::any_of(fileNames.begin(), fileNames.end(), [this](const std::wstring& name)
+    {
+        return m_vsPermutations->DependsOn(name) || m_psPermutations->DependsOn(name);
+    });
+    if (!affected)
+    {
+        return;
+    }
+
+    if (m_shaderReload.valid())
+    {
+        // The running reload may have read the file before this edit.
+        m_shaderReloadQueued = true;
+        return;
+    }
+    StartShaderReload();
+}
+
+void D3D12HelloWindow::StartShaderReload()
+{
+    // Everything that can fail runs here, FinishShaderReload only swaps the results in.
+    auto task = std::make_shared<std::packaged_task<ShaderBuild()>>([this]
+    {
+        ShaderBuild build = BuildShaders();
+        build.RootSignature = CreateShaderRootSignature(*build.VertexShaders, *build.PixelShaders, build.ObjectConstantsParameter);
+        return build;
+    });
+    m_shaderReload = task->get_future();
+    m_workerPool->Submit([task] { (*task)(); });
+}
+
+void D3D12HelloWindow::FinishShaderReload()
+{
+    if (!m_shaderReload.valid() ||
+        m_shaderReload.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return;
+    }
+
+    ShaderBuild build;
+    try
+    {
+        build = m_shaderReload.get();
+    }
+    catch (const HrException& e)
+    {
+        // Most likely a typo, the compiler errors are in the output already,
+        // or a binding the frame loop relies on was renamed or removed.
+        // Keep drawing with the shaders that worked until the next save.
+        OutputDebugStringW((L"Shader reload failed, keeping the previous shaders: " + e.ToString() + L"\n").c_str());
+    }
+    catch (const std::exception& e)
+    {
+        OutputDebugStringA((std::string("Shader reload failed, keeping the previous shaders: ") + e.what() + "\n").c_str());
+    }
+    if (m_shaderReloadQueued)
+    {
+        m_shaderReloadQueued = false;
+        StartShaderReload();
+    }
+    if (!build.VertexShaders)
+    {
+        return;
+    }
+
+    // Keywords stay enabled by name, the edit may have added or reordered them.
+    ShaderPermutationKey shaderKey = 0;
+    const std::vector<std::string>& keywords = m_psPermutations->GetKeywords();
+    for (size_t i = 0; i < keywords.size(); i++)
+    {
+        if ((m_shaderKey >> i) & 1)
+        {
+            shaderKey |= build.PixelShaders->GetKeywordBit(keywords[i]);
+        }
+    }
+
+    // The root signature cache hands back the same object unless the bindings
+    // changed. The old pipelines do not fit a new one, so the box is skipped
+    // until the new pipelines are ready instead of drawing with them.
+    const bool rootSignatureChanged = build.RootSignature != m_rootSignature;
+    m_vsPermutations = std::move(build.VertexShaders);
+    m_psPermutations = std::move(build.PixelShaders);
+    m_inputLayouts = std::move(build.InputLayouts);
+    m_rootSignature = std::move(build.RootSignature);
+    m_objectConstantsParameter = build.ObjectConstantsParameter;
+    m_shaderKey = shaderKey;
+    if (rootSignatureChanged)
+    {
+        for (PipelineHandle& pipeline : m_pipelines)
+        {
+            pipeline = PipelineHandle();
+        }
+    }
+
+    // Unchanged bytecode hits the pipeline cache, changed variants are created
+    // in the background while the previous pipelines keep drawing.
+    BuildPSO();
 }
 
 void D3D12HelloWindow::BuildOwnGeometry()
@@ -294,11 +491,18 @@ void D3D12HelloWindow::BuildOwnGeometry()
     ThrowIfFailed(D3DCreateBlob(ibByteSize, &m_geometry->IndexBufferCPU));
     CopyMemory(m_geometry->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-    m_geometry->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_commandList.Get(), vertices.data(),
-        vbByteSize, m_geometry->VertexBufferUploadBuffer);
+    m_geometry->VertexBufferGPU = CreateDefaultBufferResource(m_device.Get(), vbByteSize, L"BoxVertexBuffer");
+    m_geometry->IndexBufferGPU = CreateDefaultBufferResource(m_device.Get(), ibByteSize, L"BoxIndexBuffer");
 
-    m_geometry->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_commandList.Get(), indices.data(), ibByteSize,
-        m_geometry->IndexBufferUploadBuffer);
+    // Upload both buffers from a single staging allocation.
+    BufferUpload uploads[2];
+    uploads[0].Destination = m_geometry->VertexBufferGPU.Get();
+    uploads[0].Data = vertices.data();
+    uploads[0].ByteSize = vbByteSize;
+    uploads[1].Destination = m_geometry->IndexBufferGPU.Get();
+    uploads[1].Data = indices.data();
+    uploads[1].ByteSize = ibByteSize;
+    m_geometryUploadTicket = m_uploadEngine->EnqueueBufferUploads(uploads, _countof(uploads));
 
     m_geometry->VertexByteStride = sizeof(Vertex);
     m_geometry->VertexBufferByteSize = vbByteSize;
@@ -317,17 +521,20 @@ void D3D12HelloWindow::BuildPSO()
 {
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc;
     ZeroMemory(&psoDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-    psoDesc.InputLayout = { m_inputLayout.data(),(UINT)m_inputLayout.size() };
+    const std::vector<D3D12_INPUT_ELEMENT_DESC>& inputLayout = m_inputLayouts[m_shaderKey];
+    psoDesc.InputLayout = { inputLayout.data(),(UINT)inputLayout.size() };
     psoDesc.pRootSignature = m_rootSignature.Get();
+    ID3DBlob* vsByteCode = m_vsPermutations->Get(m_shaderKey);
+    ID3DBlob* psByteCode = m_psPermutations->Get(m_shaderKey);
     psoDesc.VS =
     {
-        reinterpret_cast<BYTE*>(m_vsByteCode->GetBufferPointer()),
-        m_vsByteCode->GetBufferSize()
+        reinterpret_cast<BYTE*>(vsByteCode->GetBufferPointer()),
+        vsByteCode->GetBufferSize()
     };
     psoDesc.PS =
     {
-        reinterpret_cast<BYTE*>(m_psByteCode->GetBufferPointer()),
-        m_psByteCode->GetBufferSize()
+        reinterpret_cast<BYTE*>(psByteCode->GetBufferPointer()),
+        psByteCode->GetBufferSize()
     };
     psoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     psoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
@@ -336,10 +543,16 @@ void D3D12HelloWindow::BuildPSO()
     psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
     psoDesc.NumRenderTargets = 1;
     psoDesc.RTVFormats[0] = m_backBufferFormat;
-    psoDesc.SampleDesc.Count = m_4xMsaaState ? 4 : 1;
-    psoDesc.SampleDesc.Quality = m_4xMsaaState ? (m_4xMsaaQuality - 1) : 0;
     psoDesc.DSVFormat = m_depthStencilFormat;
-    ThrowIfFailed(m_device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&m_pipelineState)));
+
+    // One pipeline per sample count, so toggling MSAA with F2 only switches
+    // targets. Created on a worker. Frames keep drawing with the previous
+    // variant until it is ready, or skip the box if there is none yet.
+    for (UINT msaa = 0; msaa < _countof(m_pipelines); msaa++)
+    {
+        psoDesc.SampleDesc = GetSceneSampleDesc(msaa == 1);
+        m_pipelines[msaa] = m_pipelineCompiler->Compile(psoDesc, m_pipelines[msaa].Get());
+    }
 }
 
 void D3D12HelloWindow::OnResize()
@@ -351,6 +564,15 @@ void D3D12HelloWindow::OnResize()
     m_projMatrix = XMMatrixPerspectiveFovLH(0.25f * XM_PI, m_aspectRatio, 0.3f, 1000.0f);
 }
 
+void D3D12HelloWindow::OnKeyDown(UINT8 key)
+{
+    if (key == 'G')
+    {
+        m_shaderKey ^= m_psPermutations->GetKeywordBit("GRAYSCALE");
+        BuildPSO();
+    }
+}
+
 void D3D12HelloWindow::OnMouseDown(WPARAM btnState, int x, int y)
 {
     m_lastMousePos.x = x;
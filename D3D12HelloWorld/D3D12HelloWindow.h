@@ -1,28 +1,23 @@
 #pragma once
 #include "DXSample.h"
 #include "UploadBuffer.h"
+#include "ShaderPermutations.h"
+#include "ShaderReflection.h"
+#include "ObjectConstants.hlsli"
+#include <future>
 
 using Microsoft::WRL::ComPtr;
 
-struct ObjectConstants
-{
-    /*XMFLOAT4X4 WorldViewProj=
-        DirectX::XMFLOAT4X4 (
-            1.0f, 0.0f, 0.0f, 0.0f,
-            0.0f, 1.0f, 0.0f, 0.0f,
-            0.0f, 0.0f, 1.0f, 0.0f,
-            0.0f, 0.0f, 0.0f, 1.0f);*/
-    XMMATRIX worldViewProj = XMMatrixIdentity();
-};
-
 class D3D12HelloWindow :public DXSample
 {
 public:
     D3D12HelloWindow(UINT width, UINT height, std::wstring name,UINT frameCount=2);
+    virtual ~D3D12HelloWindow();
     virtual void OnMouseDown(WPARAM btnState, int x, int y)override;
     virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
     virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
-    
+    virtual void OnKeyDown(UINT8 key)override;
+    virtual void OnFilesChanged(const std::vector<std::wstring>& fileNames)override;
 
 private:
     virtual void OnInit() override;
@@ -37,17 +32,46 @@ private:
     virtual void BuildPSO()override;
 
     void PopulateCommandList();
+    void RecordDraws(ID3D12GraphicsCommandList* commandList, ID3D12PipelineState* pipelineState, UINT begin, UINT end);
+
+    // Fewer draws than this are not worth a command list of their own.
+    static const UINT DrawsPerCommandList = 256;
+
+    // Everything compiled from shaders.hlsl, built off the frame loop on reload.
+    // The root signature is only filled in for a reload, init has a stage for it.
+    struct ShaderBuild
+    {
+        std::unique_ptr<ShaderPermutationSet> VertexShaders;
+        std::unique_ptr<ShaderPermutationSet> PixelShaders;
+        std::vector<std::vector<D3D12_INPUT_ELEMENT_DESC>> InputLayouts;
+        ComPtr<ID3D12RootSignature> RootSignature;
+        UINT ObjectConstantsParameter = 0;
+    };
+    ShaderBuild BuildShaders();
+    ComPtr<ID3D12RootSignature> CreateShaderRootSignature(const ShaderPermutationSet& vertexShaders,
+        const ShaderPermutationSet& pixelShaders, UINT& objectConstantsParameter);
+    void StartShaderReload();
+    void FinishShaderReload();
 
     virtual void OnResize() override;
 
     std::unique_ptr <UploadBuffer<ObjectConstants>> m_objectConstantBuffer = nullptr;
-    ComPtr<ID3DBlob> m_vsByteCode = nullptr;
-    ComPtr<ID3DBlob> m_psByteCode = nullptr;
+    std::unique_ptr<ShaderPermutationSet> m_vsPermutations;
+    std::unique_ptr<ShaderPermutationSet> m_psPermutations;
+    ShaderPermutationKey m_shaderKey = 0;   // Keywords enabled, G toggles GRAYSCALE.
+
+    std::vector<std::vector<D3D12_INPUT_ELEMENT_DESC>> m_inputLayouts;    // Per vertex shader permutation.
+    UINT m_objectConstantsParameter = 0;
+
+    // Hot reload: shaders recompiling on a worker, and whether more edits
+    // arrived while they were.
+    std::future<ShaderBuild> m_shaderReload;
+    bool m_shaderReloadQueued = false;
 
-    std::vector<D3D12_INPUT_ELEMENT_DESC> m_inputLayout;
     std::unique_ptr<MeshGeometry> m_geometry = nullptr;
+    UploadTicket m_geometryUploadTicket;
 
-    ComPtr<ID3D12PipelineState> m_pipelineState = nullptr;
+    PipelineHandle m_pipelines[2];  // 1X and 4X MSAA.
 
     DirectX::XMMATRIX m_worldMatrix = DirectX::XMMatrixIdentity();
     DirectX::XMMATRIX m_viewMatrix = DirectX::XMMatrixIdentity();
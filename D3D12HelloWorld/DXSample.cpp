@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "DXSample.h"
+#include "ImageFile.h"
 
 using namespace Microsoft::WRL;
 
@@ -15,6 +16,21 @@ DXSample::DXSample(UINT width, UINT height, std::wstring name, UINT frameCount)
     m_assetsPath = assetsPath;
 
     m_aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+
+    m_workerPool = std::make_unique<ThreadPool>();
+    m_jobSystem = std::make_unique<JobSystem>();
+    m_stateTracker = std::make_unique<ResourceStateTracker>();
+    m_ioService = std::make_unique<AsyncIoService>();
+
+    // Prefer the packed archive built by AssetTools, loose files remain the fallback.
+    const std::wstring archivePath = GetAssetFullPath(L"assets.pak");
+    if (GetFileAttributesW(archivePath.c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+        m_assetArchive = std::make_shared<AssetArchive>(archivePath);
+    }
+
+    // Includes are loose files next to the executable, AssetTools precompile fills the cache ahead of time.
+    m_shaderCache = std::make_unique<ShaderCache>(GetAssetFullPath(L"ShaderCache\\"), m_assetsPath);
 }
 
 DXSample::~DXSample()
@@ -28,6 +44,92 @@ std::wstring DXSample::GetAssetFullPath(LPCWSTR assetName)
     return m_assetsPath + assetName;
 }
 
+//Loads an asset in the background, from assets.pak when it has it, otherwise from the loose file.
+IoRequestId DXSample::LoadAssetAsync(LPCWSTR assetName, IoPriority priority, IoCompletion completion)
+{
+    if (m_assetArchive && !m_hotReload && m_assetArchive->Find(assetName))
+    {
+        return m_ioService->ReadArchiveAsset(m_assetArchive, assetName, priority, std::move(completion));
+    }
+    return m_ioService->ReadFile(GetAssetFullPath(assetName), priority, std::move(completion));
+}
+
+//Same as LoadAssetAsync but on the calling thread, for init stages running on workers.
+IoResult DXSample::LoadAsset(LPCWSTR assetName)
+{
+    if (m_assetArchive && !m_hotReload && m_assetArchive->Find(assetName))
+    {
+        return m_ioService->ReadNow(assetName, m_assetArchive);
+    }
+    return m_ioService->ReadNow(GetAssetFullPath(assetName));
+}
+
+//Compiles with the default flags through the shader cache, which skips the compiler when nothing changed.
+ComPtr<ID3DBlob> DXSample::CompileShaderCached(LPCSTR sourceName, const ByteSpan& source, LPCSTR entryPoint, LPCSTR target)
+{
+    ShaderCompileDesc desc;
+    desc.SourceName = sourceName;
+    desc.Source = source;
+    desc.EntryPoint = entryPoint;
+    desc.Target = target;
+    desc.Flags = GetDefaultShaderCompileFlags();
+    return m_shaderCache->GetOrCompile(desc);
+}
+
+//Compiles every permutation of the entry point over keywords on the worker pool.
+std::unique_ptr<ShaderPermutationSet> DXSample::CreateShaderPermutations(LPCSTR sourceName, const ByteSpan& source,
+    LPCSTR entryPoint, LPCSTR target, const std::vector<std::string>& keywords)
+{
+    ShaderCompileDesc desc;
+    desc.SourceName = sourceName;
+    desc.Source = source;
+    desc.EntryPoint = entryPoint;
+    desc.Target = target;
+    desc.Flags = GetDefaultShaderCompileFlags();
+
+    std::unique_ptr<ShaderPermutationSet> permutations = std::make_unique<ShaderPermutationSet>(desc, keywords);
+    permutations->Compile(*m_shaderCache, m_workerPool.get());
+    return permutations;
+}
+
+//Runs the init stages on the worker pool and reports how long each took to the debugger output.
+void DXSample::RunInitGraph(TaskGraph& graph)
+{
+    graph.Run(m_serialInit ? nullptr : m_workerPool.get());
+
+    const std::wstring report = (m_serialInit ? L"Init stages, serial:\n" : L"Init stages, parallel:\n") + graph.GetTimingReport();
+    OutputDebugStringW(report.c_str());
+    if (!m_initReportFile.empty())
+    {
+        std::wofstream file(m_initReportFile, std::ios::app);
+        file << report;
+    }
+}
+
+//Pipelines are looked up in PipelineCache.bin first, which Run writes back on exit.
+//Root signature blobs are written to RootSignatureCache as they are serialized.
+//Called once, right after the device was created.
+void DXSample::CreateStateCaches()
+{
+    assert(!m_pipelineStateCache && !m_pipelineCompiler);
+    m_rootSignatureCache = std::make_unique<RootSignatureCache>(m_device.Get(), GetAssetFullPath(L"RootSignatureCache\\"));
+    m_pipelineStateCache = std::make_unique<PipelineStateCache>(m_device.Get(), GetAssetFullPath(L"PipelineCache.bin"));
+
+    PipelineStateCache* cache = m_pipelineStateCache.get();
+    m_pipelineCompiler = std::make_unique<AsyncPipelineCompiler>(m_workerPool.get(),
+        [cache](const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { return cache->GetOrCreate(desc); });
+}
+
+//Identical descs return the same root signature. It is registered with the
+//pipeline cache so pipelines using it persist across runs.
+ComPtr<ID3D12RootSignature> DXSample::CreateRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc)
+{
+    UINT64 contentHash;
+    ComPtr<ID3D12RootSignature> rootSignature = m_rootSignatureCache->GetOrCreate(desc, &contentHash);
+    m_pipelineStateCache->RegisterRootSignature(rootSignature.Get(), contentHash);
+    return rootSignature;
+}
+
 //Helper function for acquiring the first available hardware adapter that supports Direct3D 12.
 //If no such adapter can be found, *ppAdapter will be set to nullptr.
 _Use_decl_annotations_
@@ -75,6 +177,53 @@ void DXSample::ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc)
             m_useWarpDevice = true;
             m_title = m_title + L" (WARP)";
         }
+        else if (_wcsicmp(argv[i], L"-headless") == 0)
+        {
+            m_headless = true;
+        }
+        else if (_wcsicmp(argv[i], L"-serialInit") == 0)
+        {
+            m_serialInit = true;
+        }
+        else if (_wcsicmp(argv[i], L"-initReport") == 0 && i + 1 < argc)
+        {
+            m_initReportFile = argv[++i];
+        }
+        else if (_wcsicmp(argv[i], L"-hotReload") == 0)
+        {
+            m_hotReload = true;
+        }
+        else if (_wcsicmp(argv[i], L"-drawCount") == 0 && i + 1 < argc)
+        {
+            m_drawCount = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+        }
+        else if (_wcsicmp(argv[i], L"-capture") == 0 && i + 1 < argc)
+        {
+            // Comma separated frame numbers, counting from 1.
+            for (WCHAR* frame = argv[++i]; *frame; )
+            {
+                WCHAR* end;
+                m_captureFrames.push_back(wcstoul(frame, &end, 10));
+                frame = *end ? end + 1 : end;
+            }
+        }
+        else if (_wcsicmp(argv[i], L"-captureDir") == 0 && i + 1 < argc)
+        {
+            // An empty directory falls back to the assets path below.
+            m_captureDirectory = argv[++i];
+            if (!m_captureDirectory.empty() && m_captureDirectory.back() != L'\\' && m_captureDirectory.back() != L'/')
+            {
+                m_captureDirectory += L'\\';
+            }
+        }
+        else if (_wcsicmp(argv[i], L"-frames") == 0 && i + 1 < argc)
+        {
+            m_frameLimit = wcstoul(argv[++i], nullptr, 10);
+        }
+    }
+    if (m_captureDirectory.empty())
+    {
+        m_captureDirectory = m_assetsPath;
     }
 }
 
@@ -193,10 +342,23 @@ void DXSample::CreateCommandObjects()
     CreateCommandQueue();
     CreateCommandAllocator();
     CreateCommandList();
+    m_commandListPool = std::make_unique<CommandListPool>(m_device.Get(), m_commandListType, m_fenceSource);
+    m_sceneRecorder = std::make_unique<ParallelCommandRecorder>(m_device.Get(), m_commandListType, m_frameCount);
+    m_renderGraph = std::make_unique<RenderGraphExecutor>(m_device.Get(), *m_stateTracker, *m_sceneRecorder,
+        *m_jobSystem, m_frameCount);
+    m_uploadEngine = std::make_unique<UploadEngine>(m_device.Get(), m_workerPool.get());
+    m_readbackRing = std::make_unique<ReadbackRing>(m_device.Get());
+    CreateStateCaches();
 }
 
 void DXSample::CreateSwapChain()
 {
+    // Headless runs render into offscreen targets created by OnResize.
+    if (m_headless)
+    {
+        return;
+    }
+
     ComPtr<IDXGISwapChain1> swapChain;
     DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
     swapChainDesc.Width = m_width;
@@ -204,8 +366,10 @@ void DXSample::CreateSwapChain()
     swapChainDesc.Format = m_backBufferFormat;
     swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
     swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
-    swapChainDesc.SampleDesc.Count = m_4xMsaaState ? 4 : 1;
-    swapChainDesc.SampleDesc.Quality = m_4xMsaaState ? (m_4xMsaaQuality - 1) : 0;
+    // Flip model swap chains are never multisampled, MSAA renders into
+    // m_msaaRenderTarget and resolves into the back buffer instead.
+    swapChainDesc.SampleDesc.Count = 1;
+    swapChainDesc.SampleDesc.Quality = 0;
     swapChainDesc.BufferCount = m_frameCount;
 
     DXGI_SWAP_CHAIN_FULLSCREEN_DESC desc = {};
@@ -251,7 +415,11 @@ void DXSample::CalculateFrameStats()
         std::wstring fpsStr = std::to_wstring(fps);
         std::wstring mspfStr = std::to_wstring(mspf);
 
-        std::wstring appendStr = L"    fps: " + fpsStr + L"    mspf: " + mspfStr;
+        // Live GPU memory usage, press F3 for the detailed report.
+        GpuMemorySummary memory = GpuMemoryTracker::GetSummary();
+        std::wstring memoryStr = std::to_wstring(memory.TotalBytes / (1024 * 1024));
+
+        std::wstring appendStr = L"    fps: " + fpsStr + L"    mspf: " + mspfStr + L"    gpu MB: " + memoryStr;
 
         SetCustomWindowText(appendStr.c_str());
 
@@ -267,103 +435,166 @@ bool DXSample::Get4xMsaaState() const
 
 void DXSample::Set4xMsaaState(bool value)
 {
-    if (m_4xMsaaState != value)
-    {
-        m_4xMsaaState = value;
+    // The targets for both settings always exist, the next frame just renders
+    // into the other ones. Samples keep a pipeline per setting.
+    m_4xMsaaState = value;
+}
 
-        // Recreate the swap chain and buffers with new multi sample setting.
-        CreateSwapChain();
-        OnResize();
-    }
+DXGI_SAMPLE_DESC DXSample::GetSceneSampleDesc(bool msaa)const
+{
+    DXGI_SAMPLE_DESC sampleDesc;
+    sampleDesc.Count = msaa ? 4 : 1;
+    sampleDesc.Quality = msaa ? (m_4xMsaaQuality - 1) : 0;
+    return sampleDesc;
 }
 
 void DXSample::OnResize()
 {
     assert(m_device);
-    assert(m_swapChain);
-    assert(m_commandAllocators[m_frameIndex]);
+    assert(m_swapChain || m_headless);
+    assert(m_commandListPool);
 
     // Flush before changing any resources.
     //WaitForGPU();
 
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), nullptr));
+    CommandContext* context = m_commandListPool->Acquire();
 
     // Release the previous resources we will be recreating.
     for (UINT i=0;i<m_frameCount;i++)
     {
+        if (m_renderTargets[i])
+        {
+            m_stateTracker->Unregister(m_renderTargets[i].Get());
+        }
         m_renderTargets[i].Reset();
     }
-    m_depthStencilBuffer.Reset();
+    for (ComPtr<ID3D12Resource>* resource : { &m_msaaRenderTarget, &m_depthStencilBuffer, &m_msaaDepthStencilBuffer })
+    {
+        if (*resource)
+        {
+            m_stateTracker->Unregister(resource->Get());
+        }
+        resource->Reset();
+    }
 
     // Resize the swap chain
-    ThrowIfFailed(m_swapChain->ResizeBuffers(
-        m_frameCount,
-        m_width,
-        m_height,
-        m_backBufferFormat,
-        DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH
-    ));
+    if (!m_headless)
+    {
+        ThrowIfFailed(m_swapChain->ResizeBuffers(
+            m_frameCount,
+            m_width,
+            m_height,
+            m_backBufferFormat,
+            DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH
+        ));
+    }
+
+    // The frame index restarts, keep the fence value moving forward.
+    const UINT64 fenceValue = m_fenceValues[m_frameIndex];
     m_frameIndex = 0;
+    m_fenceValues[m_frameIndex] = fenceValue;
 
     CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle(m_rtvHeap->GetCPUDescriptorHandleForHeapStart());
     for (UINT i=0;i<m_frameCount;i++)
     {
-        ThrowIfFailed(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i])));
+        if (m_headless)
+        {
+            // Stand-ins for the swap chain buffers, PRESENT is the COMMON state
+            // so the usual PRESENT <-> RENDER_TARGET barriers apply unchanged.
+            ThrowIfFailed(m_device->CreateCommittedResource(
+                &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+                D3D12_HEAP_FLAG_NONE,
+                &CD3DX12_RESOURCE_DESC::Tex2D(m_backBufferFormat, m_width, m_height, 1, 1, 1, 0,
+                    D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET),
+                D3D12_RESOURCE_STATE_PRESENT,
+                nullptr,
+                IID_PPV_ARGS(&m_renderTargets[i])
+            ));
+        }
+        else
+        {
+            ThrowIfFailed(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&m_renderTargets[i])));
+        }
         m_device->CreateRenderTargetView(m_renderTargets[i].Get(), nullptr, rtvHeapHandle);
+        GpuMemoryTracker::TrackResource(m_renderTargets[i].Get(), GpuMemoryCategory::RenderTarget,
+            (L"m_renderTargets[" + std::to_wstring(i) + L"]").c_str());
+        m_stateTracker->Register(m_renderTargets[i].Get(), D3D12_RESOURCE_STATE_PRESENT);
         rtvHeapHandle.Offset(1, m_rtvDescriptorSize);
     }
 
-    // Create the depth/stencil buffer and view.
-    D3D12_RESOURCE_DESC depthStencilDesc;
-    depthStencilDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
-    depthStencilDesc.Alignment = 0;
-    depthStencilDesc.Width = m_width;
-    depthStencilDesc.Height = m_height;
-    depthStencilDesc.DepthOrArraySize = 1;
-    depthStencilDesc.MipLevels = 1;
-
-    // Caution: SSAO chapter requires an SRV to the depth buffer to read from
-    // the depth buffer. Therefore, because we need to create two views to the same resources,
-    // 1. SRV format :DXGI_FORMAT_R24_UNORM_X8_TYPELESS
-    // 2. DSV format :DXGI_FORMAT_D24_UNORM_S8_UINT
-    // we need to create the depth buffer resource with a typeless format
-    depthStencilDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
-
-    depthStencilDesc.SampleDesc.Count = m_4xMsaaState ? 4 : 1;
-    depthStencilDesc.SampleDesc.Quality = m_4xMsaaState ? (m_4xMsaaQuality - 1) : 0;
-    depthStencilDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
-    depthStencilDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-    D3D12_CLEAR_VALUE optClear;
-    optClear.Format = m_depthStencilFormat;
-    optClear.DepthStencil.Depth = 1.0f;
-    optClear.DepthStencil.Stencil = 0;
+    // The 4X MSAA color target is built up front so toggling MSAA never
+    // touches the swap chain.
+    const DXGI_SAMPLE_DESC msaaSampleDesc = GetSceneSampleDesc(true);
     ThrowIfFailed(m_device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
         D3D12_HEAP_FLAG_NONE,
-        &depthStencilDesc,
-        D3D12_RESOURCE_STATE_COMMON,
-        &optClear,
-        IID_PPV_ARGS(m_depthStencilBuffer.GetAddressOf())
+        &CD3DX12_RESOURCE_DESC::Tex2D(m_backBufferFormat, m_width, m_height, 1, 1,
+            msaaSampleDesc.Count, msaaSampleDesc.Quality, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET),
+        D3D12_RESOURCE_STATE_RESOLVE_SOURCE,
+        nullptr,
+        IID_PPV_ARGS(&m_msaaRenderTarget)
     ));
-
-    // Create descriptor to mip level 0 of entire resource using the format of the resource.
-    D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
-    dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
-    dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-    dsvDesc.Format = m_depthStencilFormat;
-    dsvDesc.Texture2D.MipSlice = 0;
-    m_device->CreateDepthStencilView(m_depthStencilBuffer.Get(), &dsvDesc, m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
-    
-    // Transition the resource from its initial state to be used as a depth buffer.
-    m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(m_depthStencilBuffer.Get(), 
-        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+    m_device->CreateRenderTargetView(m_msaaRenderTarget.Get(), nullptr, rtvHeapHandle);
+    GpuMemoryTracker::TrackResource(m_msaaRenderTarget.Get(), GpuMemoryCategory::RenderTarget, L"m_msaaRenderTarget");
+    m_stateTracker->Register(m_msaaRenderTarget.Get(), D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+
+    // Create a depth/stencil buffer and view for each sample count.
+    ComPtr<ID3D12Resource>* depthStencilBuffers[] = { &m_depthStencilBuffer, &m_msaaDepthStencilBuffer };
+    CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHeapHandle(m_dsvHeap->GetCPUDescriptorHandleForHeapStart());
+    for (UINT i = 0; i < _countof(depthStencilBuffers); i++)
+    {
+        D3D12_RESOURCE_DESC depthStencilDesc;
+        depthStencilDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        depthStencilDesc.Alignment = 0;
+        depthStencilDesc.Width = m_width;
+        depthStencilDesc.Height = m_height;
+        depthStencilDesc.DepthOrArraySize = 1;
+        depthStencilDesc.MipLevels = 1;
+
+        // Caution: SSAO chapter requires an SRV to the depth buffer to read from
+        // the depth buffer. Therefore, because we need to create two views to the same resources,
+        // 1. SRV format :DXGI_FORMAT_R24_UNORM_X8_TYPELESS
+        // 2. DSV format :DXGI_FORMAT_D24_UNORM_S8_UINT
+        // we need to create the depth buffer resource with a typeless format
+        depthStencilDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
+
+        depthStencilDesc.SampleDesc = GetSceneSampleDesc(i == 1);
+        depthStencilDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+        depthStencilDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+        D3D12_CLEAR_VALUE optClear;
+        optClear.Format = m_depthStencilFormat;
+        optClear.DepthStencil.Depth = 1.0f;
+        optClear.DepthStencil.Stencil = 0;
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &depthStencilDesc,
+            D3D12_RESOURCE_STATE_COMMON,
+            &optClear,
+            IID_PPV_ARGS(depthStencilBuffers[i]->GetAddressOf())
+        ));
+        GpuMemoryTracker::TrackResource(depthStencilBuffers[i]->Get(), GpuMemoryCategory::DepthStencil,
+            i == 1 ? L"m_msaaDepthStencilBuffer" : L"m_depthStencilBuffer");
+
+        // Create descriptor to mip level 0 of entire resource using the format of the resource.
+        D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+        dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
+        dsvDesc.ViewDimension = i == 1 ? D3D12_DSV_DIMENSION_TEXTURE2DMS : D3D12_DSV_DIMENSION_TEXTURE2D;
+        dsvDesc.Format = m_depthStencilFormat;
+        dsvDesc.Texture2D.MipSlice = 0;
+        m_device->CreateDepthStencilView(depthStencilBuffers[i]->Get(), &dsvDesc, dsvHeapHandle);
+        dsvHeapHandle.Offset(1, m_dsvDescriptorSize);
+
+        // Transition the resource from its initial state to be used as a depth buffer.
+        m_stateTracker->Register(depthStencilBuffers[i]->Get(), D3D12_RESOURCE_STATE_COMMON);
+        m_stateTracker->Transition(depthStencilBuffers[i]->Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
+    }
+    m_stateTracker->Flush(context->CommandList.Get());
 
 
     // Execute the resize commands.
-    ThrowIfFailed(m_commandList->Close());
-    ID3D12CommandList* cmdLists[] = { m_commandList.Get() };
-    m_commandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+    ExecutePooledCommandList(context);
 
     // Wait until resize is complete.
     WaitForGPU();
@@ -477,7 +708,7 @@ bool DXSample::GetProgramPauseState()const
 void DXSample::CreateRtvAndDsvDescriptorHeaps()
 {
     D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
-    rtvHeapDesc.NumDescriptors = m_frameCount;
+    rtvHeapDesc.NumDescriptors = m_frameCount + 1;  // Back buffers, then the MSAA target.
     rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
     rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     rtvHeapDesc.NodeMask = 0;
@@ -486,7 +717,7 @@ void DXSample::CreateRtvAndDsvDescriptorHeaps()
     m_renderTargets.resize(m_frameCount);
 
     D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc;
-    dsvHeapDesc.NumDescriptors = 1;
+    dsvHeapDesc.NumDescriptors = 2;     // 1X, then 4X MSAA.
     dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
     dsvHeapDesc.NodeMask = 0;
@@ -550,13 +781,47 @@ D3D12_CPU_DESCRIPTOR_HANDLE DXSample::GetCurrentBackBufferView()const
 
 D3D12_CPU_DESCRIPTOR_HANDLE DXSample::GetDepthStencilView()const
 {
-    return m_dsvHeap->GetCPUDescriptorHandleForHeapStart();
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(
+        m_dsvHeap->GetCPUDescriptorHandleForHeapStart(),
+        m_4xMsaaState ? 1 : 0,
+        m_dsvDescriptorSize
+    );
+}
+
+ID3D12Resource* DXSample::GetSceneRenderTarget()const
+{
+    return m_4xMsaaState ? m_msaaRenderTarget.Get() : GetCurrentBackBuffer();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DXSample::GetSceneRenderTargetView()const
+{
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(
+        m_rtvHeap->GetCPUDescriptorHandleForHeapStart(),
+        m_4xMsaaState ? m_frameCount : m_frameIndex,
+        m_rtvDescriptorSize
+    );
+}
+
+ID3D12Resource* DXSample::GetSceneDepthStencil()const
+{
+    return m_4xMsaaState ? m_msaaDepthStencilBuffer.Get() : m_depthStencilBuffer.Get();
+}
+
+void DXSample::PrepareToPresent(ID3D12GraphicsCommandList* cmdList)
+{
+    m_stateTracker->Transition(GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT);
+    m_stateTracker->Flush(cmdList);
 }
 
 int DXSample::Run()
 {
     MSG msg = { 0 };
 
+    if (m_hotReload)
+    {
+        m_fileWatcher = std::make_unique<FileWatcher>(m_assetsPath);
+    }
+
     mTimer.Reset();
 
     while (msg.message != WM_QUIT)
@@ -572,11 +837,53 @@ int DXSample::Run()
         {
             mTimer.Tick();
 
+            // Recycle staging memory of uploads that have landed.
+            if (m_uploadEngine)
+            {
+                m_uploadEngine->RetireCompletedUploads();
+            }
+
+            // Hand readbacks of finished frames to their callbacks.
+            if (m_readbackRing)
+            {
+                m_readbackRing->Poll(m_fence->GetCompletedValue());
+            }
+
+            // Hand finished file loads to their owners at a frame boundary.
+            m_ioService->DispatchCompletions();
+
+            // Same for edited assets.
+            if (m_fileWatcher)
+            {
+                const std::vector<std::wstring> changes = m_fileWatcher->TakeChanges();
+                if (!changes.empty())
+                {
+                    // Cached shaders check their includes against the new contents.
+                    m_shaderCache->NotifyFilesChanged(changes);
+                    OnFilesChanged(changes);
+                }
+            }
+
             if (!m_programPaused)
             {
+                // Frame numbers start once nothing is loading or compiling anymore.
+                if (m_frameNumber != 0 ||
+                    (m_ioService->GetPendingCount() == 0 && (!m_pipelineCompiler || m_pipelineCompiler->GetPendingCount() == 0)))
+                {
+                    m_frameNumber++;
+                }
+
                 CalculateFrameStats();
                 OnUpdate();
                 OnRender();
+
+                // Let the captures land before quitting.
+                if (m_frameLimit != 0 && m_frameNumber >= m_frameLimit)
+                {
+                    WaitForGPU();
+                    m_readbackRing->Poll(m_fence->GetCompletedValue());
+                    PostQuitMessage(0);
+                }
             }
             else
             {
@@ -585,6 +892,14 @@ int DXSample::Run()
         }
     }
 
+    // Keep what the driver compiled this run for the next one. Compiles
+    // still queued are dropped so nothing is stored while it is written.
+    if (m_pipelineStateCache)
+    {
+        m_pipelineCompiler.reset();
+        m_pipelineStateCache->Save();
+    }
+
     return (int)msg.wParam;
 }
 
@@ -609,8 +924,14 @@ void DXSample::MoveToNextFrame()
     const UINT64 currentFenceValue = m_fenceValues[m_frameIndex];
     ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
 
+    // Readbacks recorded this frame land once the fence passes this value.
+    if (m_readbackRing)
+    {
+        m_readbackRing->Commit(currentFenceValue);
+    }
+
     // Update the frame index.
-    m_frameIndex = m_swapChain->GetCurrentBackBufferIndex();
+    m_frameIndex = m_headless ? (m_frameIndex + 1) % m_frameCount : m_swapChain->GetCurrentBackBufferIndex();
 
     // If the next frame is not ready to be rendered yet, wait until it it ready.
     if (m_fence->GetCompletedValue() < m_fenceValues[m_frameIndex])
@@ -621,4 +942,93 @@ void DXSample::MoveToNextFrame()
 
     // Set the fence value for the next frame.
     m_fenceValues[m_frameIndex] = currentFenceValue + 1;
+}
+
+bool DXSample::IsCaptureFrame()const
+{
+    return m_frameNumber != 0 &&
+        std::find(m_captureFrames.begin(), m_captureFrames.end(), m_frameNumber) != m_captureFrames.end();
+}
+
+// Whether RecordScreenshot has anything to do this frame.
+bool DXSample::IsScreenshotDue()const
+{
+    return m_screenshotRequested || IsCaptureFrame();
+}
+
+// Copy the render target, which must be known to the state tracker, to a
+// screenshot file if one was requested. The file is written a few frames
+// later when the copy has landed, the frame loop never waits for it.
+void DXSample::RecordScreenshot(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* renderTarget)
+{
+    const bool capture = IsCaptureFrame();
+
+    // Multisampled targets can not be copied to a buffer.
+    if ((!capture && !m_screenshotRequested) || renderTarget->GetDesc().SampleDesc.Count > 1)
+    {
+        return;
+    }
+
+    // A transition still pending, to RENDER_TARGET after a resolve say, merges into this one.
+    const D3D12_RESOURCE_STATES state = m_stateTracker->GetState(renderTarget);
+    m_stateTracker->Transition(renderTarget, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    m_stateTracker->Flush(cmdList);
+
+    const DXGI_FORMAT format = renderTarget->GetDesc().Format;
+    const std::wstring filename = capture ?
+        m_captureDirectory + L"frame" + std::to_wstring(m_frameNumber) + L".ppm" :
+        GetAssetFullPath((L"Screenshot" + std::to_wstring(m_screenshotCount) + L".ppm").c_str());
+    auto writeImage = [filename, format](const ReadbackResult& result)
+    {
+        WritePpm(filename, ImageFromRows(result.Data, static_cast<UINT>(result.Footprint.Footprint.Width),
+            result.Footprint.Footprint.Height, result.Footprint.Footprint.RowPitch, format));
+    };
+    bool recorded = m_readbackRing->ReadTexture(cmdList, renderTarget, 0, writeImage);
+    if (!recorded && capture)
+    {
+        // A capture must not be dropped, drain what earlier frames read back.
+        WaitForGPU();
+        m_readbackRing->Poll(m_fence->GetCompletedValue());
+        recorded = m_readbackRing->ReadTexture(cmdList, renderTarget, 0, writeImage);
+        if (!recorded)
+        {
+            ThrowIfFailed(E_OUTOFMEMORY);
+        }
+    }
+
+    // Asked back, folded into the next transition of the target.
+    m_stateTracker->Transition(renderTarget, state);
+
+    // Screenshots are retried next frame if the ring is full.
+    if (recorded && !capture)
+    {
+        m_screenshotRequested = false;
+        m_screenshotCount++;
+    }
+}
+
+void DXSample::PresentFrame()
+{
+    // Headless frames only leave the GPU through captures.
+    if (!m_headless)
+    {
+        ThrowIfFailed(m_swapChain->Present(0, 0));
+    }
+}
+
+// Close and submit a pooled command list, then hand it back to the pool
+// tagged with the fence value that tells when it can be recycled.
+UINT64 DXSample::ExecutePooledCommandList(CommandContext* context)
+{
+    ThrowIfFailed(context->CommandList->Close());
+    ID3D12CommandList* cmdLists[] = { context->CommandList.Get() };
+    m_commandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+
+    // Use the next value of the current frame, like WaitForGPU does.
+    const UINT64 fenceValue = m_fenceValues[m_frameIndex];
+    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+    m_fenceValues[m_frameIndex]++;
+
+    m_commandListPool->Release(context, fenceValue);
+    return fenceValue;
 }
\ No newline at end of file
@@ -2,6 +2,23 @@
 #include "DXSampleHelper.h"
 #include "Win32Application.h"
 #include "GameTimer.h"
+#include "GpuMemoryTracker.h"
+#include "CommandListPool.h"
+#include "UploadEngine.h"
+#include "AssetArchive.h"
+#include "AsyncIoService.h"
+#include "ReadbackRing.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "TaskGraph.h"
+#include "PipelineStateCache.h"
+#include "RootSignatureCache.h"
+#include "AsyncPipelineCompiler.h"
+#include "FileWatcher.h"
+#include "JobSystem.h"
+#include "ParallelCommandRecorder.h"
+#include "ResourceStateTracker.h"
+#include "RenderGraphExecutor.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -30,7 +47,17 @@ public:
         }
         else if(wParam==VK_F2)
         {
-            m_4xMsaaState = !m_4xMsaaState;
+            Set4xMsaaState(!m_4xMsaaState);
+        }
+        else if (wParam == VK_F3)
+        {
+            // Dump the GPU memory report next to the executable.
+            GpuMemoryTracker::WriteJson(GetAssetFullPath(L"GpuMemory.json"));
+        }
+        else if (wParam == VK_F4)
+        {
+            // Picked up by RecordScreenshot() in the next frame.
+            m_screenshotRequested = true;
         }
     }
     virtual void OnResize();
@@ -40,6 +67,10 @@ public:
     virtual void OnMouseUp(WPARAM btnState,int x,int y){}
     virtual void OnMouseMove(WPARAM btnState,int x,int y){}
 
+    // With -hotReload, called at a frame boundary with the asset files that
+    // were edited, named relative to the asset directory.
+    virtual void OnFilesChanged(const std::vector<std::wstring>& fileNames) {}
+
     //Accessors
     UINT GetWidth()const { return m_width; }
     UINT GetHeight()const { return m_height; }
@@ -49,6 +80,7 @@ public:
     bool GetWindowMaximized()const;
     bool GetWindowResizing()const;
     bool GetProgramPauseState()const;
+    bool IsHeadless()const { return m_headless; }
 
     void ParseCommandLineArgs(_In_reads_(argc) WCHAR* argv[], int argc);
     void StopTimer();
@@ -69,6 +101,18 @@ public:
 
 protected:
     std::wstring GetAssetFullPath(LPCWSTR assetName);
+    IoRequestId LoadAssetAsync(LPCWSTR assetName, IoPriority priority, IoCompletion completion);
+    IoResult LoadAsset(LPCWSTR assetName);
+    void RunInitGraph(TaskGraph& graph);
+    void CreateStateCaches();
+    ComPtr<ID3D12RootSignature> CreateRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc);
+    ComPtr<ID3DBlob> CompileShaderCached(LPCSTR sourceName, const ByteSpan& source, LPCSTR entryPoint, LPCSTR target);
+    std::unique_ptr<ShaderPermutationSet> CreateShaderPermutations(LPCSTR sourceName, const ByteSpan& source,
+        LPCSTR entryPoint, LPCSTR target, const std::vector<std::string>& keywords);
+    bool IsCaptureFrame()const;
+    bool IsScreenshotDue()const;
+    void RecordScreenshot(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* renderTarget);
+    void PresentFrame();
     void GetHardwareAdapter(_In_ IDXGIFactory2* pFactory, _Outptr_result_maybenull_ IDXGIAdapter1** ppAdapter);
     void SetCustomWindowText(LPCWSTR text);
     virtual void CreateFactoryDeviceAdapter();
@@ -98,8 +142,19 @@ protected:
     D3D12_CPU_DESCRIPTOR_HANDLE GetCurrentBackBufferView()const;
     D3D12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView()const;
 
+    // The scene renders into the 4X MSAA target while MSAA is on, which is
+    // then resolved into the back buffer, and into the back buffer otherwise.
+    // PrepareToPresent records every transition still pending, the back
+    // buffer's to PRESENT included, in one call.
+    ID3D12Resource* GetSceneRenderTarget()const;
+    D3D12_CPU_DESCRIPTOR_HANDLE GetSceneRenderTargetView()const;
+    DXGI_SAMPLE_DESC GetSceneSampleDesc(bool msaa)const;
+    ID3D12Resource* GetSceneDepthStencil()const;
+    void PrepareToPresent(ID3D12GraphicsCommandList* cmdList);
+
     void WaitForGPU();
     void MoveToNextFrame();
+    UINT64 ExecutePooledCommandList(CommandContext* context);
 
     virtual void BuildConstantDescriptorHeaps() = 0;
     virtual void BuildConstantBuffers() = 0;
@@ -121,6 +176,35 @@ protected:
     bool m_4xMsaaState = false;  // Is 4xMsaa Enabled ?
     UINT m_4xMsaaQuality = 0;    // Quality level of 4X MSAA
 
+    // Screenshot requested with F4, numbered in capture order.
+    bool m_screenshotRequested = false;
+    UINT m_screenshotCount = 0;
+
+    // Golden image runs: -headless renders into offscreen targets instead of a
+    // swap chain, -capture 1,60 writes those frames to -captureDir and -frames
+    // quits after that many. Frames are counted from when all asynchronous
+    // loads have finished, so the same frame always shows the same image.
+    bool m_headless = false;
+
+    // -serialInit runs the init stages one after the other, to compare startup times.
+    bool m_serialInit = false;
+    // -initReport <file> appends the init stage timings to file, so serial and
+    // parallel runs can be compared outside a debugger.
+    std::wstring m_initReportFile;
+
+    // -hotReload watches the asset directory and reads loose files even when
+    // assets.pak has them, so edits show up without a restart.
+    bool m_hotReload = false;
+    std::unique_ptr<FileWatcher> m_fileWatcher;
+
+    // -drawCount n repeats the scene's draws n times, each copy failing the
+    // depth test, so the image stays the same while recording gets heavier.
+    UINT m_drawCount = 1;
+    std::vector<UINT> m_captureFrames;
+    std::wstring m_captureDirectory;
+    UINT m_frameLimit = 0;
+    UINT m_frameNumber = 0;
+
     // Used to keep track of the delta-time and game time
     GameTimer mTimer;
 
@@ -139,6 +223,20 @@ protected:
     ComPtr<ID3D12CommandQueue>                  m_commandQueue;
     std::vector<ComPtr<ID3D12CommandAllocator>> m_commandAllocators;
     ComPtr<ID3D12GraphicsCommandList>       m_commandList;
+    std::unique_ptr<CommandListPool>        m_commandListPool;  // Extra recording beyond the per frame list.
+    std::unique_ptr<ThreadPool>             m_workerPool;       // General CPU workers, outlives their users.
+    std::unique_ptr<JobSystem>              m_jobSystem;        // Short jobs within a frame, such as recording.
+    std::unique_ptr<ParallelCommandRecorder> m_sceneRecorder;   // Frame recorded into several lists in parallel.
+    std::unique_ptr<UploadEngine>           m_uploadEngine;     // Copy queue uploads.
+    std::unique_ptr<AsyncIoService>         m_ioService;        // Background file loading.
+    std::unique_ptr<ReadbackRing>           m_readbackRing;     // GPU to CPU copies, committed per frame.
+    std::unique_ptr<ResourceStateTracker>   m_stateTracker;     // Direct queue resource states, batched barriers.
+    std::unique_ptr<RenderGraphExecutor>    m_renderGraph;      // The frame's passes, built and executed every frame.
+    std::shared_ptr<AssetArchive>           m_assetArchive;     // assets.pak, if one was built.
+    std::unique_ptr<ShaderCache>            m_shaderCache;      // Compiled shaders kept across runs.
+    std::unique_ptr<RootSignatureCache>     m_rootSignatureCache;   // Deduped root signatures, blobs kept across runs.
+    std::unique_ptr<PipelineStateCache>     m_pipelineStateCache;   // Deduped PSOs, driver blobs kept across runs.
+    std::unique_ptr<AsyncPipelineCompiler>  m_pipelineCompiler;     // Background PSO creation through the cache.
     ComPtr<IDXGISwapChain3>                 m_swapChain;
     ComPtr<IDXGIFactory4>                   m_factory;
     ComPtr<ID3D12RootSignature>             m_rootSignature;
@@ -156,9 +254,12 @@ protected:
     UINT                                    m_frameCount = 2;
     std::vector<ComPtr<ID3D12Resource>>     m_renderTargets;
     ComPtr<ID3D12Resource>                  m_depthStencilBuffer;
+    ComPtr<ID3D12Resource>                  m_msaaRenderTarget;         // Resolved into the back buffer.
+    ComPtr<ID3D12Resource>                  m_msaaDepthStencilBuffer;
 
     // Synchronization objects.
     ComPtr<ID3D12Fence>                     m_fence;
+    D3D12FenceSource                        m_fenceSource{ m_fence };   // What pooled contexts wait on.
     UINT                                    m_frameIndex = 0;
     HANDLE                                  m_fenceEvent;
     std::vector<UINT64>                     m_fenceValues;
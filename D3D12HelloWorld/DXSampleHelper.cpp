@@ -1,18 +1,16 @@
 #include "stdafx.h"
 #include "DXSampleHelper.h"
+#include "GpuMemoryTracker.h"
+#include "SubresourceCopy.h"
 
 
-ComPtr<ID3D12Resource> CreateDefaultBuffer(
+ComPtr<ID3D12Resource> CreateDefaultBufferResource(
     ID3D12Device* device,
-    ID3D12GraphicsCommandList* cmdList,
-    const void* initData,
     UINT64 byteSize,
-    ComPtr<ID3D12Resource>& uploadBuffer
+    LPCWSTR name
 )
 {
     ComPtr<ID3D12Resource> defaultBuffer;
-
-    // Create actual default buffer resource.
     ThrowIfFailed(device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
         D3D12_HEAP_FLAG_NONE,
@@ -21,9 +19,112 @@ ComPtr<ID3D12Resource> CreateDefaultBuffer(
         nullptr,
         IID_PPV_ARGS(defaultBuffer.GetAddressOf())
     ));
+    GpuMemoryTracker::TrackResource(defaultBuffer.Get(), GpuMemoryCategory::Buffer, name);
+
+    return defaultBuffer;
+}
+
+UINT64 GetBufferUploadsSize(const BufferUpload* uploads, UINT numUploads)
+{
+    UINT64 byteSize = 0;
+    for (UINT i = 0; i < numUploads; i++)
+    {
+        byteSize += uploads[i].ByteSize;
+    }
+    return byteSize;
+}
+
+UINT RecordBufferUploads(
+    ID3D12GraphicsCommandList* cmdList,
+    ID3D12Resource* stagingBuffer,
+    UINT64 stagingOffset,
+    void* mappedStaging,
+    const BufferUpload* uploads,
+    UINT numUploads
+)
+{
+    // Uploads are packed back to back, so a run of uploads that is also
+    // contiguous in its destination can be copied in one go.
+    BYTE* pStaging = reinterpret_cast<BYTE*>(mappedStaging) + stagingOffset;
+    UINT numCopies = 0;
+    UINT64 runStagingOffset = stagingOffset;
+    UINT64 runSize = 0;
+    const BufferUpload* pRun = nullptr;
+
+    for (UINT i = 0; i < numUploads; i++)
+    {
+        const BufferUpload& upload = uploads[i];
+        StreamingCopy(pStaging, upload.Data, static_cast<size_t>(upload.ByteSize));
+        pStaging += upload.ByteSize;
+
+        if (pRun && pRun->Destination == upload.Destination &&
+            pRun->DestinationOffset + runSize == upload.DestinationOffset)
+        {
+            runSize += upload.ByteSize;
+            continue;
+        }
+
+        if (pRun && runSize > 0)
+        {
+            cmdList->CopyBufferRegion(pRun->Destination, pRun->DestinationOffset, stagingBuffer, runStagingOffset, runSize);
+            numCopies++;
+        }
+        runStagingOffset += runSize;
+        runSize = upload.ByteSize;
+        pRun = &upload;
+    }
+
+    if (pRun && runSize > 0)
+    {
+        cmdList->CopyBufferRegion(pRun->Destination, pRun->DestinationOffset, stagingBuffer, runStagingOffset, runSize);
+        numCopies++;
+    }
+    return numCopies;
+}
+
+// Build one transition per distinct destination of the batch.
+static std::vector<D3D12_RESOURCE_BARRIER> BuildBufferUploadBarriers(
+    const BufferUpload* uploads,
+    UINT numUploads,
+    D3D12_RESOURCE_STATES stateBefore,
+    D3D12_RESOURCE_STATES stateAfter
+)
+{
+    std::vector<ID3D12Resource*> destinations;
+    destinations.reserve(numUploads);
+    for (UINT i = 0; i < numUploads; i++)
+    {
+        destinations.push_back(uploads[i].Destination);
+    }
+    std::sort(destinations.begin(), destinations.end());
+    destinations.erase(std::unique(destinations.begin(), destinations.end()), destinations.end());
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    barriers.reserve(destinations.size());
+    for (ID3D12Resource* destination : destinations)
+    {
+        barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(destination, stateBefore, stateAfter));
+    }
+    return barriers;
+}
+
+void UploadBuffers(
+    ID3D12Device* device,
+    ID3D12GraphicsCommandList* cmdList,
+    const BufferUpload* uploads,
+    UINT numUploads,
+    ComPtr<ID3D12Resource>& uploadBuffer,
+    LPCWSTR name
+)
+{
+    const UINT64 byteSize = GetBufferUploadsSize(uploads, numUploads);
+    if (byteSize == 0)
+    {
+        return;
+    }
 
-    // In order to copy CPU memory data into our default buffer, we need
-    // to create an intermediate upload buffer.
+    // In order to copy CPU memory data into our default buffers, we need
+    // an intermediate upload buffer. One is enough for the whole batch.
     ThrowIfFailed(device->CreateCommittedResource(
         &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
         D3D12_HEAP_FLAG_NONE,
@@ -32,33 +133,85 @@ ComPtr<ID3D12Resource> CreateDefaultBuffer(
         nullptr,
         IID_PPV_ARGS(&uploadBuffer)
     ));
+    GpuMemoryTracker::TrackResource(uploadBuffer.Get(), GpuMemoryCategory::Upload, name);
 
-    // Describe the data we want to copy into the default buffer.
-    D3D12_SUBRESOURCE_DATA subResourceData = {};
-    subResourceData.pData = initData;
-    subResourceData.RowPitch = byteSize;
-    subResourceData.SlicePitch = subResourceData.RowPitch;
+    std::vector<D3D12_RESOURCE_BARRIER> barriers = BuildBufferUploadBarriers(uploads, numUploads,
+        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+    cmdList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
 
-    // Schedule to copy the data to the default buffer resource.
-    // At a high level, the helper function UpdateSubresources
-    // will copy the CPU memory into the intermediate upload heap.
-    // Then, using ID3D12CommandList::CopySubresourceRegion,
-    // the intermediate upload heap data will be copied to m_buffer.
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-        D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST
-    ));
-    UpdateSubresources<1>(cmdList, defaultBuffer.Get(), uploadBuffer.Get(), 0, 0, 1, &subResourceData);
-    cmdList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
-        D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ
-    ));
+    void* mappedData = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(uploadBuffer->Map(0, &readRange, &mappedData));
+    RecordBufferUploads(cmdList, uploadBuffer.Get(), 0, mappedData, uploads, numUploads);
+    uploadBuffer->Unmap(0, nullptr);
+
+    for (D3D12_RESOURCE_BARRIER& barrier : barriers)
+    {
+        barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+        barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
+    }
+    cmdList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
 
     // Note: uploadBuffer has to be kept alive after the above function calls because
     // the command list has not been executed yet that performs the actual copy.
     // The caller can Release the uploadBuffer after it knows the copy has been executed.
+}
+
+ComPtr<ID3D12Resource> CreateDefaultBuffer(
+    ID3D12Device* device,
+    ID3D12GraphicsCommandList* cmdList,
+    const void* initData,
+    UINT64 byteSize,
+    ComPtr<ID3D12Resource>& uploadBuffer,
+    LPCWSTR name
+)
+{
+    // Create actual default buffer resource.
+    ComPtr<ID3D12Resource> defaultBuffer = CreateDefaultBufferResource(device, byteSize, name);
+
+    // Schedule to copy the data to the default buffer resource.
+    BufferUpload upload;
+    upload.Destination = defaultBuffer.Get();
+    upload.Data = initData;
+    upload.ByteSize = byteSize;
+    UploadBuffers(device, cmdList, &upload, 1, uploadBuffer, name);
 
     return defaultBuffer;
 }
 
+bool ReadFileBytes(const std::wstring& filename, std::vector<BYTE>& data)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+bool WriteFileAtomic(const std::wstring& filename, const void* data, SIZE_T size)
+{
+    // Per thread, two threads may write the same file at once.
+    const std::wstring tempFilename = filename + L"." + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+    {
+        std::ofstream file(tempFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char*>(data), size);
+        if (!file)
+        {
+            file.close();
+            DeleteFileW(tempFilename.c_str());
+            return false;
+        }
+    }
+    if (!MoveFileExW(tempFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        DeleteFileW(tempFilename.c_str());
+        return false;
+    }
+    return true;
+}
+
 inline std::string HrToString(HRESULT hr)
 {
     char s_str[64] = {};
@@ -5,6 +5,7 @@
 #endif
 
 #include "stdafx.h"
+#include "Hash.h"
 #include <stdexcept>
 #include <comdef.h>
 
@@ -69,6 +70,8 @@ inline void GetAssetsPath(_Out_writes_(pathSize) WCHAR* path, UINT pathSize)
     }
 }
 
+// Reads a whole file into a malloc'ed buffer the caller has to free.
+// Prefer MappedFile, which avoids the copy and supports files over 4 GiB.
 inline HRESULT ReadDataFromFile(LPCTSTR filename, byte** data, UINT* size)
 {
     using namespace Microsoft::WRL;
@@ -83,23 +86,38 @@ inline HRESULT ReadDataFromFile(LPCTSTR filename, byte** data, UINT* size)
     Wrappers::FileHandle file(CreateFile2(filename, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &extendedParams));
     if (file.Get() == INVALID_HANDLE_VALUE)
     {
-        throw std::exception();
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
     }
     FILE_STANDARD_INFO fileInfo = {};
     if (!GetFileInformationByHandleEx(file.Get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
     {
-        throw std::exception();
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
     }
     if (fileInfo.EndOfFile.HighPart != 0)
     {
-        throw std::exception();
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE));
     }
     *data = reinterpret_cast<byte*>(malloc(fileInfo.EndOfFile.LowPart));
+    if (*data == nullptr)
+    {
+        ThrowIfFailed(E_OUTOFMEMORY);
+    }
     *size = fileInfo.EndOfFile.LowPart;
 
-    if (!ReadFile(file.Get(), *data, fileInfo.EndOfFile.LowPart, nullptr, nullptr))
+    DWORD bytesRead = 0;
+    if (!ReadFile(file.Get(), *data, fileInfo.EndOfFile.LowPart, &bytesRead, nullptr))
     {
-        throw std::exception();
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        free(*data);
+        *data = nullptr;
+        ThrowIfFailed(hr);
+    }
+    // The file may have been truncated since its size was queried.
+    if (bytesRead != fileInfo.EndOfFile.LowPart)
+    {
+        free(*data);
+        *data = nullptr;
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
     }
 
     return S_OK;
@@ -169,6 +187,34 @@ inline Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 }
 #endif
 
+// Same as CompileShader but for HLSL source already in memory.
+inline Microsoft::WRL::ComPtr<ID3DBlob> CompileShaderFromSource(
+    const void* sourceData,
+    SIZE_T sourceSize,
+    const std::string& sourceName,
+    const D3D_SHADER_MACRO* defines,
+    const std::string& entrypoint,
+    const std::string& target)
+{
+    UINT compileFlags = 0;
+#if defined(_DEBUG) || defined(DBG)
+    compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+    Microsoft::WRL::ComPtr<ID3DBlob> byteCode = nullptr;
+    Microsoft::WRL::ComPtr<ID3DBlob> errors;
+    HRESULT hr = D3DCompile(sourceData, sourceSize, sourceName.c_str(), defines, nullptr,
+        entrypoint.c_str(), target.c_str(), compileFlags, 0, &byteCode, &errors);
+
+    if (errors != nullptr)
+    {
+        OutputDebugStringA((char*)errors->GetBufferPointer());
+    }
+    ThrowIfFailed(hr);
+
+    return byteCode;
+}
+
 // Resets all elements in a ComPtr array.
 template<class T>
 void ResetComPtrArray(T* comPtrArray)
@@ -190,10 +236,63 @@ void ResetUniquePtrArray(T* uniquePtrArray)
     }
 }
 
+// One buffer upload of a batch.
+struct BufferUpload
+{
+    ID3D12Resource* Destination = nullptr;
+    UINT64 DestinationOffset = 0;
+    const void* Data = nullptr;
+    UINT64 ByteSize = 0;
+};
+
+// Create a default heap buffer in the COMMON state.
+ComPtr<ID3D12Resource> CreateDefaultBufferResource(
+    ID3D12Device* device,
+    UINT64 byteSize,
+    LPCWSTR name = L"DefaultBuffer"
+);
+
+// Staging memory needed to upload the whole batch.
+UINT64 GetBufferUploadsSize(const BufferUpload* uploads, UINT numUploads);
+
+// Pack the batch into mapped staging memory starting at stagingOffset and
+// record the copies. Uploads continuing the previous one in the same
+// destination are merged into a single CopyBufferRegion.
+// Returns the number of copies recorded.
+UINT RecordBufferUploads(
+    ID3D12GraphicsCommandList* cmdList,
+    ID3D12Resource* stagingBuffer,
+    UINT64 stagingOffset,
+    void* mappedStaging,
+    const BufferUpload* uploads,
+    UINT numUploads
+);
+
+// Upload many buffers through one upload buffer on a direct command list.
+// Destinations must be in the COMMON state and end up in GENERIC_READ, each
+// of them is transitioned once in a single batched ResourceBarrier call
+// before and after the copies.
+void UploadBuffers(
+    ID3D12Device* device,
+    ID3D12GraphicsCommandList* cmdList,
+    const BufferUpload* uploads,
+    UINT numUploads,
+    ComPtr<ID3D12Resource>& uploadBuffer,
+    LPCWSTR name = L"UploadBuffers"
+);
+
 ComPtr<ID3D12Resource> CreateDefaultBuffer(
     ID3D12Device* device,
     ID3D12GraphicsCommandList* cmdList,
     const void* initData,
     UINT64 byteSize,
-    ComPtr<ID3D12Resource>& uploadBuffer
-);
\ No newline at end of file
+    ComPtr<ID3D12Resource>& uploadBuffer,
+    LPCWSTR name = L"DefaultBuffer"
+);
+
+// Whole file into data. Returns false if it can not be read.
+bool ReadFileBytes(const std::wstring& filename, std::vector<BYTE>& data);
+
+// Write through a temporary file swapped in at the end, so concurrent readers
+// and crashes never see half a file. Returns false if it could not be written.
+bool WriteFileAtomic(const std::wstring& filename, const void* data, SIZE_T size);
\ No newline at end of file
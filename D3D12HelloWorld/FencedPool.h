@@ -0,0 +1,90 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// How far a queue has got. An ID3D12Fence in the samples, a counter in tests.
+class FenceSource
+{
+public:
+    virtual ~FenceSource() = default;
+    virtual uint64_t GetCompletedValue()const = 0;
+};
+
+// Objects handed out for recording and given back tagged with the fence value
+// of the submission that used them. An object is only handed out again once
+// the fence has passed that value, so its memory is never reused while the
+// GPU may still read from it. The pool knows nothing about the API, creating
+// and resetting objects is up to its owner.
+template <typename T>
+class FencedPool
+{
+public:
+    explicit FencedPool(const FenceSource& fence) :
+        m_fence(fence)
+    {
+    }
+
+    FencedPool(const FencedPool& rhs) = delete;
+    FencedPool& operator=(const FencedPool& rhs) = delete;
+
+    // The oldest object the GPU is done with, null if there is none.
+    T* TryRecycle()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_retired.empty() || m_retired.front().FenceValue > m_fence.GetCompletedValue())
+        {
+            return nullptr;
+        }
+        T* object = m_retired.front().Object;
+        m_retired.pop_front();
+        return object;
+    }
+
+    // Grows the pool by object, which is handed out right away.
+    T* Add(std::unique_ptr<T> object)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_objects.push_back(std::move(object));
+        return m_objects.back().get();
+    }
+
+    // fenceValue is signaled after the last submission using object. Fence
+    // values only grow on a queue, so checking the oldest is enough.
+    void Release(T* object, uint64_t fenceValue)
+    {
+        assert(object);
+        std::lock_guard<std::mutex> lock(m_lock);
+        assert(m_retired.empty() || m_retired.back().FenceValue <= fenceValue);
+        m_retired.push_back({ object, fenceValue });
+    }
+
+    // Objects ever added.
+    size_t GetCreatedCount()const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_objects.size();
+    }
+
+    // Objects waiting in the pool, completed or not.
+    size_t GetRetiredCount()const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_retired.size();
+    }
+
+private:
+    struct Retired
+    {
+        T* Object;
+        uint64_t FenceValue;
+    };
+
+    const FenceSource& m_fence;
+    std::vector<std::unique_ptr<T>> m_objects;
+    std::deque<Retired> m_retired;
+    mutable std::mutex m_lock;
+};
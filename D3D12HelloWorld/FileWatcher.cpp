@@ -0,0 +1,118 @@
+#include "stdafx.h"
+#include "FileWatcher.h"
+
+FileWatcher::FileWatcher(const std::wstring& directory)
+{
+    m_directory = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (m_directory == INVALID_HANDLE_VALUE)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    m_stopEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!m_stopEvent)
+    {
+        const HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        CloseHandle(m_directory);
+        ThrowIfFailed(hr);
+    }
+
+    m_thread = std::thread(&FileWatcher::WatchLoop, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+    SetEvent(m_stopEvent);
+    m_thread.join();
+    CloseHandle(m_stopEvent);
+    CloseHandle(m_directory);
+}
+
+std::vector<std::wstring> FileWatcher::TakeChanges(std::chrono::milliseconds settleTime)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_changes.empty() || std::chrono::steady_clock::now() - m_lastChange < settleTime)
+    {
+        return {};
+    }
+    std::vector<std::wstring> changes;
+    changes.swap(m_changes);
+    return changes;
+}
+
+void FileWatcher::AddChange(const std::wstring& name)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_lastChange = std::chrono::steady_clock::now();
+    auto same = std::find_if(m_changes.begin(), m_changes.end(), [&name](const std::wstring& change)
+    {
+        return _wcsicmp(change.c_str(), name.c_str()) == 0;
+    });
+    if (same == m_changes.end())
+    {
+        m_changes.push_back(name);
+    }
+}
+
+void FileWatcher::WatchLoop()
+{
+    // DWORD aligned, as ReadDirectoryChangesW requires.
+    std::vector<DWORD> buffer(16 * 1024);
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!overlapped.hEvent)
+    {
+        return;
+    }
+
+    const DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+    for (;;)
+    {
+        ResetEvent(overlapped.hEvent);
+        if (!ReadDirectoryChangesW(m_directory, buffer.data(), static_cast<DWORD>(buffer.size() * sizeof(DWORD)),
+            FALSE, filter, nullptr, &overlapped, nullptr))
+        {
+            break;
+        }
+
+        HANDLE events[] = { m_stopEvent, overlapped.hEvent };
+        if (WaitForMultipleObjects(_countof(events), events, FALSE, INFINITE) != WAIT_OBJECT_0 + 1)
+        {
+            // Stopping, the read has to finish before the buffer goes away.
+            CancelIoEx(m_directory, &overlapped);
+            DWORD bytes;
+            GetOverlappedResult(m_directory, &overlapped, &bytes, TRUE);
+            break;
+        }
+
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(m_directory, &overlapped, &bytes, FALSE))
+        {
+            break;
+        }
+        if (bytes == 0)
+        {
+            // The buffer overflowed, which changes is unknown.
+            AddChange(L"*");
+            continue;
+        }
+
+        const BYTE* entry = reinterpret_cast<const BYTE*>(buffer.data());
+        for (;;)
+        {
+            const FILE_NOTIFY_INFORMATION& info = *reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+            if (info.Action != FILE_ACTION_REMOVED && info.Action != FILE_ACTION_RENAMED_OLD_NAME)
+            {
+                AddChange(std::wstring(info.FileName, info.FileNameLength / sizeof(WCHAR)));
+            }
+            if (info.NextEntryOffset == 0)
+            {
+                break;
+            }
+            entry += info.NextEntryOffset;
+        }
+    }
+    CloseHandle(overlapped.hEvent);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "stdafx.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// Watches one directory, not its subdirectories, for files being written,
+// created or renamed, on a thread of its own blocked in ReadDirectoryChangesW.
+// The frame loop polls TakeChanges, so changes are always handled at a
+// frame boundary.
+class FileWatcher
+{
+public:
+    // Throws HrException if the directory can not be opened.
+    explicit FileWatcher(const std::wstring& directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher& rhs) = delete;
+    FileWatcher& operator=(const FileWatcher& rhs) = delete;
+
+    // Names relative to the directory of every file changed since the last
+    // call, each once. Editors often write a file in several steps, so
+    // changes are only handed out once none arrived for settleTime.
+    // "*" stands for changes that were lost because too many arrived at once.
+    std::vector<std::wstring> TakeChanges(std::chrono::milliseconds settleTime = std::chrono::milliseconds(50));
+
+private:
+    void WatchLoop();
+    void AddChange(const std::wstring& name);
+
+    HANDLE m_directory;
+    HANDLE m_stopEvent;
+    std::thread m_thread;
+
+    std::vector<std::wstring> m_changes;
+    std::chrono::steady_clock::time_point m_lastChange;
+    std::mutex m_lock;
+};
@@ -0,0 +1,274 @@
+#include "stdafx.h"
+#include "GpuMemoryTracker.h"
+#include "DXSampleHelper.h"
+
+// {6F1C2D0A-8B7E-4C55-9A4D-3E2B1F0C9D71}
+static const GUID GpuMemoryTrackerSentinelGuid =
+{ 0x6f1c2d0a, 0x8b7e, 0x4c55, { 0x9a, 0x4d, 0x3e, 0x2b, 0x1f, 0x0c, 0x9d, 0x71 } };
+
+// Attached to a resource as private data. D3D12 releases private data
+// interfaces when the owning object is destroyed, which lets us drop the
+// registry entry without every caller having to remember to do it.
+class GpuResourceReleaseSentinel : public IUnknown
+{
+public:
+    GpuResourceReleaseSentinel(UINT_PTR key, UINT64 id) :
+        m_key(key), m_id(id)
+    {}
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+    {
+        if (ppvObject == nullptr)
+        {
+            return E_POINTER;
+        }
+        if (riid == __uuidof(IUnknown))
+        {
+            *ppvObject = static_cast<IUnknown*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return InterlockedIncrement(&m_refCount);
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG refCount = InterlockedDecrement(&m_refCount);
+        if (refCount == 0)
+        {
+            GpuMemoryTracker::UntrackResource(m_key, m_id);
+            delete this;
+        }
+        return refCount;
+    }
+
+private:
+    volatile ULONG m_refCount = 1;
+    UINT_PTR m_key;
+    UINT64 m_id;
+};
+
+std::mutex& GpuMemoryTracker::GetLock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+std::unordered_map<UINT_PTR, GpuMemoryTracker::Entry>& GpuMemoryTracker::GetEntries()
+{
+    static std::unordered_map<UINT_PTR, Entry> entries;
+    return entries;
+}
+
+void GpuMemoryTracker::TrackResource(ID3D12Resource* resource, GpuMemoryCategory category, LPCWSTR name)
+{
+    if (resource == nullptr)
+    {
+        return;
+    }
+
+    GpuMemoryAllocation allocation;
+    allocation.Name = name ? name : L"";
+    allocation.Category = category;
+
+    // Ask the device how much memory the resource really occupies, this
+    // includes the placement alignment the driver applies.
+    const CD3DX12_RESOURCE_DESC desc(resource->GetDesc());
+    ComPtr<ID3D12Device> device;
+    if (SUCCEEDED(resource->GetDevice(IID_PPV_ARGS(&device))))
+    {
+        D3D12_RESOURCE_ALLOCATION_INFO info = device->GetResourceAllocationInfo(0, 1, &desc);
+        if (info.SizeInBytes != UINT64_MAX)
+        {
+            allocation.SizeInBytes = info.SizeInBytes;
+        }
+        else if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        {
+            allocation.SizeInBytes = desc.Width;
+        }
+        else
+        {
+            // Fall back to what a copy of every subresource takes, which
+            // accounts for the format's bytes per pixel and the mips.
+            allocation.SizeInBytes = GetRequiredIntermediateSize(resource, 0, desc.Subresources(device.Get()));
+        }
+    }
+
+    D3D12_HEAP_PROPERTIES heapProperties = {};
+    D3D12_HEAP_FLAGS heapFlags = D3D12_HEAP_FLAG_NONE;
+    if (SUCCEEDED(resource->GetHeapProperties(&heapProperties, &heapFlags)))
+    {
+        allocation.HeapType = heapProperties.Type;
+    }
+
+    static UINT64 s_nextId = 1;
+    const UINT_PTR key = reinterpret_cast<UINT_PTR>(resource);
+    UINT64 id;
+    {
+        std::lock_guard<std::mutex> lock(GetLock());
+        id = s_nextId++;
+        GetEntries()[key] = { id, allocation };
+    }
+
+    // Replacing an older sentinel releases it, its id no longer matches
+    // so the fresh entry stays in place.
+    GpuResourceReleaseSentinel* sentinel = new GpuResourceReleaseSentinel(key, id);
+    resource->SetPrivateDataInterface(GpuMemoryTrackerSentinelGuid, sentinel);
+    sentinel->Release();
+}
+
+void GpuMemoryTracker::UntrackResource(UINT_PTR key, UINT64 id)
+{
+    std::lock_guard<std::mutex> lock(GetLock());
+    auto& entries = GetEntries();
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.Id == id)
+    {
+        entries.erase(it);
+    }
+}
+
+GpuMemorySummary GpuMemoryTracker::GetSummary()
+{
+    GpuMemorySummary summary;
+    std::lock_guard<std::mutex> lock(GetLock());
+    for (const auto& entry : GetEntries())
+    {
+        const GpuMemoryAllocation& allocation = entry.second.Allocation;
+        const size_t category = static_cast<size_t>(allocation.Category);
+        summary.Bytes[category] += allocation.SizeInBytes;
+        summary.Counts[category]++;
+        summary.TotalBytes += allocation.SizeInBytes;
+        summary.TotalCount++;
+    }
+    return summary;
+}
+
+std::vector<GpuMemoryAllocation> GpuMemoryTracker::GetAllocations()
+{
+    std::vector<GpuMemoryAllocation> allocations;
+    {
+        std::lock_guard<std::mutex> lock(GetLock());
+        allocations.reserve(GetEntries().size());
+        for (const auto& entry : GetEntries())
+        {
+            allocations.push_back(entry.second.Allocation);
+        }
+    }
+
+    // Largest first, that is what people look for.
+    std::sort(allocations.begin(), allocations.end(),
+        [](const GpuMemoryAllocation& a, const GpuMemoryAllocation& b) { return a.SizeInBytes > b.SizeInBytes; });
+    return allocations;
+}
+
+const char* GpuMemoryTracker::GetCategoryName(GpuMemoryCategory category)
+{
+    switch (category)
+    {
+    case GpuMemoryCategory::Buffer:         return "Buffer";
+    case GpuMemoryCategory::Upload:         return "Upload";
+    case GpuMemoryCategory::Texture:        return "Texture";
+    case GpuMemoryCategory::RenderTarget:   return "RenderTarget";
+    case GpuMemoryCategory::DepthStencil:   return "DepthStencil";
+    default:                                return "Unknown";
+    }
+}
+
+const char* GpuMemoryTracker::GetHeapTypeName(D3D12_HEAP_TYPE heapType)
+{
+    switch (heapType)
+    {
+    case D3D12_HEAP_TYPE_DEFAULT:   return "Default";
+    case D3D12_HEAP_TYPE_UPLOAD:    return "Upload";
+    case D3D12_HEAP_TYPE_READBACK:  return "Readback";
+    case D3D12_HEAP_TYPE_CUSTOM:    return "Custom";
+    default:                        return "Unknown";
+    }
+}
+
+// Convert a debug name to UTF-8 and escape it for a JSON string.
+static std::string ToJsonString(const std::wstring& str)
+{
+    std::string utf8;
+    if (!str.empty())
+    {
+        int length = WideCharToMultiByte(CP_UTF8, 0, str.c_str(), (int)str.size(), nullptr, 0, nullptr, nullptr);
+        utf8.resize(length);
+        WideCharToMultiByte(CP_UTF8, 0, str.c_str(), (int)str.size(), &utf8[0], length, nullptr, nullptr);
+    }
+
+    std::string escaped = "\"";
+    for (char c : utf8)
+    {
+        switch (c)
+        {
+        case '"':   escaped += "\\\""; break;
+        case '\\':  escaped += "\\\\"; break;
+        case '\n':  escaped += "\\n"; break;
+        case '\r':  escaped += "\\r"; break;
+        case '\t':  escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                sprintf_s(code, "\\u%04x", c);
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+    }
+    escaped += "\"";
+    return escaped;
+}
+
+std::string GpuMemoryTracker::DumpJson()
+{
+    GpuMemorySummary summary = GetSummary();
+    std::vector<GpuMemoryAllocation> allocations = GetAllocations();
+
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"totalBytes\": " << summary.TotalBytes << ",\n";
+    json << "  \"totalCount\": " << summary.TotalCount << ",\n";
+    json << "  \"categories\": {\n";
+    for (size_t i = 0; i < static_cast<size_t>(GpuMemoryCategory::Count); i++)
+    {
+        json << "    \"" << GetCategoryName(static_cast<GpuMemoryCategory>(i)) << "\": { \"bytes\": "
+            << summary.Bytes[i] << ", \"count\": " << summary.Counts[i] << " }";
+        json << (i + 1 < static_cast<size_t>(GpuMemoryCategory::Count) ? ",\n" : "\n");
+    }
+    json << "  },\n";
+    json << "  \"allocations\": [\n";
+    for (size_t i = 0; i < allocations.size(); i++)
+    {
+        const GpuMemoryAllocation& allocation = allocations[i];
+        json << "    { \"name\": " << ToJsonString(allocation.Name)
+            << ", \"category\": \"" << GetCategoryName(allocation.Category)
+            << "\", \"heap\": \"" << GetHeapTypeName(allocation.HeapType)
+            << "\", \"bytes\": " << allocation.SizeInBytes << " }";
+        json << (i + 1 < allocations.size() ? ",\n" : "\n");
+    }
+    json << "  ]\n";
+    json << "}\n";
+    return json.str();
+}
+
+void GpuMemoryTracker::WriteJson(const std::wstring& filename)
+{
+    std::ofstream file(filename, std::ios::out | std::ios::trunc);
+    if (!file)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED));
+    }
+    file << DumpJson();
+}
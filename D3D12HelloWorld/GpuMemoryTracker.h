@@ -0,0 +1,63 @@
+#pragma once
+#include "stdafx.h"
+#include <mutex>
+
+// Coarse classification used to answer "where does the GPU memory go".
+enum class GpuMemoryCategory
+{
+    Buffer = 0,
+    Upload,
+    Texture,
+    RenderTarget,
+    DepthStencil,
+    Count
+};
+
+// One live resource as seen by the tracker.
+struct GpuMemoryAllocation
+{
+    std::wstring Name;
+    GpuMemoryCategory Category = GpuMemoryCategory::Buffer;
+    D3D12_HEAP_TYPE HeapType = static_cast<D3D12_HEAP_TYPE>(0);
+    UINT64 SizeInBytes = 0;
+};
+
+struct GpuMemorySummary
+{
+    UINT64 Bytes[static_cast<size_t>(GpuMemoryCategory::Count)] = {};
+    UINT Counts[static_cast<size_t>(GpuMemoryCategory::Count)] = {};
+    UINT64 TotalBytes = 0;
+    UINT TotalCount = 0;
+};
+
+// Process wide registry of GPU resources.
+// Every creation path reports its resources here. The entry is removed
+// automatically when the D3D12 resource is destroyed, so whatever is still
+// listed at shutdown is a leak.
+class GpuMemoryTracker
+{
+public:
+    static void TrackResource(ID3D12Resource* resource, GpuMemoryCategory category, LPCWSTR name);
+
+    static GpuMemorySummary GetSummary();
+    static std::vector<GpuMemoryAllocation> GetAllocations();
+
+    // Serialize the summary and every live allocation as JSON.
+    static std::string DumpJson();
+    static void WriteJson(const std::wstring& filename);
+
+    static const char* GetCategoryName(GpuMemoryCategory category);
+    static const char* GetHeapTypeName(D3D12_HEAP_TYPE heapType);
+
+private:
+    friend class GpuResourceReleaseSentinel;
+    static void UntrackResource(UINT_PTR key, UINT64 id);
+
+    struct Entry
+    {
+        UINT64 Id;
+        GpuMemoryAllocation Allocation;
+    };
+    static std::mutex& GetLock();
+    static std::unordered_map<UINT_PTR, Entry>& GetEntries();
+};
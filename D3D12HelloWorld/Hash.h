@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a. Hash several pieces by passing the previous hash as seed.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
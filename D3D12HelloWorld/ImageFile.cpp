@@ -0,0 +1,192 @@
+#include "stdafx.h"
+#include "ImageFile.h"
+#include <limits>
+
+Image ImageFromRows(const BYTE* data, UINT width, UINT height, UINT rowPitch, DXGI_FORMAT format)
+{
+    bool swapRedBlue;
+    switch (format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        swapRedBlue = false;
+        break;
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        swapRedBlue = true;
+        break;
+    default:
+        ThrowIfFailed(E_INVALIDARG);
+        return Image();
+    }
+
+    Image image;
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.resize(SIZE_T(width) * height * 4);
+    for (UINT y = 0; y < height; y++)
+    {
+        const BYTE* src = data + SIZE_T(rowPitch) * y;
+        UINT8* dst = image.Pixels.data() + SIZE_T(width) * 4 * y;
+        memcpy(dst, src, SIZE_T(width) * 4);
+        if (swapRedBlue)
+        {
+            for (UINT x = 0; x < width; x++)
+            {
+                std::swap(dst[x * 4], dst[x * 4 + 2]);
+            }
+        }
+    }
+    return image;
+}
+
+void WritePpm(const std::wstring& filename, const Image& image)
+{
+    std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED));
+    }
+
+    file << "P6\n" << image.Width << " " << image.Height << "\n255\n";
+    std::vector<UINT8> row(SIZE_T(image.Width) * 3);
+    for (UINT y = 0; y < image.Height; y++)
+    {
+        const UINT8* src = image.Pixels.data() + SIZE_T(image.Width) * 4 * y;
+        for (UINT x = 0; x < image.Width; x++)
+        {
+            row[x * 3] = src[x * 4];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    if (!file)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_WRITE_FAULT));
+    }
+}
+
+// Skips whitespace and comments between PPM header fields.
+static UINT ReadPpmField(std::istream& file)
+{
+    while (file)
+    {
+        const int c = file.peek();
+        if (c == '#')
+        {
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        else if (isspace(c))
+        {
+            file.get();
+        }
+        else
+        {
+            break;
+        }
+    }
+    UINT value = 0;
+    file >> value;
+    return value;
+}
+
+Image ReadPpm(const std::wstring& filename)
+{
+    std::ifstream file(filename, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    }
+
+    char magic[2] = {};
+    file.read(magic, 2);
+    Image image;
+    image.Width = ReadPpmField(file);
+    image.Height = ReadPpmField(file);
+    const UINT maxValue = ReadPpmField(file);
+    file.get();
+    if (!file || magic[0] != 'P' || magic[1] != '6' || maxValue != 255)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+    }
+
+    // The header is not trusted with the allocation, the pixels have to be in the file.
+    const UINT64 pixelCount = UINT64(image.Width) * image.Height;
+    const std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    const UINT64 remaining = UINT64(file.tellg() - start);
+    file.seekg(start);
+    if (pixelCount > remaining / 3 || pixelCount > std::numeric_limits<SIZE_T>::max() / 4)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_BAD_FORMAT));
+    }
+
+    std::vector<UINT8> row(SIZE_T(image.Width) * 3);
+    image.Pixels.resize(SIZE_T(image.Width) * image.Height * 4);
+    for (UINT y = 0; y < image.Height; y++)
+    {
+        file.read(reinterpret_cast<char*>(row.data()), row.size());
+        UINT8* dst = image.Pixels.data() + SIZE_T(image.Width) * 4 * y;
+        for (UINT x = 0; x < image.Width; x++)
+        {
+            dst[x * 4] = row[x * 3];
+            dst[x * 4 + 1] = row[x * 3 + 1];
+            dst[x * 4 + 2] = row[x * 3 + 2];
+            dst[x * 4 + 3] = 255;
+        }
+    }
+    if (!file)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+    }
+    return image;
+}
+
+ImageComparison CompareImages(const Image& expected, const Image& actual, UINT tolerance, Image* diff)
+{
+    if (expected.Width != actual.Width || expected.Height != actual.Height)
+    {
+        ThrowIfFailed(E_INVALIDARG);
+    }
+    if (diff)
+    {
+        *diff = expected;
+    }
+
+    ImageComparison comparison;
+    const SIZE_T pixelCount = SIZE_T(expected.Width) * expected.Height;
+    for (SIZE_T i = 0; i < pixelCount; i++)
+    {
+        UINT difference = 0;
+        for (UINT c = 0; c < 4; c++)
+        {
+            difference = std::max(difference, static_cast<UINT>(abs(expected.Pixels[i * 4 + c] - actual.Pixels[i * 4 + c])));
+        }
+        comparison.MaxDifference = std::max(comparison.MaxDifference, difference);
+
+        const bool different = difference > tolerance;
+        if (different)
+        {
+            comparison.DifferentPixels++;
+        }
+        if (diff)
+        {
+            UINT8* pixel = &diff->Pixels[i * 4];
+            if (different)
+            {
+                pixel[0] = 255;
+                pixel[1] = 0;
+                pixel[2] = 0;
+            }
+            else
+            {
+                pixel[0] /= 4;
+                pixel[1] /= 4;
+                pixel[2] /= 4;
+            }
+        }
+    }
+    return comparison;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "DXSampleHelper.h"
+
+// 8 bit per channel RGBA image with tightly packed rows.
+struct Image
+{
+    UINT Width = 0;
+    UINT Height = 0;
+    std::vector<UINT8> Pixels;
+};
+
+// Convert pitched rows of an R8G8B8A8 or B8G8R8A8 surface, e.g. a texture readback.
+// Throws HrException with E_INVALIDARG for other formats.
+Image ImageFromRows(const BYTE* data, UINT width, UINT height, UINT rowPitch, DXGI_FORMAT format);
+
+// Binary PPM (P6), alpha is dropped on write and opaque on read.
+void WritePpm(const std::wstring& filename, const Image& image);
+Image ReadPpm(const std::wstring& filename);
+
+struct ImageComparison
+{
+    UINT DifferentPixels = 0;   // Pixels with a channel off by more than the tolerance.
+    UINT MaxDifference = 0;     // Largest channel difference anywhere.
+};
+
+// Compare per channel, pixels within tolerance count as equal. If diff is
+// given it receives a copy of expected, dimmed, with failing pixels in red.
+// Throws HrException with E_INVALIDARG if the sizes differ.
+ImageComparison CompareImages(const Image& expected, const Image& actual, UINT tolerance, Image* diff = nullptr);
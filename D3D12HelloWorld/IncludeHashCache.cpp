@@ -0,0 +1,74 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#endif
+#include "IncludeHashCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <cwctype>
+
+IncludeHashCache::IncludeHashCache(const std::wstring& directory) :
+    m_directory(directory),
+    m_reads(0)
+{
+}
+
+uint64_t IncludeHashCache::HashContents(const void* data, size_t size)
+{
+    const uint64_t hash = HashBytes(data, size);
+    return hash == MissingHash ? 1 : hash;
+}
+
+uint64_t IncludeHashCache::GetHash(const std::string& name)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_hashes.find(name);
+        if (it != m_hashes.end())
+        {
+            return it->second;
+        }
+    }
+
+    // Include names are ASCII in practice.
+    uint64_t hash = MissingHash;
+    try
+    {
+        const MappedFile file(m_directory + std::wstring(name.begin(), name.end()));
+        hash = HashContents(file.Data(), static_cast<size_t>(file.Size()));
+    }
+    catch (...)
+    {
+    }
+    m_reads++;
+
+    // Another thread may have hashed it meanwhile, either result is current.
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_hashes.emplace(name, hash);
+    return hash;
+}
+
+void IncludeHashCache::Record(const std::string& name, uint64_t hash)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_hashes[name] = hash;
+}
+
+void IncludeHashCache::Invalidate(const std::wstring& fileName)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (fileName == L"*")
+    {
+        m_hashes.clear();
+        return;
+    }
+    for (auto it = m_hashes.begin(); it != m_hashes.end();)
+    {
+        const std::string& name = it->first;
+        bool equal = name.size() == fileName.size();
+        for (size_t i = 0; equal && i < name.size(); i++)
+        {
+            equal = std::towlower(static_cast<unsigned char>(name[i])) == std::towlower(fileName[i]);
+        }
+        it = equal ? m_hashes.erase(it) : std::next(it);
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Content hashes of the files shaders include, so that checking a cached
+// shader does not read its includes again. A hash is read from disk once,
+// or taken from the bytes a compile was served, and kept until Invalidate
+// is told the file changed. Lookups never hold the lock during file I/O.
+class IncludeHashCache
+{
+public:
+    // Stands in for missing files, HashContents never returns it.
+    static const uint64_t MissingHash = 0;
+
+    explicit IncludeHashCache(const std::wstring& directory);
+
+    IncludeHashCache(const IncludeHashCache& rhs) = delete;
+    IncludeHashCache& operator=(const IncludeHashCache& rhs) = delete;
+
+    // Hash of <directory><name>, MissingHash if it can not be read.
+    uint64_t GetHash(const std::string& name);
+
+    // The hash of the bytes a compile actually read for name.
+    void Record(const std::string& name, uint64_t hash);
+
+    // fileName changed on disk, as reported by FileWatcher: relative to the
+    // directory and compared ignoring case. "*" forgets every hash.
+    void Invalidate(const std::wstring& fileName);
+
+    // Number of files read from disk so far.
+    size_t GetReadCount()const { return m_reads; }
+
+    static uint64_t HashContents(const void* data, size_t size);
+
+private:
+    std::wstring m_directory;
+    std::unordered_map<std::string, uint64_t> m_hashes;
+    std::atomic<size_t> m_reads;
+    std::mutex m_lock;
+};
@@ -0,0 +1,213 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#endif
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+
+// Which system the current thread works for, and its deque.
+static thread_local const JobSystem* t_jobSystem = nullptr;
+static thread_local uint32_t t_workerIndex = 0;
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    // All deques exist before any worker starts stealing from them.
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepLock);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+int JobSystem::GetWorkerIndex()const
+{
+    return t_jobSystem == this ? static_cast<int>(t_workerIndex) : -1;
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter& counter)
+{
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Counted before it is published, so a worker taking it right away never
+    // drops the count below the jobs actually queued.
+    m_queuedJobs.fetch_add(1, std::memory_order_release);
+
+    const int worker = GetWorkerIndex();
+    const uint32_t index = worker >= 0 ? static_cast<uint32_t>(worker) :
+        m_nextQueue.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32_t>(m_queues.size());
+    {
+        WorkQueue& queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.Lock);
+        queue.Jobs.push_back({ std::move(job), &counter });
+    }
+
+    // Taking the lock orders this with a worker about to sleep, it either sees
+    // the job or gets the notification.
+    {
+        std::lock_guard<std::mutex> lock(m_sleepLock);
+    }
+    m_jobAvailable.notify_one();
+}
+
+bool JobSystem::TryGetJob(uint32_t index, Job& job)
+{
+    if (m_queuedJobs.load(std::memory_order_acquire) == 0)
+    {
+        return false;
+    }
+
+    // Newest own job first, the one whose data is most likely still in cache.
+    const uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+    if (index < queueCount)
+    {
+        WorkQueue& own = *m_queues[index];
+        std::lock_guard<std::mutex> lock(own.Lock);
+        if (!own.Jobs.empty())
+        {
+            job = std::move(own.Jobs.back());
+            own.Jobs.pop_back();
+            m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Then the oldest job of another deque, usually the root of the most work.
+    for (uint32_t i = 1; i <= queueCount; i++)
+    {
+        const uint32_t victim = (index + i) % queueCount;
+        if (victim == index)
+        {
+            continue;
+        }
+        WorkQueue& queue = *m_queues[victim];
+        std::unique_lock<std::mutex> lock(queue.Lock, std::try_to_lock);
+        if (lock.owns_lock() && !queue.Jobs.empty())
+        {
+            job = std::move(queue.Jobs.front());
+            queue.Jobs.pop_front();
+            m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::Execute(Job& job)
+{
+    std::exception_ptr error;
+    try
+    {
+        job.Function();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    job.Function = nullptr;
+
+    // The waiter may destroy the counter as soon as it reads zero, so the
+    // last job notifies under the lock the waiter checks with.
+    JobCounter& counter = *job.Counter;
+    std::lock_guard<std::mutex> lock(counter.m_lock);
+    if (error && !counter.m_error)
+    {
+        counter.m_error = error;
+    }
+    if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        counter.m_done.notify_all();
+    }
+}
+
+void JobSystem::WorkerLoop(uint32_t index)
+{
+    t_jobSystem = this;
+    t_workerIndex = index;
+
+    for (;;)
+    {
+        Job job;
+        if (TryGetJob(index, job))
+        {
+            Execute(job);
+            continue;
+        }
+
+        // A try_lock may have skipped a busy deque, only sleep once nothing is queued.
+        std::unique_lock<std::mutex> lock(m_sleepLock);
+        m_jobAvailable.wait(lock, [this]
+        {
+            return m_stopping || m_queuedJobs.load(std::memory_order_acquire) != 0;
+        });
+        if (m_stopping && m_queuedJobs.load(std::memory_order_acquire) == 0)
+        {
+            return;
+        }
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    const int worker = GetWorkerIndex();
+    const uint32_t index = worker >= 0 ? static_cast<uint32_t>(worker) : static_cast<uint32_t>(m_queues.size());
+
+    while (!counter.IsDone())
+    {
+        Job job;
+        if (TryGetJob(index, job))
+        {
+            Execute(job);
+            continue;
+        }
+
+        // The remaining jobs are running elsewhere. Wake up now and then to
+        // help with jobs they spawn.
+        std::unique_lock<std::mutex> lock(counter.m_lock);
+        counter.m_done.wait_for(lock, std::chrono::microseconds(100), [&counter] { return counter.IsDone(); });
+    }
+
+    std::lock_guard<std::mutex> lock(counter.m_lock);
+    if (counter.m_error)
+    {
+        std::exception_ptr error = counter.m_error;
+        counter.m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& body)
+{
+    grainSize = std::max(grainSize, 1u);
+    JobCounter counter;
+    for (uint32_t begin = 0; begin < count; begin += grainSize)
+    {
+        const uint32_t end = std::min(count, begin + grainSize);
+        Run([&body, begin, end] { body(begin, end); }, counter);
+    }
+    Wait(counter);
+}
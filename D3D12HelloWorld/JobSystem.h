@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Tracks a group of jobs, Wait on it to join them.
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter& rhs) = delete;
+    JobCounter& operator=(const JobCounter& rhs) = delete;
+
+    bool IsDone()const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_pending{ 0 };
+    std::exception_ptr m_error;     // First exception a job threw.
+    std::mutex m_lock;
+    std::condition_variable m_done;
+};
+
+// Work-stealing scheduler for short jobs within a frame. Every worker has a
+// deque of its own: it pushes and pops jobs at the back, so nested jobs run
+// while their data is still in cache, and idle workers steal the oldest job
+// from the front of another deque. Threads waiting on a counter run jobs
+// meanwhile, so jobs may wait on jobs they spawned.
+//
+// ThreadPool stays in use for long running tasks such as file loads and
+// shader compiles, which would otherwise hold up frame jobs. Only the
+// standard library is used, the scheduler builds and runs on any platform.
+class JobSystem
+{
+public:
+    // workerCount 0 uses one worker per hardware thread but the calling one.
+    explicit JobSystem(uint32_t workerCount = 0);
+
+    // Jobs still queued run before the workers exit.
+    ~JobSystem();
+
+    JobSystem(const JobSystem& rhs) = delete;
+    JobSystem& operator=(const JobSystem& rhs) = delete;
+
+    // Queues job, on the deque of the calling worker, or spread over the
+    // workers when called from another thread. counter must outlive the job.
+    void Run(std::function<void()> job, JobCounter& counter);
+
+    // Runs queued jobs until every job of counter finished, then rethrows the
+    // first exception one of them threw.
+    void Wait(JobCounter& counter);
+
+    // Runs body(begin, end) over [0, count) in ranges of at most grainSize,
+    // the calling thread included, and returns once all are done.
+    void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& body);
+
+    uint32_t GetWorkerCount()const { return static_cast<uint32_t>(m_workers.size()); }
+
+    // Jobs taken from another worker's deque, to see how balanced a load is.
+    uint64_t GetStealCount()const { return m_steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Job
+    {
+        std::function<void()> Function;
+        JobCounter* Counter;
+    };
+
+    struct WorkQueue
+    {
+        std::deque<Job> Jobs;
+        std::mutex Lock;
+    };
+
+    void WorkerLoop(uint32_t index);
+    bool TryGetJob(uint32_t index, Job& job);
+    void Execute(Job& job);
+    int GetWorkerIndex()const;
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<uint32_t> m_nextQueue{ 0 };    // Round robin for jobs from outside the workers.
+    std::atomic<uint64_t> m_steals{ 0 };
+
+    // Workers sleep once every deque is empty.
+    std::atomic<uint32_t> m_queuedJobs{ 0 };
+    bool m_stopping = false;
+    std::mutex m_sleepLock;
+    std::condition_variable m_jobAvailable;
+};
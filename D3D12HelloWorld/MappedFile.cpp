@@ -0,0 +1,265 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#endif
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include "DXSampleHelper.h"
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#endif
+#include <utility>
+
+#ifndef _WIN32
+// UTF-8 encoding of a UTF-16 or UTF-32 wide string, the file name encoding
+// used by POSIX file systems in practice.
+static std::string ToUtf8(const std::wstring& text)
+{
+    std::string result;
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        uint32_t c = static_cast<uint32_t>(text[i]);
+        if (c >= 0xD800 && c < 0xDC00 && i + 1 < text.size())
+        {
+            const uint32_t low = static_cast<uint32_t>(text[i + 1]);
+            if (low >= 0xDC00 && low < 0xE000)
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+        if (c < 0x80)
+        {
+            result += static_cast<char>(c);
+        }
+        else if (c < 0x800)
+        {
+            result += static_cast<char>(0xC0 | (c >> 6));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000)
+        {
+            result += static_cast<char>(0xE0 | (c >> 12));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            result += static_cast<char>(0xF0 | (c >> 18));
+            result += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    return result;
+}
+
+[[noreturn]] static void ThrowErrno(int error, const char* what)
+{
+    throw std::system_error(error, std::generic_category(), what);
+}
+#endif
+
+MappedFile::MappedFile(const std::wstring& filename)
+{
+    Open(filename);
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) :
+    m_file(rhs.m_file),
+#ifdef _WIN32
+    m_mapping(rhs.m_mapping),
+#endif
+    m_data(rhs.m_data),
+    m_size(rhs.m_size)
+{
+#ifdef _WIN32
+    rhs.m_file = INVALID_HANDLE_VALUE;
+    rhs.m_mapping = nullptr;
+#else
+    rhs.m_file = -1;
+#endif
+    rhs.m_data = nullptr;
+    rhs.m_size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+    if (this != &rhs)
+    {
+        Close();
+        std::swap(m_file, rhs.m_file);
+#ifdef _WIN32
+        std::swap(m_mapping, rhs.m_mapping);
+#endif
+        std::swap(m_data, rhs.m_data);
+        std::swap(m_size, rhs.m_size);
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+void MappedFile::Open(const std::wstring& filename)
+{
+    Close();
+
+    CREATEFILE2_EXTENDED_PARAMETERS extendedParams = {};
+    extendedParams.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+    extendedParams.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+    extendedParams.dwFileFlags = FILE_FLAG_SEQUENTIAL_SCAN;
+    extendedParams.dwSecurityQosFlags = SECURITY_ANONYMOUS;
+    extendedParams.lpSecurityAttributes = nullptr;
+    extendedParams.hTemplateFile = nullptr;
+    m_file = CreateFile2(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &extendedParams);
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(m_file, &fileSize))
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        Close();
+        ThrowIfFailed(hr);
+    }
+    m_size = static_cast<UINT64>(fileSize.QuadPart);
+
+    // Empty files can not be mapped, there is nothing to read anyway.
+    if (m_size == 0)
+    {
+        return;
+    }
+
+    // A 32-bit process can not map more than its address space.
+    if (m_size > static_cast<UINT64>(SIZE_MAX))
+    {
+        Close();
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE));
+    }
+
+    m_mapping = CreateFileMapping(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr)
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        Close();
+        ThrowIfFailed(hr);
+    }
+
+    m_data = reinterpret_cast<const BYTE*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        Close();
+        ThrowIfFailed(hr);
+    }
+}
+
+void MappedFile::Close()
+{
+    if (m_data)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+    }
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+    m_size = 0;
+}
+
+bool MappedFile::IsOpen()const
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+#else
+void MappedFile::Open(const std::wstring& filename)
+{
+    Close();
+
+    m_file = open(ToUtf8(filename).c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_file < 0)
+    {
+        ThrowErrno(errno, "open");
+    }
+
+    struct stat status = {};
+    if (fstat(m_file, &status) != 0)
+    {
+        const int error = errno;
+        Close();
+        ThrowErrno(error, "fstat");
+    }
+    m_size = static_cast<uint64_t>(status.st_size);
+
+    // mmap rejects a zero length, there is nothing to read anyway.
+    if (m_size == 0)
+    {
+        return;
+    }
+
+    // A 32-bit process can not map more than its address space.
+    if (m_size > static_cast<uint64_t>(SIZE_MAX))
+    {
+        Close();
+        ThrowErrno(EFBIG, "mmap");
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data == MAP_FAILED)
+    {
+        const int error = errno;
+        Close();
+        ThrowErrno(error, "mmap");
+    }
+    m_data = static_cast<const uint8_t*>(data);
+
+    // Assets are read front to back, like FILE_FLAG_SEQUENTIAL_SCAN on Windows.
+    posix_madvise(data, static_cast<size_t>(m_size), POSIX_MADV_SEQUENTIAL);
+}
+
+void MappedFile::Close()
+{
+    if (m_data)
+    {
+        munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+        m_data = nullptr;
+    }
+    if (m_file >= 0)
+    {
+        close(m_file);
+        m_file = -1;
+    }
+    m_size = 0;
+}
+
+bool MappedFile::IsOpen()const
+{
+    return m_file >= 0;
+}
+#endif
+
+ByteSpan MappedFile::GetSpan()const
+{
+    ByteSpan span;
+    span.Data = m_data;
+    span.Size = m_size;
+    return span;
+}
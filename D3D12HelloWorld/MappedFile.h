@@ -0,0 +1,60 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <string>
+
+// Read-only view on a contiguous range of bytes owned by someone else.
+struct ByteSpan
+{
+    const uint8_t* Data = nullptr;
+    uint64_t Size = 0;
+
+    bool Empty()const { return Size == 0; }
+
+    ByteSpan Slice(uint64_t offset, uint64_t size)const
+    {
+        assert(offset <= Size && size <= Size - offset);
+        ByteSpan span;
+        span.Data = Data + offset;
+        span.Size = size;
+        return span;
+    }
+};
+
+// Maps a whole file read-only into the address space, with a file mapping
+// on Windows and mmap elsewhere. Pages are brought in by the OS on first
+// touch, so asset data can be copied straight from the mapping into upload
+// memory without an intermediate heap copy. Files larger than 4 GiB are
+// supported on 64-bit builds.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::wstring& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile& rhs) = delete;
+    MappedFile& operator=(const MappedFile& rhs) = delete;
+    MappedFile(MappedFile&& rhs);
+    MappedFile& operator=(MappedFile&& rhs);
+
+    // Throws if the file can not be opened or mapped: HrException on
+    // Windows, std::system_error elsewhere.
+    void Open(const std::wstring& filename);
+    void Close();
+
+    bool IsOpen()const;
+    const uint8_t* Data()const { return m_data; }
+    uint64_t Size()const { return m_size; }
+    ByteSpan GetSpan()const;
+
+private:
+#ifdef _WIN32
+    void* m_file = reinterpret_cast<void*>(-1);     // INVALID_HANDLE_VALUE when closed.
+    void* m_mapping = nullptr;
+#else
+    int m_file = -1;
+#endif
+    const uint8_t* m_data = nullptr;
+    uint64_t m_size = 0;
+};
@@ -0,0 +1,11 @@
+// Per object constants, shared by shaders.hlsl and D3D12HelloWindow.
+#ifndef OBJECT_CONSTANTS_HLSLI
+#define OBJECT_CONSTANTS_HLSLI
+#include "ConstantBufferSchema.hlsli"
+
+#define OBJECT_CONSTANTS_FIELDS(FIELD) \
+    FIELD(Float4x4, WorldViewProj)
+
+CONSTANT_BUFFER(ObjectConstants, 0, OBJECT_CONSTANTS_FIELDS)
+
+#endif
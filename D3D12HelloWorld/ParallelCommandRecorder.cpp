@@ -0,0 +1,100 @@
+#include "stdafx.h"
+#include "ParallelCommandRecorder.h"
+
+ParallelCommandRecorder::ParallelCommandRecorder(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, UINT frameCount) :
+    m_device(device),
+    m_type(type),
+    m_frameCount(frameCount)
+{
+    assert(m_device && m_frameCount > 0);
+}
+
+void ParallelCommandRecorder::BeginFrame(UINT frameIndex)
+{
+    assert(frameIndex < m_frameCount);
+    m_frameIndex = frameIndex;
+    m_usedLists = 0;
+
+    // Lists the previous frame did not need were not recorded into, resetting them is harmless.
+    for (UINT list = 0; list < m_commandLists.size(); list++)
+    {
+        ThrowIfFailed(m_allocators[list * m_frameCount + m_frameIndex]->Reset());
+    }
+}
+
+UINT ParallelCommandRecorder::AcquireList()
+{
+    if (m_usedLists == m_commandLists.size())
+    {
+        for (UINT frame = 0; frame < m_frameCount; frame++)
+        {
+            ComPtr<ID3D12CommandAllocator> allocator;
+            ThrowIfFailed(m_device->CreateCommandAllocator(m_type, IID_PPV_ARGS(&allocator)));
+            m_allocators.push_back(allocator);
+        }
+
+        // Created open, closed so every list starts the same way, with a Reset.
+        ComPtr<ID3D12GraphicsCommandList> commandList;
+        ThrowIfFailed(m_device->CreateCommandList(0, m_type, m_allocators[m_usedLists * m_frameCount].Get(),
+            nullptr, IID_PPV_ARGS(&commandList)));
+        ThrowIfFailed(commandList->Close());
+        m_commandLists.push_back(commandList);
+    }
+    return m_usedLists++;
+}
+
+void ParallelCommandRecorder::ResetList(UINT list, ID3D12PipelineState* initialState)
+{
+    ThrowIfFailed(m_commandLists[list]->Reset(m_allocators[list * m_frameCount + m_frameIndex].Get(), initialState));
+}
+
+ID3D12GraphicsCommandList* ParallelCommandRecorder::Open(ID3D12PipelineState* initialState)
+{
+    const UINT list = AcquireList();
+    ResetList(list, initialState);
+    return m_commandLists[list].Get();
+}
+
+void ParallelCommandRecorder::RecordParallel(JobSystem& jobs, UINT itemCount, UINT minItemsPerList, const RecordFunction& record)
+{
+    if (itemCount == 0)
+    {
+        return;
+    }
+
+    // Lists are claimed up front on this thread, so their order is the chunk
+    // order no matter which job finishes first.
+    minItemsPerList = std::max(minItemsPerList, 1u);
+    UINT chunkCount = std::min((itemCount + minItemsPerList - 1) / minItemsPerList, jobs.GetWorkerCount() + 1);
+    const UINT itemsPerChunk = (itemCount + chunkCount - 1) / chunkCount;
+    chunkCount = (itemCount + itemsPerChunk - 1) / itemsPerChunk;
+    const UINT firstList = m_usedLists;
+    for (UINT chunk = 0; chunk < chunkCount; chunk++)
+    {
+        AcquireList();
+    }
+
+    // Each chunk resets and records its own list with its own allocator.
+    jobs.ParallelFor(chunkCount, 1, [&](UINT begin, UINT end)
+    {
+        for (UINT chunk = begin; chunk < end; chunk++)
+        {
+            ResetList(firstList + chunk, nullptr);
+            record(m_commandLists[firstList + chunk].Get(), chunk * itemsPerChunk, std::min(itemCount, (chunk + 1) * itemsPerChunk));
+        }
+    });
+}
+
+void ParallelCommandRecorder::Submit(ID3D12CommandQueue* queue)
+{
+    std::vector<ID3D12CommandList*> commandLists(m_usedLists);
+    for (UINT list = 0; list < m_usedLists; list++)
+    {
+        ThrowIfFailed(m_commandLists[list]->Close());
+        commandLists[list] = m_commandLists[list].Get();
+    }
+    if (!commandLists.empty())
+    {
+        queue->ExecuteCommandLists(static_cast<UINT>(commandLists.size()), commandLists.data());
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include "JobSystem.h"
+
+// Records one frame into several command lists, chunks of it in parallel on
+// the job system, and submits them in recording order with a single
+// ExecuteCommandLists. Every list has an allocator per frame in flight, so a
+// frame's allocators are reset once the fence says the GPU finished that
+// frame and never while other frames still execute from them.
+//
+// Command lists do not inherit state from each other: each parallel chunk
+// sets its own render targets, viewport, heaps, root signature and pipeline.
+class ParallelCommandRecorder
+{
+public:
+    // Records items [begin, end) into commandList, which is open.
+    typedef std::function<void(ID3D12GraphicsCommandList* commandList, UINT begin, UINT end)> RecordFunction;
+
+    ParallelCommandRecorder(ID3D12Device* device, D3D12_COMMAND_LIST_TYPE type, UINT frameCount);
+
+    ParallelCommandRecorder(const ParallelCommandRecorder& rhs) = delete;
+    ParallelCommandRecorder& operator=(const ParallelCommandRecorder& rhs) = delete;
+
+    // Starts recording frameIndex. The GPU must be done with the last frame
+    // recorded with that index.
+    void BeginFrame(UINT frameIndex);
+
+    // Next list of the frame, open on the calling thread, for work that has to
+    // go before or after the parallel chunks such as clears and barriers.
+    ID3D12GraphicsCommandList* Open(ID3D12PipelineState* initialState = nullptr);
+
+    // Records itemCount items split into contiguous chunks of at least
+    // minItemsPerList, at most one chunk per thread, and returns once all are
+    // recorded. The lists follow the ones opened before, in chunk order.
+    void RecordParallel(JobSystem& jobs, UINT itemCount, UINT minItemsPerList, const RecordFunction& record);
+
+    // Closes the frame's lists and executes them in one call.
+    void Submit(ID3D12CommandQueue* queue);
+
+    // Lists the busiest frame needed so far.
+    UINT GetListCount()const { return static_cast<UINT>(m_commandLists.size()); }
+
+private:
+    // Claims the next list of the frame, creating it on first use.
+    UINT AcquireList();
+    void ResetList(UINT list, ID3D12PipelineState* initialState);
+
+    ComPtr<ID3D12Device> m_device;
+    D3D12_COMMAND_LIST_TYPE m_type;
+    UINT m_frameCount;
+
+    std::vector<ComPtr<ID3D12GraphicsCommandList>> m_commandLists;
+    std::vector<ComPtr<ID3D12CommandAllocator>> m_allocators;   // [list * m_frameCount + frame]
+
+    UINT m_frameIndex = 0;
+    UINT m_usedLists = 0;
+};
@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "PipelineStateCache.h"
+
+PipelineStateCache::PipelineStateCache(ID3D12Device* device, const std::wstring& libraryFilename) :
+    m_device(device),
+    m_libraryFilename(libraryFilename),
+    m_memoryHits(0),
+    m_libraryHits(0),
+    m_creates(0)
+{
+    if (m_libraryFilename.empty())
+    {
+        return;
+    }
+
+    ReadFileBytes(m_libraryFilename, m_libraryData);
+    CreateLibrary(m_libraryData.data(), m_libraryData.size());
+}
+
+void PipelineStateCache::CreateLibrary(const void* data, SIZE_T size)
+{
+    // Pipeline libraries need Windows 10 1703, without one pipelines are only cached in memory.
+    ComPtr<ID3D12Device1> device1;
+    if (FAILED(m_device.As(&device1)))
+    {
+        return;
+    }
+
+    HRESULT hr = device1->CreatePipelineLibrary(size ? data : nullptr, size, IID_PPV_ARGS(&m_library));
+    if (hr == D3D12_ERROR_DRIVER_VERSION_MISMATCH || hr == D3D12_ERROR_ADAPTER_NOT_FOUND || hr == E_INVALIDARG)
+    {
+        // Written by another driver or adapter, or corrupt. Start over.
+        m_libraryData.clear();
+        hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&m_library));
+        m_libraryDirty = true;
+    }
+    if (FAILED(hr))
+    {
+        m_library.Reset();
+    }
+}
+
+void PipelineStateCache::RegisterRootSignature(ID3D12RootSignature* rootSignature, UINT64 contentHash)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_rootSignatureHashes[rootSignature] = contentHash;
+}
+
+// Falls back to the pointer value, which is only unique while that root signature lives.
+bool PipelineStateCache::GetRootSignatureHash(ID3D12RootSignature* rootSignature, UINT64& hash)
+{
+    auto it = m_rootSignatureHashes.find(rootSignature);
+    if (it == m_rootSignatureHashes.end())
+    {
+        hash = reinterpret_cast<UINT64>(rootSignature);
+        return false;
+    }
+    hash = it->second;
+    return true;
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    UINT64 rootSignatureHash;
+    bool persistent;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        persistent = GetRootSignatureHash(desc.pRootSignature, rootSignatureHash) && m_library != nullptr;
+    }
+
+    const UINT64 key = HashGraphicsPipelineStateDesc(desc, rootSignatureHash);
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_pipelines.find(key);
+        if (it != m_pipelines.end())
+        {
+            m_memoryHits++;
+            return it->second;
+        }
+    }
+
+    // Load or create without the lock, drivers compile pipelines in parallel.
+    // The library is free-threaded, a desc that does not match the stored
+    // pipeline fails to load and is created instead.
+    WCHAR name[32];
+    swprintf_s(name, L"%016llx", key);
+    ComPtr<ID3D12PipelineState> pipelineState;
+    if (persistent && SUCCEEDED(m_library->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(&pipelineState))))
+    {
+        m_libraryHits++;
+    }
+    else
+    {
+        ThrowIfFailed(m_device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pipelineState)));
+        m_creates++;
+        if (persistent && SUCCEEDED(m_library->StorePipeline(name, pipelineState.Get())))
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_libraryDirty = true;
+        }
+    }
+
+    // Another thread may have created the same pipeline meanwhile, everyone gets the first one.
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_pipelines.emplace(key, pipelineState).first->second;
+}
+
+void PipelineStateCache::Save()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!m_library || !m_libraryDirty || m_libraryFilename.empty())
+    {
+        return;
+    }
+
+    std::vector<BYTE> data(m_library->GetSerializedSize());
+    ThrowIfFailed(m_library->Serialize(data.data(), data.size()));
+    if (WriteFileAtomic(m_libraryFilename, data.data(), data.size()))
+    {
+        m_libraryDirty = false;
+    }
+}
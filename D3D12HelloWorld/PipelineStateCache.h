@@ -0,0 +1,55 @@
+#pragma once
+#include "PipelineStateHash.h"
+#include <atomic>
+#include <mutex>
+
+// Creates graphics pipelines at most once per distinct desc and keeps the
+// driver's compiled pipelines across runs in an ID3D12PipelineLibrary file.
+// Identical descs share one pipeline object, so switching back to a variant,
+// say after toggling MSAA, is a lookup.
+class PipelineStateCache
+{
+public:
+    // An empty filename keeps pipelines in memory only. A library written by
+    // another driver or adapter is discarded and rebuilt.
+    PipelineStateCache(ID3D12Device* device, const std::wstring& libraryFilename);
+
+    PipelineStateCache(const PipelineStateCache& rhs) = delete;
+    PipelineStateCache& operator=(const PipelineStateCache& rhs) = delete;
+
+    // Pipelines are only persisted for registered root signatures, whose
+    // content hash stands in for the pointer in the key.
+    void RegisterRootSignature(ID3D12RootSignature* rootSignature, UINT64 contentHash);
+
+    // Safe to call from several threads. Throws HrException if creation fails.
+    // Unregistered root signatures are told apart by pointer, they must
+    // outlive the cache.
+    ComPtr<ID3D12PipelineState> GetOrCreate(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+    // Writes the library if pipelines were added since it was loaded.
+    void Save();
+
+    UINT GetMemoryHitCount()const { return m_memoryHits; }
+    UINT GetLibraryHitCount()const { return m_libraryHits; }
+    UINT GetCreateCount()const { return m_creates; }
+
+private:
+    bool GetRootSignatureHash(ID3D12RootSignature* rootSignature, UINT64& hash);
+    void CreateLibrary(const void* data, SIZE_T size);
+
+    ComPtr<ID3D12Device> m_device;
+    std::wstring m_libraryFilename;
+
+    // The library reads from m_libraryData for as long as it lives.
+    std::vector<BYTE> m_libraryData;
+    ComPtr<ID3D12PipelineLibrary> m_library;
+    bool m_libraryDirty = false;
+
+    std::unordered_map<UINT64, ComPtr<ID3D12PipelineState>> m_pipelines;
+    std::unordered_map<ID3D12RootSignature*, UINT64> m_rootSignatureHashes;
+    std::mutex m_lock;
+
+    std::atomic<UINT> m_memoryHits;
+    std::atomic<UINT> m_libraryHits;
+    std::atomic<UINT> m_creates;
+};
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "PipelineStateHash.h"
+
+// Folds fields one by one into a running FNV-1a hash.
+class DescHasher
+{
+public:
+    template<class T>
+    void Add(const T& value)
+    {
+        m_hash = HashBytes(&value, sizeof(value), m_hash);
+    }
+
+    // Null and empty strings hash differently.
+    void AddString(LPCSTR str)
+    {
+        const SIZE_T length = str ? strlen(str) : SIZE_T(-1);
+        Add(length);
+        if (str)
+        {
+            m_hash = HashBytes(str, length, m_hash);
+        }
+    }
+
+    UINT64 GetHash()const { return m_hash; }
+
+private:
+    UINT64 m_hash = HashBytes(nullptr, 0);
+};
+
+UINT64 HashShaderBytecode(const D3D12_SHADER_BYTECODE& shader)
+{
+    const BYTE* bytes = static_cast<const BYTE*>(shader.pShaderBytecode);
+    const SIZE_T length = bytes ? shader.BytecodeLength : 0;
+    UINT64 hash = HashBytes(&length, sizeof(length));
+
+    // "DXBC" is followed by a 16 byte checksum of the rest of the container.
+    static const BYTE ZeroChecksum[16] = {};
+    const SIZE_T checksumOffset = 4;
+    if (length >= checksumOffset + sizeof(ZeroChecksum) &&
+        memcmp(bytes, "DXBC", 4) == 0 &&
+        memcmp(bytes + checksumOffset, ZeroChecksum, sizeof(ZeroChecksum)) != 0)
+    {
+        return HashBytes(bytes + checksumOffset, sizeof(ZeroChecksum), hash);
+    }
+    return HashBytes(bytes, length, hash);
+}
+
+static void AddRenderTargetBlend(DescHasher& hasher, const D3D12_RENDER_TARGET_BLEND_DESC& blend)
+{
+    hasher.Add(blend.BlendEnable);
+    hasher.Add(blend.LogicOpEnable);
+    hasher.Add(blend.SrcBlend);
+    hasher.Add(blend.DestBlend);
+    hasher.Add(blend.BlendOp);
+    hasher.Add(blend.SrcBlendAlpha);
+    hasher.Add(blend.DestBlendAlpha);
+    hasher.Add(blend.BlendOpAlpha);
+    hasher.Add(blend.LogicOp);
+    hasher.Add(blend.RenderTargetWriteMask);
+}
+
+static void AddStencilOp(DescHasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& op)
+{
+    hasher.Add(op.StencilFailOp);
+    hasher.Add(op.StencilDepthFailOp);
+    hasher.Add(op.StencilPassOp);
+    hasher.Add(op.StencilFunc);
+}
+
+UINT64 HashGraphicsPipelineStateDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 rootSignatureHash)
+{
+    DescHasher hasher;
+    hasher.Add(rootSignatureHash);
+    hasher.Add(HashShaderBytecode(desc.VS));
+    hasher.Add(HashShaderBytecode(desc.PS));
+    hasher.Add(HashShaderBytecode(desc.DS));
+    hasher.Add(HashShaderBytecode(desc.HS));
+    hasher.Add(HashShaderBytecode(desc.GS));
+
+    const D3D12_STREAM_OUTPUT_DESC& streamOutput = desc.StreamOutput;
+    hasher.Add(streamOutput.NumEntries);
+    for (UINT i = 0; streamOutput.pSODeclaration && i < streamOutput.NumEntries; i++)
+    {
+        const D3D12_SO_DECLARATION_ENTRY& entry = streamOutput.pSODeclaration[i];
+        hasher.Add(entry.Stream);
+        hasher.AddString(entry.SemanticName);
+        hasher.Add(entry.SemanticIndex);
+        hasher.Add(entry.StartComponent);
+        hasher.Add(entry.ComponentCount);
+        hasher.Add(entry.OutputSlot);
+    }
+    hasher.Add(streamOutput.NumStrides);
+    for (UINT i = 0; streamOutput.pBufferStrides && i < streamOutput.NumStrides; i++)
+    {
+        hasher.Add(streamOutput.pBufferStrides[i]);
+    }
+    hasher.Add(streamOutput.RasterizedStream);
+
+    hasher.Add(desc.BlendState.AlphaToCoverageEnable);
+    hasher.Add(desc.BlendState.IndependentBlendEnable);
+    for (const D3D12_RENDER_TARGET_BLEND_DESC& blend : desc.BlendState.RenderTarget)
+    {
+        AddRenderTargetBlend(hasher, blend);
+    }
+    hasher.Add(desc.SampleMask);
+
+    // Only 4 byte members, no padding.
+    hasher.Add(desc.RasterizerState);
+
+    const D3D12_DEPTH_STENCIL_DESC& depthStencil = desc.DepthStencilState;
+    hasher.Add(depthStencil.DepthEnable);
+    hasher.Add(depthStencil.DepthWriteMask);
+    hasher.Add(depthStencil.DepthFunc);
+    hasher.Add(depthStencil.StencilEnable);
+    hasher.Add(depthStencil.StencilReadMask);
+    hasher.Add(depthStencil.StencilWriteMask);
+    AddStencilOp(hasher, depthStencil.FrontFace);
+    AddStencilOp(hasher, depthStencil.BackFace);
+
+    hasher.Add(desc.InputLayout.NumElements);
+    for (UINT i = 0; desc.InputLayout.pInputElementDescs && i < desc.InputLayout.NumElements; i++)
+    {
+        const D3D12_INPUT_ELEMENT_DESC& element = desc.InputLayout.pInputElementDescs[i];
+        hasher.AddString(element.SemanticName);
+        hasher.Add(element.SemanticIndex);
+        hasher.Add(element.Format);
+        hasher.Add(element.InputSlot);
+        hasher.Add(element.AlignedByteOffset);
+        hasher.Add(element.InputSlotClass);
+        hasher.Add(element.InstanceDataStepRate);
+    }
+
+    hasher.Add(desc.IBStripCutValue);
+    hasher.Add(desc.PrimitiveTopologyType);
+    hasher.Add(desc.NumRenderTargets);
+    for (UINT i = 0; i < desc.NumRenderTargets && i < _countof(desc.RTVFormats); i++)
+    {
+        hasher.Add(desc.RTVFormats[i]);
+    }
+    hasher.Add(desc.DSVFormat);
+    hasher.Add(desc.SampleDesc.Count);
+    hasher.Add(desc.SampleDesc.Quality);
+    hasher.Add(desc.NodeMask);
+    hasher.Add(desc.Flags);
+    return hasher.GetHash();
+}
+
+// Root parameters are unions, only the member in use is hashed.
+template<class Parameter>
+static void AddRootParameters(DescHasher& hasher, const Parameter* parameters, UINT count)
+{
+    hasher.Add(count);
+    for (UINT i = 0; i < count; i++)
+    {
+        const Parameter& parameter = parameters[i];
+        hasher.Add(parameter.ParameterType);
+        hasher.Add(parameter.ShaderVisibility);
+        switch (parameter.ParameterType)
+        {
+        case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+            hasher.Add(parameter.DescriptorTable.NumDescriptorRanges);
+            for (UINT range = 0; range < parameter.DescriptorTable.NumDescriptorRanges; range++)
+            {
+                hasher.Add(parameter.DescriptorTable.pDescriptorRanges[range]);
+            }
+            break;
+        case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+            hasher.Add(parameter.Constants);
+            break;
+        default:
+            hasher.Add(parameter.Descriptor);
+            break;
+        }
+    }
+}
+
+template<class Desc>
+static void AddRootSignature(DescHasher& hasher, const Desc& desc)
+{
+    AddRootParameters(hasher, desc.pParameters, desc.NumParameters);
+    hasher.Add(desc.NumStaticSamplers);
+    for (UINT i = 0; i < desc.NumStaticSamplers; i++)
+    {
+        hasher.Add(desc.pStaticSamplers[i]);
+    }
+    hasher.Add(desc.Flags);
+}
+
+UINT64 HashRootSignatureDesc(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc)
+{
+    // Ranges, descriptors, constants and samplers are all 32-bit fields, they have no padding.
+    DescHasher hasher;
+    hasher.Add(desc.Version);
+    if (desc.Version == D3D_ROOT_SIGNATURE_VERSION_1_0)
+    {
+        AddRootSignature(hasher, desc.Desc_1_0);
+    }
+    else
+    {
+        AddRootSignature(hasher, desc.Desc_1_1);
+    }
+    return hasher.GetHash();
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "DXSampleHelper.h"
+
+// Hash of everything in a graphics pipeline desc that decides the pipeline:
+// shader bytecode, input layout and stream output contents included, CachedPSO
+// excluded. Padding is never hashed, so descs built field by field hash alike.
+//
+// The root signature is hashed as rootSignatureHash instead of its pointer.
+// Pass a hash of its serialized blob for a key that is stable across runs,
+// or the pointer value for one that is only valid in this process.
+UINT64 HashGraphicsPipelineStateDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, UINT64 rootSignatureHash);
+
+// Hash of the shader bytecode. DXBC containers are identified by the checksum
+// in their header instead of hashing the whole blob.
+UINT64 HashShaderBytecode(const D3D12_SHADER_BYTECODE& shader);
+
+// Hash of a root signature desc, parameters, ranges and static samplers
+// included. A 1.0 desc and its 1.1 equivalent hash differently.
+UINT64 HashRootSignatureDesc(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc);
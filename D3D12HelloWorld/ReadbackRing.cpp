@@ -0,0 +1,125 @@
+#include "stdafx.h"
+#include "ReadbackRing.h"
+#include "GpuMemoryTracker.h"
+
+ReadbackRing::ReadbackRing(ID3D12Device* device, UINT64 capacity) :
+    m_capacity(capacity)
+{
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(capacity),
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&m_buffer)
+    ));
+    NAME_D3D12_OBJECT(m_buffer);
+    GpuMemoryTracker::TrackResource(m_buffer.Get(), GpuMemoryCategory::Buffer, L"ReadbackRing");
+
+    // Readback heaps may stay mapped, the range read is declared on every Poll.
+    ThrowIfFailed(m_buffer->Map(0, &CD3DX12_RANGE(0, 0), reinterpret_cast<void**>(&m_mappedData)));
+}
+
+ReadbackRing::~ReadbackRing()
+{
+    m_buffer->Unmap(0, &CD3DX12_RANGE(0, 0));
+}
+
+// Allocations never straddle the end of the buffer, the rest of it is skipped instead.
+bool ReadbackRing::Allocate(UINT64 byteSize, UINT64 alignment, UINT64* offset)
+{
+    UINT64 position = (m_head + alignment - 1) & ~(alignment - 1);
+    if (position % m_capacity + byteSize > m_capacity)
+    {
+        position += m_capacity - position % m_capacity;
+    }
+    if (byteSize > m_capacity || position + byteSize - m_tail > m_capacity)
+    {
+        return false;
+    }
+
+    *offset = position % m_capacity;
+    m_head = position + byteSize;
+    return true;
+}
+
+bool ReadbackRing::ReadBuffer(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* source, UINT64 sourceOffset, UINT64 byteSize, ReadbackCallback callback)
+{
+    Request request;
+    UINT64 offset;
+    if (!Allocate(byteSize, 16, &offset))
+    {
+        return false;
+    }
+    request.End = m_head;
+    request.Result.Data = m_mappedData + offset;
+    request.Result.Size = byteSize;
+    request.Callback = std::move(callback);
+    request.FenceValue = 0;
+
+    cmdList->CopyBufferRegion(m_buffer.Get(), offset, source, sourceOffset, byteSize);
+    m_requests.push_back(std::move(request));
+    return true;
+}
+
+bool ReadbackRing::ReadTexture(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* source, UINT subresource, ReadbackCallback callback)
+{
+    const D3D12_RESOURCE_DESC desc = source->GetDesc();
+    ComPtr<ID3D12Device> device;
+    ThrowIfFailed(source->GetDevice(IID_PPV_ARGS(&device)));
+
+    Request request;
+    UINT64 byteSize;
+    device->GetCopyableFootprints(&desc, subresource, 1, 0, &request.Result.Footprint, &request.Result.NumRows, &request.Result.RowSizeInBytes, &byteSize);
+
+    UINT64 offset;
+    if (!Allocate(byteSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &offset))
+    {
+        return false;
+    }
+    request.End = m_head;
+    request.Result.Data = m_mappedData + offset;
+    request.Result.Size = byteSize;
+    request.Callback = std::move(callback);
+    request.FenceValue = 0;
+
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = request.Result.Footprint;
+    footprint.Offset = offset;
+    CD3DX12_TEXTURE_COPY_LOCATION dst(m_buffer.Get(), footprint);
+    CD3DX12_TEXTURE_COPY_LOCATION src(source, subresource);
+    cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+    m_requests.push_back(std::move(request));
+    return true;
+}
+
+void ReadbackRing::Commit(UINT64 fenceValue)
+{
+    for (auto it = m_requests.rbegin(); it != m_requests.rend() && it->FenceValue == 0; ++it)
+    {
+        it->FenceValue = fenceValue;
+    }
+}
+
+void ReadbackRing::Poll(UINT64 completedFenceValue)
+{
+    while (!m_requests.empty() &&
+        m_requests.front().FenceValue != 0 &&
+        m_requests.front().FenceValue <= completedFenceValue)
+    {
+        Request request = std::move(m_requests.front());
+        m_requests.pop_front();
+
+        // Declaring the read range lets the driver make the data CPU visible.
+        const SIZE_T offset = static_cast<SIZE_T>(request.Result.Data - m_mappedData);
+        void* mappedData;
+        ThrowIfFailed(m_buffer->Map(0, &CD3DX12_RANGE(offset, offset + static_cast<SIZE_T>(request.Result.Size)), &mappedData));
+        if (request.Callback)
+        {
+            request.Callback(request.Result);
+        }
+        m_buffer->Unmap(0, &CD3DX12_RANGE(0, 0));
+
+        m_tail = request.End;
+    }
+}
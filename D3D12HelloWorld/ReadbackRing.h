@@ -0,0 +1,70 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include <deque>
+#include <functional>
+
+// Data of a finished readback, valid only during the callback.
+struct ReadbackResult
+{
+    const BYTE* Data = nullptr;
+    UINT64 Size = 0;
+
+    // Layout of texture readbacks, Offset is 0 and relative to Data.
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT Footprint = {};
+    UINT NumRows = 0;
+    UINT64 RowSizeInBytes = 0;
+};
+
+typedef std::function<void(const ReadbackResult&)> ReadbackCallback;
+
+// Reads GPU data back without stalling. Copies are recorded into the caller's
+// command list and land in one persistently mapped READBACK heap buffer used
+// as a ring. Requests are tagged with the fence value signalled after the
+// command list by Commit(), Poll() hands them to their callbacks once the
+// fence has passed, typically a few frames later.
+class ReadbackRing
+{
+public:
+    static const UINT64 DefaultCapacity = 32 * 1024 * 1024;
+
+    explicit ReadbackRing(ID3D12Device* device, UINT64 capacity = DefaultCapacity);
+    ~ReadbackRing();
+
+    ReadbackRing(const ReadbackRing& rhs) = delete;
+    ReadbackRing& operator=(const ReadbackRing& rhs) = delete;
+
+    // Record a copy of source, which must be in the COPY_SOURCE state or
+    // promotable to it. Returns false, recording nothing, if the ring is full.
+    bool ReadBuffer(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* source, UINT64 sourceOffset, UINT64 byteSize, ReadbackCallback callback);
+    bool ReadTexture(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* source, UINT subresource, ReadbackCallback callback);
+
+    // Tag all requests recorded since the last commit with the fence value
+    // the queue signals after executing their command list.
+    void Commit(UINT64 fenceValue);
+
+    // Run the callbacks of committed requests whose fence value has completed.
+    void Poll(UINT64 completedFenceValue);
+
+    UINT GetPendingCount()const { return static_cast<UINT>(m_requests.size()); }
+
+private:
+    struct Request
+    {
+        UINT64 End;             // Ring position after the allocation.
+        ReadbackResult Result;
+        ReadbackCallback Callback;
+        UINT64 FenceValue;      // 0 until committed.
+    };
+
+    bool Allocate(UINT64 byteSize, UINT64 alignment, UINT64* offset);
+
+    ComPtr<ID3D12Resource> m_buffer;
+    BYTE* m_mappedData = nullptr;
+    UINT64 m_capacity;
+
+    // Monotonic positions, the ring offset is position % capacity.
+    UINT64 m_head = 0;
+    UINT64 m_tail = 0;
+
+    std::deque<Request> m_requests;
+};
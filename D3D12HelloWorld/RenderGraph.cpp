@@ -0,0 +1,258 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#endif
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+
+void RenderGraph::Clear()
+{
+    m_passCount = 0;
+    m_resourceCount = 0;
+    m_order.clear();
+    m_finalBarriers.clear();
+    m_slots.clear();
+    m_barrierCount = 0;
+}
+
+RenderGraphResource RenderGraph::CreateTexture(const wchar_t* name, const RenderGraphTextureDesc& desc)
+{
+    const RenderGraphResource resource = ImportResource(name, RenderGraphUsage_None, RenderGraphUsage_None);
+    m_resources[resource].Imported = false;
+    m_resources[resource].Desc = desc;
+    return resource;
+}
+
+RenderGraphResource RenderGraph::ImportResource(const wchar_t* name, uint32_t initialUsage, uint32_t finalUsage)
+{
+    // Entries past the count are reused, their vectors keep their capacity.
+    if (m_resourceCount == m_resources.size())
+    {
+        m_resources.emplace_back();
+    }
+    Resource& resource = m_resources[m_resourceCount];
+    resource.Name = name;
+    resource.Imported = true;
+    resource.InitialUsage = initialUsage;
+    resource.FinalUsage = finalUsage;
+    resource.Desc = RenderGraphTextureDesc();
+    resource.Lifetime = RenderGraphLifetime();
+    resource.Slot = RenderGraphInvalid;
+    resource.Uses.clear();
+    return m_resourceCount++;
+}
+
+RenderGraphPass RenderGraph::AddPass(const wchar_t* name, bool hasSideEffects)
+{
+    if (m_passCount == m_passes.size())
+    {
+        m_passes.emplace_back();
+    }
+    Pass& pass = m_passes[m_passCount];
+    pass.Name = name;
+    pass.HasSideEffects = hasSideEffects;
+    pass.Accesses.clear();
+    pass.OrderIndex = RenderGraphInvalid;
+    pass.Barriers.clear();
+    return m_passCount++;
+}
+
+void RenderGraph::Read(RenderGraphPass pass, RenderGraphResource resource, uint32_t usage)
+{
+    assert((usage & ~RenderGraphUsage_ReadMask) == 0);
+    AddAccess(pass, resource, usage, false);
+}
+
+void RenderGraph::Write(RenderGraphPass pass, RenderGraphResource resource, uint32_t usage)
+{
+    assert((usage & ~RenderGraphUsage_WriteMask) == 0);
+    AddAccess(pass, resource, usage, true);
+}
+
+void RenderGraph::AddAccess(RenderGraphPass pass, RenderGraphResource resource, uint32_t usage, bool write)
+{
+    assert(pass < m_passCount && resource < m_resourceCount && usage != RenderGraphUsage_None);
+    std::vector<Access>& accesses = m_passes[pass].Accesses;
+    for (Access& access : accesses)
+    {
+        if (access.Resource == resource)
+        {
+            // A resource can be read several ways at once, a write has to be its only use.
+            assert(!write && !access.Write);
+            access.Usage |= usage;
+            return;
+        }
+    }
+    accesses.push_back({ resource, usage, write, RenderGraphInvalid });
+}
+
+void RenderGraph::Compile()
+{
+    m_order.clear();
+    m_finalBarriers.clear();
+    m_slots.clear();
+    m_barrierCount = 0;
+
+    CullPasses();
+    ComputeBarriers();
+    AssignSlots();
+}
+
+void RenderGraph::CullPasses()
+{
+    // Every access remembers which pass produced what it sees. Writes depend
+    // on the previous writer too, passes draw on top of what is there.
+    std::vector<RenderGraphPass> lastWriter(m_resourceCount, RenderGraphInvalid);
+    std::vector<bool> alive(m_passCount, false);
+    for (RenderGraphPass p = 0; p < m_passCount; p++)
+    {
+        Pass& pass = m_passes[p];
+        alive[p] = pass.HasSideEffects;
+        for (Access& access : pass.Accesses)
+        {
+            access.Producer = lastWriter[access.Resource];
+        }
+        for (const Access& access : pass.Accesses)
+        {
+            if (access.Write)
+            {
+                lastWriter[access.Resource] = p;
+                alive[p] = alive[p] || m_resources[access.Resource].Imported;
+            }
+        }
+    }
+
+    // Producers come before their users, one sweep backwards reaches them all.
+    for (RenderGraphPass p = m_passCount; p-- > 0; )
+    {
+        if (!alive[p])
+        {
+            continue;
+        }
+        for (const Access& access : m_passes[p].Accesses)
+        {
+            if (access.Producer != RenderGraphInvalid)
+            {
+                alive[access.Producer] = true;
+            }
+        }
+    }
+
+    for (RenderGraphPass p = 0; p < m_passCount; p++)
+    {
+        m_passes[p].Barriers.clear();
+        m_passes[p].OrderIndex = alive[p] ? static_cast<uint32_t>(m_order.size()) : RenderGraphInvalid;
+        if (alive[p])
+        {
+            m_order.push_back(p);
+        }
+    }
+}
+
+void RenderGraph::ComputeBarriers()
+{
+    for (RenderGraphResource r = 0; r < m_resourceCount; r++)
+    {
+        m_resources[r].Uses.clear();
+    }
+    for (uint32_t i = 0; i < m_order.size(); i++)
+    {
+        for (const Access& access : m_passes[m_order[i]].Accesses)
+        {
+            m_resources[access.Resource].Uses.push_back({ i, access.Usage, access.Write });
+        }
+    }
+
+    std::vector<uint32_t> readRuns;
+    for (RenderGraphResource r = 0; r < m_resourceCount; r++)
+    {
+        Resource& resource = m_resources[r];
+        const std::vector<Use>& uses = resource.Uses;
+        if (!uses.empty())
+        {
+            resource.Lifetime.First = uses.front().OrderIndex;
+            resource.Lifetime.Last = uses.back().OrderIndex;
+        }
+
+        // Usages of each run of reads combined, from every read to the run's end.
+        readRuns.assign(uses.size(), RenderGraphUsage_None);
+        for (size_t i = uses.size(); i-- > 0; )
+        {
+            if (!uses[i].Write)
+            {
+                readRuns[i] = uses[i].Usage | (i + 1 < uses.size() ? readRuns[i + 1] : RenderGraphUsage_None);
+            }
+        }
+
+        uint32_t usage = resource.Imported ? resource.InitialUsage : RenderGraphUsage_None;
+        for (size_t i = 0; i < uses.size(); i++)
+        {
+            // Later reads of a run are covered by the transition at its start.
+            if (!uses[i].Write && i > 0 && !uses[i - 1].Write)
+            {
+                continue;
+            }
+
+            const uint32_t needed = uses[i].Write ? uses[i].Usage : readRuns[i];
+            const bool covered = !uses[i].Write && (usage & ~RenderGraphUsage_ReadMask) == 0 && (usage & needed) == needed;
+            if (needed != usage && !covered)
+            {
+                m_passes[m_order[uses[i].OrderIndex]].Barriers.push_back({ r, usage, needed });
+                m_barrierCount++;
+                usage = needed;
+            }
+            else if (uses[i].Write && i > 0 && (needed & RenderGraphUsage_UnorderedAccess) != 0)
+            {
+                // Nothing to transition, but the pass must not start before the last write finished.
+                m_passes[m_order[uses[i].OrderIndex]].Barriers.push_back({ r, usage, usage });
+                m_barrierCount++;
+            }
+        }
+
+        if (resource.Imported && resource.FinalUsage != RenderGraphUsage_None && resource.FinalUsage != usage)
+        {
+            m_finalBarriers.push_back({ r, usage, resource.FinalUsage });
+            m_barrierCount++;
+        }
+    }
+}
+
+void RenderGraph::AssignSlots()
+{
+    std::vector<RenderGraphResource> transients;
+    for (RenderGraphResource r = 0; r < m_resourceCount; r++)
+    {
+        if (!m_resources[r].Imported && m_resources[r].Lifetime.First != RenderGraphInvalid)
+        {
+            transients.push_back(r);
+        }
+    }
+    std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b)
+    {
+        return m_resources[a].Lifetime.First < m_resources[b].Lifetime.First;
+    });
+
+    // First fit: the first slot with the same desc that is free again.
+    for (RenderGraphResource r : transients)
+    {
+        Resource& resource = m_resources[r];
+        uint32_t usage = RenderGraphUsage_None;
+        for (const Use& use : resource.Uses)
+        {
+            usage |= use.Usage;
+        }
+
+        auto slot = std::find_if(m_slots.begin(), m_slots.end(), [&resource](const Slot& slot)
+        {
+            return slot.LastUse < resource.Lifetime.First && slot.Desc == resource.Desc;
+        });
+        if (slot == m_slots.end())
+        {
+            m_slots.push_back({ resource.Desc, RenderGraphUsage_None, 0 });
+            slot = m_slots.end() - 1;
+        }
+        slot->Usage |= usage;
+        slot->LastUse = resource.Lifetime.Last;
+        resource.Slot = static_cast<uint32_t>(slot - m_slots.begin());
+    }
+}
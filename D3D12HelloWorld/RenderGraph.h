@@ -0,0 +1,176 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+typedef uint32_t RenderGraphResource;
+typedef uint32_t RenderGraphPass;
+
+static const uint32_t RenderGraphInvalid = ~0u;
+
+// How a pass uses a resource, backends map these to their own states.
+// Read usages combine, write usages stand alone.
+enum RenderGraphUsage : uint32_t
+{
+    RenderGraphUsage_None = 0,      // Unknown or undefined, the content is not needed.
+    RenderGraphUsage_RenderTarget = 0x1,
+    RenderGraphUsage_DepthWrite = 0x2,
+    RenderGraphUsage_UnorderedAccess = 0x4,
+    RenderGraphUsage_CopyDest = 0x8,
+    RenderGraphUsage_ResolveDest = 0x10,
+    RenderGraphUsage_DepthRead = 0x100,
+    RenderGraphUsage_ShaderResource = 0x200,
+    RenderGraphUsage_CopySource = 0x400,
+    RenderGraphUsage_ResolveSource = 0x800,
+    RenderGraphUsage_Present = 0x1000,  // Only as the final usage of an imported resource.
+
+    RenderGraphUsage_WriteMask = 0xff,
+    RenderGraphUsage_ReadMask = 0xf00
+};
+
+// What a transient texture is created with. Format is the backend's own
+// enumeration, DXGI_FORMAT for D3D12.
+struct RenderGraphTextureDesc
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t Format = 0;
+    uint32_t SampleCount = 1;
+
+    bool operator==(const RenderGraphTextureDesc& rhs)const
+    {
+        return Width == rhs.Width && Height == rhs.Height && Format == rhs.Format && SampleCount == rhs.SampleCount;
+    }
+};
+
+struct RenderGraphBarrier
+{
+    RenderGraphResource Resource;
+    uint32_t Before;    // RenderGraphUsage_None when the old content does not matter.
+    uint32_t After;     // Before itself for a UAV barrier, which only waits for the writes before.
+};
+
+// Positions in the execution order of the first and last pass using a resource.
+struct RenderGraphLifetime
+{
+    uint32_t First = RenderGraphInvalid;
+    uint32_t Last = RenderGraphInvalid;
+};
+
+// One frame's passes and the resources they read and write, compiled into
+// what to run and which transitions to make. Knows nothing about the API,
+// so it can be built and compiled on any platform; RenderGraphExecutor runs
+// a compiled graph with D3D12.
+//
+// Compile
+//   - culls passes nothing needs: a pass is kept if it has side effects,
+//     writes an imported resource or produces something a kept pass uses,
+//   - runs the rest in the order they were added, in which a pass can only
+//     use what earlier passes produced,
+//   - computes one barrier per change of usage. Reads following each other
+//     share one transition into all their usages combined, unordered access
+//     writes following each other get a UAV barrier between them,
+//   - gives each transient texture its lifetime and a slot. Transients with
+//     the same desc whose lifetimes do not overlap share a slot, backends
+//     create one texture per slot.
+class RenderGraph
+{
+public:
+    // Drops every pass and resource, keeping the memory for the next frame.
+    void Clear();
+
+    // The content of a transient is undefined until its first write.
+    RenderGraphResource CreateTexture(const wchar_t* name, const RenderGraphTextureDesc& desc);
+
+    // A resource that lives outside the graph. initialUsage may be
+    // RenderGraphUsage_None if it is not known; finalUsage None leaves it in
+    // whatever usage the last pass needed.
+    RenderGraphResource ImportResource(const wchar_t* name, uint32_t initialUsage, uint32_t finalUsage);
+
+    // Passes with side effects, such as reading back to the CPU, are never culled.
+    RenderGraphPass AddPass(const wchar_t* name, bool hasSideEffects = false);
+
+    // A pass declares every use of a resource, usages of one pass combine.
+    void Read(RenderGraphPass pass, RenderGraphResource resource, uint32_t usage);
+    void Write(RenderGraphPass pass, RenderGraphResource resource, uint32_t usage);
+
+    void Compile();
+
+    // Results of the last Compile.
+    const std::vector<RenderGraphPass>& GetExecutionOrder()const { return m_order; }
+    bool IsCulled(RenderGraphPass pass)const { return m_passes[pass].OrderIndex == RenderGraphInvalid; }
+    const std::vector<RenderGraphBarrier>& GetBarriers(RenderGraphPass pass)const { return m_passes[pass].Barriers; }
+    const std::vector<RenderGraphBarrier>& GetFinalBarriers()const { return m_finalBarriers; }
+    uint32_t GetBarrierCount()const { return m_barrierCount; }
+
+    RenderGraphLifetime GetLifetime(RenderGraphResource resource)const { return m_resources[resource].Lifetime; }
+    uint32_t GetTextureSlot(RenderGraphResource resource)const { return m_resources[resource].Slot; }
+    uint32_t GetTextureSlotCount()const { return static_cast<uint32_t>(m_slots.size()); }
+    const RenderGraphTextureDesc& GetSlotDesc(uint32_t slot)const { return m_slots[slot].Desc; }
+    uint32_t GetSlotUsage(uint32_t slot)const { return m_slots[slot].Usage; }
+
+    uint32_t GetPassCount()const { return m_passCount; }
+    uint32_t GetResourceCount()const { return m_resourceCount; }
+    const std::wstring& GetPassName(RenderGraphPass pass)const { return m_passes[pass].Name; }
+    const std::wstring& GetResourceName(RenderGraphResource resource)const { return m_resources[resource].Name; }
+    bool IsImported(RenderGraphResource resource)const { return m_resources[resource].Imported; }
+
+private:
+    struct Access
+    {
+        RenderGraphResource Resource;
+        uint32_t Usage;
+        bool Write;
+        RenderGraphPass Producer;   // Last pass writing the resource before this one.
+    };
+
+    struct Pass
+    {
+        std::wstring Name;
+        bool HasSideEffects;
+        std::vector<Access> Accesses;
+        uint32_t OrderIndex;
+        std::vector<RenderGraphBarrier> Barriers;
+    };
+
+    struct Use
+    {
+        uint32_t OrderIndex;
+        uint32_t Usage;
+        bool Write;
+    };
+
+    struct Resource
+    {
+        std::wstring Name;
+        bool Imported;
+        uint32_t InitialUsage;
+        uint32_t FinalUsage;
+        RenderGraphTextureDesc Desc;
+        RenderGraphLifetime Lifetime;
+        uint32_t Slot;
+        std::vector<Use> Uses;      // Scratch for Compile.
+    };
+
+    struct Slot
+    {
+        RenderGraphTextureDesc Desc;
+        uint32_t Usage;     // Every usage of the transients placed in it.
+        uint32_t LastUse;
+    };
+
+    void AddAccess(RenderGraphPass pass, RenderGraphResource resource, uint32_t usage, bool write);
+    void CullPasses();
+    void ComputeBarriers();
+    void AssignSlots();
+
+    std::vector<Pass> m_passes;
+    std::vector<Resource> m_resources;
+    uint32_t m_passCount = 0;
+    uint32_t m_resourceCount = 0;
+
+    std::vector<RenderGraphPass> m_order;
+    std::vector<RenderGraphBarrier> m_finalBarriers;
+    std::vector<Slot> m_slots;
+    uint32_t m_barrierCount = 0;
+};
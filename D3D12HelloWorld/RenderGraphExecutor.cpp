@@ -0,0 +1,199 @@
+#include "stdafx.h"
+#include "RenderGraphExecutor.h"
+#include "GpuMemoryTracker.h"
+
+ID3D12GraphicsCommandList* RenderGraphContext::GetCommandList()
+{
+    if (!m_commandList)
+    {
+        m_commandList = m_executor.m_recorder.Open();
+    }
+    return m_commandList;
+}
+
+ID3D12Resource* RenderGraphContext::GetResource(RenderGraphResource resource)const
+{
+    if (m_executor.m_graph.IsImported(resource))
+    {
+        return m_executor.m_imports[resource];
+    }
+    const UINT slot = m_executor.m_graph.GetTextureSlot(resource);
+    return slot == RenderGraphInvalid ? nullptr : m_executor.m_textures[slot].Resource.Get();
+}
+
+void RenderGraphContext::RecordParallel(UINT itemCount, UINT minItemsPerList, const ParallelCommandRecorder::RecordFunction& record)
+{
+    m_executor.m_recorder.RecordParallel(m_executor.m_jobs, itemCount, minItemsPerList, record);
+    m_commandList = nullptr;
+}
+
+RenderGraphExecutor::RenderGraphExecutor(ID3D12Device* device, ResourceStateTracker& stateTracker,
+    ParallelCommandRecorder& recorder, JobSystem& jobs, UINT frameCount) :
+    m_device(device),
+    m_stateTracker(stateTracker),
+    m_recorder(recorder),
+    m_jobs(jobs),
+    m_retired(frameCount)
+{
+}
+
+RenderGraphExecutor::~RenderGraphExecutor()
+{
+    for (Texture& texture : m_textures)
+    {
+        if (texture.Resource)
+        {
+            m_stateTracker.Unregister(texture.Resource.Get());
+        }
+    }
+}
+
+void RenderGraphExecutor::Reset(UINT frameIndex)
+{
+    m_frameIndex = frameIndex;
+    m_retired[m_frameIndex].clear();
+    m_graph.Clear();
+    m_functions.clear();
+    m_imports.clear();
+}
+
+RenderGraphResource RenderGraphExecutor::Import(LPCWSTR name, ID3D12Resource* resource, UINT finalUsage)
+{
+    // The tracker knows the state it is in, the graph does not need to.
+    const RenderGraphResource handle = m_graph.ImportResource(name, RenderGraphUsage_None, finalUsage);
+    m_imports.resize(handle + 1, nullptr);
+    m_imports[handle] = resource;
+    return handle;
+}
+
+RenderGraphPass RenderGraphExecutor::AddPass(LPCWSTR name, RenderPassFunction function, bool hasSideEffects)
+{
+    const RenderGraphPass pass = m_graph.AddPass(name, hasSideEffects);
+    m_functions.resize(pass + 1);
+    m_functions[pass] = std::move(function);
+    return pass;
+}
+
+D3D12_RESOURCE_STATES RenderGraphExecutor::GetResourceState(UINT usage)
+{
+    static const struct
+    {
+        UINT Usage;
+        D3D12_RESOURCE_STATES State;
+    } states[] =
+    {
+        { RenderGraphUsage_RenderTarget, D3D12_RESOURCE_STATE_RENDER_TARGET },
+        { RenderGraphUsage_DepthWrite, D3D12_RESOURCE_STATE_DEPTH_WRITE },
+        { RenderGraphUsage_UnorderedAccess, D3D12_RESOURCE_STATE_UNORDERED_ACCESS },
+        { RenderGraphUsage_CopyDest, D3D12_RESOURCE_STATE_COPY_DEST },
+        { RenderGraphUsage_ResolveDest, D3D12_RESOURCE_STATE_RESOLVE_DEST },
+        { RenderGraphUsage_DepthRead, D3D12_RESOURCE_STATE_DEPTH_READ },
+        { RenderGraphUsage_ShaderResource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE },
+        { RenderGraphUsage_CopySource, D3D12_RESOURCE_STATE_COPY_SOURCE },
+        { RenderGraphUsage_ResolveSource, D3D12_RESOURCE_STATE_RESOLVE_SOURCE },
+        { RenderGraphUsage_Present, D3D12_RESOURCE_STATE_PRESENT },
+    };
+
+    D3D12_RESOURCE_STATES state = D3D12_RESOURCE_STATE_COMMON;
+    for (const auto& entry : states)
+    {
+        if (usage & entry.Usage)
+        {
+            state |= entry.State;
+        }
+    }
+    return state;
+}
+
+void RenderGraphExecutor::Execute()
+{
+    m_graph.Compile();
+    CreateTextures();
+
+    RenderGraphContext context(*this);
+    for (RenderGraphPass pass : m_graph.GetExecutionOrder())
+    {
+        Transition(m_graph.GetBarriers(pass), context);
+        m_functions[pass](context);
+    }
+    Transition(m_graph.GetFinalBarriers(), context);
+}
+
+void RenderGraphExecutor::Transition(const std::vector<RenderGraphBarrier>& barriers, RenderGraphContext& context)
+{
+    if (barriers.empty())
+    {
+        return;
+    }
+    for (const RenderGraphBarrier& barrier : barriers)
+    {
+        if (barrier.Before == barrier.After)
+        {
+            m_stateTracker.UavBarrier(context.GetResource(barrier.Resource));
+        }
+        else
+        {
+            m_stateTracker.Transition(context.GetResource(barrier.Resource), GetResourceState(barrier.After));
+        }
+    }
+    m_stateTracker.Flush(context.GetCommandList());
+}
+
+// One texture per slot, allowed every usage of the transients placed in it.
+void RenderGraphExecutor::CreateTextures()
+{
+    const UINT slotCount = m_graph.GetTextureSlotCount();
+    if (m_textures.size() < slotCount)
+    {
+        m_textures.resize(slotCount);
+    }
+
+    for (UINT slot = 0; slot < slotCount; slot++)
+    {
+        const RenderGraphTextureDesc& desc = m_graph.GetSlotDesc(slot);
+        const UINT usage = m_graph.GetSlotUsage(slot);
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE;
+        if (usage & RenderGraphUsage_RenderTarget)
+        {
+            flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+        }
+        if (usage & (RenderGraphUsage_DepthWrite | RenderGraphUsage_DepthRead))
+        {
+            flags |= D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+        }
+        if (usage & RenderGraphUsage_UnorderedAccess)
+        {
+            flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+        }
+
+        Texture& texture = m_textures[slot];
+        if (texture.Resource && texture.Desc == desc && (texture.Flags & flags) == flags)
+        {
+            continue;
+        }
+
+        // Earlier frames may still use the old texture, it goes when this frame index comes round again.
+        if (texture.Resource)
+        {
+            m_stateTracker.Unregister(texture.Resource.Get());
+            m_retired[m_frameIndex].push_back(std::move(texture.Resource));
+        }
+
+        texture.Desc = desc;
+        texture.Flags = flags;
+        ThrowIfFailed(m_device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(desc.Format), desc.Width, desc.Height, 1, 1,
+                desc.SampleCount, 0, flags),
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(&texture.Resource)
+        ));
+        GpuMemoryTracker::TrackResource(texture.Resource.Get(),
+            (flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) ? GpuMemoryCategory::DepthStencil :
+            (flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) ? GpuMemoryCategory::RenderTarget : GpuMemoryCategory::Texture,
+            (L"RenderGraph slot " + std::to_wstring(slot)).c_str());
+        m_stateTracker.Register(texture.Resource.Get(), D3D12_RESOURCE_STATE_COMMON);
+    }
+}
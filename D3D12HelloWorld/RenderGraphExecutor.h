@@ -0,0 +1,99 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include "RenderGraph.h"
+#include "ResourceStateTracker.h"
+#include "ParallelCommandRecorder.h"
+
+class RenderGraphExecutor;
+
+// What a pass records with. The list is opened on first use and carries the
+// pass's barriers; RecordParallel puts its lists after it, and whatever is
+// recorded after that goes into a new list.
+class RenderGraphContext
+{
+public:
+    ID3D12GraphicsCommandList* GetCommandList();
+
+    // The texture behind a resource the pass declared.
+    ID3D12Resource* GetResource(RenderGraphResource resource)const;
+
+    void RecordParallel(UINT itemCount, UINT minItemsPerList, const ParallelCommandRecorder::RecordFunction& record);
+
+private:
+    friend class RenderGraphExecutor;
+    explicit RenderGraphContext(RenderGraphExecutor& executor) :
+        m_executor(executor)
+    {
+    }
+
+    RenderGraphExecutor& m_executor;
+    ID3D12GraphicsCommandList* m_commandList = nullptr;
+};
+
+typedef std::function<void(RenderGraphContext& context)> RenderPassFunction;
+
+// Builds a RenderGraph every frame and runs it with D3D12. Barriers are asked
+// of the state tracker, which knows where imported resources really are, and
+// flushed in one call before each pass that needs any. Transient textures
+// are committed resources, one per slot of the compiled graph, kept from
+// frame to frame and only created again when a slot's desc changes.
+//
+// The frame's lists come from recorder, which the caller begins and submits.
+class RenderGraphExecutor
+{
+public:
+    RenderGraphExecutor(ID3D12Device* device, ResourceStateTracker& stateTracker,
+        ParallelCommandRecorder& recorder, JobSystem& jobs, UINT frameCount);
+    ~RenderGraphExecutor();
+
+    RenderGraphExecutor(const RenderGraphExecutor& rhs) = delete;
+    RenderGraphExecutor& operator=(const RenderGraphExecutor& rhs) = delete;
+
+    // Starts the graph of frameIndex. Textures dropped the last time that
+    // index was executed are released, the GPU must be done with it.
+    void Reset(UINT frameIndex);
+
+    // resource must be registered with the state tracker.
+    RenderGraphResource Import(LPCWSTR name, ID3D12Resource* resource, UINT finalUsage = RenderGraphUsage_None);
+    RenderGraphResource CreateTexture(LPCWSTR name, const RenderGraphTextureDesc& desc)
+    {
+        return m_graph.CreateTexture(name, desc);
+    }
+
+    RenderGraphPass AddPass(LPCWSTR name, RenderPassFunction function, bool hasSideEffects = false);
+    void Read(RenderGraphPass pass, RenderGraphResource resource, UINT usage) { m_graph.Read(pass, resource, usage); }
+    void Write(RenderGraphPass pass, RenderGraphResource resource, UINT usage) { m_graph.Write(pass, resource, usage); }
+
+    // Compiles the graph and records the passes that are not culled.
+    void Execute();
+
+    const RenderGraph& GetGraph()const { return m_graph; }
+
+    static D3D12_RESOURCE_STATES GetResourceState(UINT usage);
+
+private:
+    friend class RenderGraphContext;
+
+    struct Texture
+    {
+        RenderGraphTextureDesc Desc;
+        D3D12_RESOURCE_FLAGS Flags = D3D12_RESOURCE_FLAG_NONE;
+        ComPtr<ID3D12Resource> Resource;
+    };
+
+    void CreateTextures();
+    void Transition(const std::vector<RenderGraphBarrier>& barriers, RenderGraphContext& context);
+
+    ComPtr<ID3D12Device> m_device;
+    ResourceStateTracker& m_stateTracker;
+    ParallelCommandRecorder& m_recorder;
+    JobSystem& m_jobs;
+
+    RenderGraph m_graph;
+    std::vector<RenderPassFunction> m_functions;        // Per pass.
+    std::vector<ID3D12Resource*> m_imports;             // Per resource, null for transients.
+
+    std::vector<Texture> m_textures;                    // Per slot.
+    std::vector<std::vector<ComPtr<ID3D12Resource>>> m_retired;  // Per frame index.
+    UINT m_frameIndex = 0;
+};
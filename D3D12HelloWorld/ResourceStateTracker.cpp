@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "ResourceStateTracker.h"
+
+// States that only read, any number of them can be combined.
+static const D3D12_RESOURCE_STATES ReadOnlyStates =
+    D3D12_RESOURCE_STATE_GENERIC_READ |
+    D3D12_RESOURCE_STATE_DEPTH_READ |
+    D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+
+void ResourceStateTracker::Register(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, UINT subresourceCount)
+{
+    assert(resource);
+    if (subresourceCount == 0)
+    {
+        const D3D12_RESOURCE_DESC desc = resource->GetDesc();
+        const UINT arraySize = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+        subresourceCount = std::max<UINT>(desc.MipLevels, 1) * arraySize;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    TrackedResource& tracked = m_resources[resource];
+    tracked.States.assign(subresourceCount, state);
+    tracked.FlushedStates = tracked.States;
+    tracked.UavBarrier = false;
+    if (tracked.Pending)
+    {
+        tracked.Pending = false;
+        m_pending.erase(std::remove(m_pending.begin(), m_pending.end(), resource), m_pending.end());
+    }
+}
+
+void ResourceStateTracker::Unregister(ID3D12Resource* resource)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_resources.erase(resource);
+    m_pending.erase(std::remove(m_pending.begin(), m_pending.end(), resource), m_pending.end());
+}
+
+ResourceStateTracker::TrackedResource& ResourceStateTracker::Find(ID3D12Resource* resource)
+{
+    auto it = m_resources.find(resource);
+    if (it == m_resources.end())
+    {
+        // Untracked resources are a bug in the caller, not something to recover from.
+        assert(!"Resource not registered with the state tracker");
+        ThrowIfFailed(E_INVALIDARG);
+    }
+    return it->second;
+}
+
+D3D12_RESOURCE_STATES ResourceStateTracker::GetState(ID3D12Resource* resource, UINT subresource)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    const TrackedResource& tracked = Find(resource);
+    assert(subresource < tracked.States.size());
+    return tracked.States[subresource];
+}
+
+bool ResourceStateTracker::IsCoveredBy(D3D12_RESOURCE_STATES state, D3D12_RESOURCE_STATES current)
+{
+    if (state == current)
+    {
+        return true;
+    }
+
+    // COMMON, which PRESENT is too, has no bits to be covered by.
+    return state != D3D12_RESOURCE_STATE_COMMON &&
+        (current & ~ReadOnlyStates) == 0 && (current & state) == state;
+}
+
+void ResourceStateTracker::Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, UINT subresource)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    TrackedResource& tracked = Find(resource);
+
+    const UINT first = subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ? 0 : subresource;
+    const UINT end = subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ? static_cast<UINT>(tracked.States.size()) : subresource + 1;
+    assert(end <= tracked.States.size());
+
+    bool changed = false;
+    for (UINT i = first; i < end; i++)
+    {
+        if (!IsCoveredBy(state, tracked.States[i]))
+        {
+            tracked.States[i] = state;
+            changed = true;
+        }
+    }
+    if (changed && !tracked.Pending)
+    {
+        tracked.Pending = true;
+        m_pending.push_back(resource);
+    }
+}
+
+void ResourceStateTracker::UavBarrier(ID3D12Resource* resource)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    TrackedResource& tracked = Find(resource);
+    tracked.UavBarrier = true;
+    if (!tracked.Pending)
+    {
+        tracked.Pending = true;
+        m_pending.push_back(resource);
+    }
+}
+
+// Called with m_lock held.
+void ResourceStateTracker::AppendPendingBarriers(std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+{
+    for (ID3D12Resource* resource : m_pending)
+    {
+        TrackedResource& tracked = m_resources[resource];
+        tracked.Pending = false;
+        const size_t count = barriers.size();
+
+        // One barrier for the whole resource when every subresource makes the
+        // same move, one per subresource that changed otherwise.
+        const D3D12_RESOURCE_STATES before = tracked.FlushedStates[0];
+        const D3D12_RESOURCE_STATES after = tracked.States[0];
+        bool uniform = before != after;
+        for (size_t i = 1; uniform && i < tracked.States.size(); i++)
+        {
+            uniform = tracked.FlushedStates[i] == before && tracked.States[i] == after;
+        }
+
+        if (uniform)
+        {
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, before, after));
+        }
+        else
+        {
+            for (UINT i = 0; i < tracked.States.size(); i++)
+            {
+                if (tracked.FlushedStates[i] != tracked.States[i])
+                {
+                    barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource,
+                        tracked.FlushedStates[i], tracked.States[i], i));
+                }
+            }
+        }
+        if (tracked.UavBarrier && barriers.size() == count)
+        {
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+        }
+        tracked.UavBarrier = false;
+        tracked.FlushedStates = tracked.States;
+    }
+    m_pending.clear();
+}
+
+UINT ResourceStateTracker::Flush(ID3D12GraphicsCommandList* cmdList)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_barrierScratch.clear();
+    AppendPendingBarriers(m_barrierScratch);
+    if (!m_barrierScratch.empty())
+    {
+        cmdList->ResourceBarrier(static_cast<UINT>(m_barrierScratch.size()), m_barrierScratch.data());
+        m_barrierCalls++;
+        m_barriers += m_barrierScratch.size();
+    }
+    return static_cast<UINT>(m_barrierScratch.size());
+}
+
+UINT ResourceStateTracker::Flush(std::vector<D3D12_RESOURCE_BARRIER>& barriers)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    const size_t count = barriers.size();
+    AppendPendingBarriers(barriers);
+    return static_cast<UINT>(barriers.size() - count);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include <mutex>
+
+// Knows the state every registered resource is in, per subresource, so code
+// asks for the state it needs instead of spelling out the one it thinks the
+// resource is in. Requests only take effect at the next Flush, which records
+// every pending transition in one ResourceBarrier call. Requests that leave a
+// resource where it is, such as RENDER_TARGET -> COPY_SOURCE -> RENDER_TARGET
+// between two flushes, record nothing, and chains collapse into one barrier.
+//
+// States follow recording order, so lists using the tracker must be executed
+// on one queue in the order they were recorded. Lists recorded in parallel
+// get their resources into state beforehand and leave them there.
+class ResourceStateTracker
+{
+public:
+    ResourceStateTracker() = default;
+
+    ResourceStateTracker(const ResourceStateTracker& rhs) = delete;
+    ResourceStateTracker& operator=(const ResourceStateTracker& rhs) = delete;
+
+    // Start tracking resource in state, which every subresource is in.
+    // subresourceCount 0 counts mips and array slices; pass it for planar
+    // formats. Registering a resource again starts over.
+    void Register(ID3D12Resource* resource, D3D12_RESOURCE_STATES state, UINT subresourceCount = 0);
+
+    // Before the resource is released, a new one may reuse the address.
+    void Unregister(ID3D12Resource* resource);
+
+    // The state as of the requests made so far.
+    D3D12_RESOURCE_STATES GetState(ID3D12Resource* resource, UINT subresource = 0);
+
+    // Ask for resource to be in state when the commands after the next Flush
+    // run. A read state already covered by the current one is left alone.
+    void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES state,
+        UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+    // Ask for the unordered access writes to resource recorded so far to be
+    // done before the commands after the next Flush run. Left out if the
+    // resource is transitioned at that flush, which waits for them anyway.
+    void UavBarrier(ID3D12Resource* resource);
+
+    // Records the transitions still needed in a single ResourceBarrier call,
+    // none if there are none. Returns the number of barriers recorded.
+    UINT Flush(ID3D12GraphicsCommandList* cmdList);
+
+    // Same, but appends the barriers for the caller to record, which also
+    // lets the tracker run without a device. Not counted below.
+    UINT Flush(std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+
+    UINT64 GetBarrierCallCount()const { return m_barrierCalls; }
+    UINT64 GetBarrierCount()const { return m_barriers; }
+
+private:
+    struct TrackedResource
+    {
+        std::vector<D3D12_RESOURCE_STATES> States;          // As requested.
+        std::vector<D3D12_RESOURCE_STATES> FlushedStates;   // As of the last flush.
+        bool Pending = false;
+        bool UavBarrier = false;
+    };
+
+    static bool IsCoveredBy(D3D12_RESOURCE_STATES state, D3D12_RESOURCE_STATES current);
+    TrackedResource& Find(ID3D12Resource* resource);
+    void AppendPendingBarriers(std::vector<D3D12_RESOURCE_BARRIER>& barriers);
+
+    std::unordered_map<ID3D12Resource*, TrackedResource> m_resources;
+    std::vector<ID3D12Resource*> m_pending;     // In request order.
+    std::vector<D3D12_RESOURCE_BARRIER> m_barrierScratch;
+    std::mutex m_lock;
+
+    UINT64 m_barrierCalls = 0;
+    UINT64 m_barriers = 0;
+};
@@ -0,0 +1,82 @@
+#include "stdafx.h"
+#include "RootSignatureCache.h"
+
+RootSignatureCache::RootSignatureCache(ID3D12Device* device, const std::wstring& cacheDirectory) :
+    m_device(device),
+    m_cacheDirectory(cacheDirectory),
+    m_memoryHits(0),
+    m_diskHits(0),
+    m_serializes(0)
+{
+    // CheckFeatureSupport fails for 1.1 on runtimes that only know 1.0.
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+    featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+    {
+        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+    }
+    m_version = featureData.HighestVersion;
+
+    if (!m_cacheDirectory.empty())
+    {
+        CreateDirectoryW(m_cacheDirectory.c_str(), nullptr);
+    }
+}
+
+std::wstring RootSignatureCache::GetBlobPath(UINT64 key)const
+{
+    WCHAR name[32];
+    swprintf_s(name, L"%016llx.rs", key);
+    return m_cacheDirectory + name;
+}
+
+ComPtr<ID3D12RootSignature> RootSignatureCache::GetOrCreate(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, UINT64* contentHash)
+{
+    // The blob depends on the version it was serialized at as well.
+    const UINT64 key = HashBytes(&m_version, sizeof(m_version), HashRootSignatureDesc(desc));
+    if (contentHash)
+    {
+        *contentHash = key;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_rootSignatures.find(key);
+        if (it != m_rootSignatures.end())
+        {
+            m_memoryHits++;
+            return it->second;
+        }
+    }
+
+    // A blob that fails to create, say a truncated file, is serialized again.
+    ComPtr<ID3D12RootSignature> rootSignature;
+    std::vector<BYTE> blob;
+    if (!m_cacheDirectory.empty() && ReadFileBytes(GetBlobPath(key), blob) && !blob.empty() &&
+        SUCCEEDED(m_device->CreateRootSignature(0, blob.data(), blob.size(), IID_PPV_ARGS(&rootSignature))))
+    {
+        m_diskHits++;
+    }
+    else
+    {
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> error;
+        const HRESULT hr = D3DX12SerializeVersionedRootSignature(&desc, m_version, &signature, &error);
+        if (error)
+        {
+            OutputDebugStringA(static_cast<const char*>(error->GetBufferPointer()));
+        }
+        ThrowIfFailed(hr);
+        ThrowIfFailed(m_device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
+        m_serializes++;
+
+        if (!m_cacheDirectory.empty())
+        {
+            // A read-only cache still works, it just never warms up.
+            WriteFileAtomic(GetBlobPath(key), signature->GetBufferPointer(), signature->GetBufferSize());
+        }
+    }
+
+    // Another thread may have created the same root signature meanwhile, everyone gets the first one.
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_rootSignatures.emplace(key, rootSignature).first->second;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "PipelineStateHash.h"
+#include <atomic>
+#include <mutex>
+
+// Creates root signatures at most once per distinct desc and keeps their
+// serialized blobs on disk, so later runs skip serialization. Passes that
+// describe the same layout share one object, and a command list only needs a
+// new SetGraphicsRootSignature when the pointer actually changes.
+class RootSignatureCache
+{
+public:
+    // An empty directory keeps root signatures in memory only. Descs are
+    // serialized at the highest version the device supports.
+    RootSignatureCache(ID3D12Device* device, const std::wstring& cacheDirectory);
+
+    RootSignatureCache(const RootSignatureCache& rhs) = delete;
+    RootSignatureCache& operator=(const RootSignatureCache& rhs) = delete;
+
+    // Safe to call from several threads. Throws HrException if serialization
+    // or creation fails. contentHash, if given, receives a hash that is stable
+    // across runs, for PipelineStateCache::RegisterRootSignature.
+    ComPtr<ID3D12RootSignature> GetOrCreate(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, UINT64* contentHash = nullptr);
+
+    UINT GetMemoryHitCount()const { return m_memoryHits; }
+    UINT GetDiskHitCount()const { return m_diskHits; }
+    UINT GetSerializeCount()const { return m_serializes; }
+
+private:
+    std::wstring GetBlobPath(UINT64 key)const;
+
+    ComPtr<ID3D12Device> m_device;
+    std::wstring m_cacheDirectory;
+    D3D_ROOT_SIGNATURE_VERSION m_version;
+
+    std::unordered_map<UINT64, ComPtr<ID3D12RootSignature>> m_rootSignatures;
+    std::mutex m_lock;
+
+    std::atomic<UINT> m_memoryHits;
+    std::atomic<UINT> m_diskHits;
+    std::atomic<UINT> m_serializes;
+};
@@ -0,0 +1,313 @@
+#include "stdafx.h"
+#include "ShaderCache.h"
+
+static const UINT32 ShaderCacheMagic = 0x43485353; // "SSHC"
+static const UINT32 ShaderCacheVersion = 1;
+
+struct ShaderCacheFileHeader
+{
+    UINT32 Magic;
+    UINT32 Version;
+    UINT64 Key;
+    UINT32 IncludeCount;
+    UINT32 ByteCodeSize;
+};
+
+// Loads includes from one directory and remembers which ones were opened,
+// with the hash of exactly the bytes handed to the compiler.
+class RecordingInclude : public ID3DInclude
+{
+public:
+    RecordingInclude(const std::wstring& directory, std::vector<ShaderInclude>& includes) :
+        m_directory(directory),
+        m_includes(includes)
+    {
+    }
+
+    HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID* ppData, UINT* pBytes) override
+    {
+        std::ifstream file(m_directory + AnsiToWString(pFileName), std::ios::in | std::ios::binary);
+        if (!file)
+        {
+            return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+        }
+
+        std::unique_ptr<std::vector<char>> data = std::make_unique<std::vector<char>>(
+            std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        *ppData = data->data();
+        *pBytes = static_cast<UINT>(data->size());
+        const UINT64 hash = IncludeHashCache::HashContents(data->data(), data->size());
+        m_buffers.push_back(std::move(data));
+
+        auto it = std::find_if(m_includes.begin(), m_includes.end(), [pFileName](const ShaderInclude& include)
+        {
+            return include.Name == pFileName;
+        });
+        if (it == m_includes.end())
+        {
+            m_includes.push_back({ pFileName, hash });
+        }
+        return S_OK;
+    }
+
+    // Buffers live as long as the handler, which outlives the compile.
+    HRESULT __stdcall Close(LPCVOID pData) override
+    {
+        return S_OK;
+    }
+
+private:
+    std::wstring m_directory;
+    std::vector<ShaderInclude>& m_includes;
+    std::vector<std::unique_ptr<std::vector<char>>> m_buffers;
+};
+
+ComPtr<ID3DBlob> CompileShaderWithD3DCompiler(const ShaderCompileDesc& desc, const std::wstring& includeDirectory, std::vector<ShaderInclude>& includes)
+{
+    std::vector<D3D_SHADER_MACRO> macros;
+    for (const ShaderDefine& define : desc.Defines)
+    {
+        macros.push_back({ define.Name.c_str(), define.Value.c_str() });
+    }
+    macros.push_back({ nullptr, nullptr });
+
+    RecordingInclude includeHandler(includeDirectory, includes);
+    ComPtr<ID3DBlob> byteCode;
+    ComPtr<ID3DBlob> errors;
+    HRESULT hr = D3DCompile(desc.Source.Data, static_cast<SIZE_T>(desc.Source.Size), desc.SourceName.c_str(), macros.data(), &includeHandler,
+        desc.EntryPoint.c_str(), desc.Target.c_str(), desc.Flags, 0, &byteCode, &errors);
+
+    if (errors != nullptr)
+    {
+        OutputDebugStringA((char*)errors->GetBufferPointer());
+    }
+    ThrowIfFailed(hr);
+
+    return byteCode;
+}
+
+UINT GetDefaultShaderCompileFlags()
+{
+#if defined(_DEBUG) || defined(DBG)
+    return D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#else
+    return 0;
+#endif
+}
+
+// Length prefixed, so "ab" + "c" and "a" + "bc" hash differently.
+static UINT64 HashString(const std::string& str, UINT64 hash)
+{
+    const UINT64 length = str.size();
+    hash = HashBytes(&length, sizeof(length), hash);
+    return HashBytes(str.data(), str.size(), hash);
+}
+
+ShaderCache::ShaderCache(const std::wstring& cacheDirectory, const std::wstring& includeDirectory, ShaderCompileFunction compile) :
+    m_cacheDirectory(cacheDirectory),
+    m_includeDirectory(includeDirectory),
+    m_compile(std::move(compile)),
+    m_includeHashes(includeDirectory),
+    m_hits(0),
+    m_misses(0)
+{
+    if (!m_cacheDirectory.empty())
+    {
+        if (!CreateDirectoryW(m_cacheDirectory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+        {
+            ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+        }
+    }
+}
+
+UINT64 ShaderCache::ComputeKey(const ShaderCompileDesc& desc)
+{
+    // The compiler version is part of the key, a new compiler may emit different code.
+    UINT64 hash = HashBytes(&ShaderCacheVersion, sizeof(ShaderCacheVersion));
+    const UINT compilerVersion = D3D_COMPILER_VERSION;
+    hash = HashBytes(&compilerVersion, sizeof(compilerVersion), hash);
+
+    hash = HashString(desc.SourceName, hash);
+    hash = HashBytes(desc.Source.Data, static_cast<SIZE_T>(desc.Source.Size), hash);
+    for (const ShaderDefine& define : desc.Defines)
+    {
+        hash = HashString(define.Name, hash);
+        hash = HashString(define.Value, hash);
+    }
+    hash = HashString(desc.EntryPoint, hash);
+    hash = HashString(desc.Target, hash);
+    return HashBytes(&desc.Flags, sizeof(desc.Flags), hash);
+}
+
+ComPtr<ID3DBlob> ShaderCache::GetOrCompile(const ShaderCompileDesc& desc)
+{
+    const UINT64 key = ComputeKey(desc);
+    std::shared_ptr<const Entry> cached;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end())
+        {
+            cached = it->second;
+        }
+    }
+    if (cached && IsUpToDate(*cached))
+    {
+        m_hits++;
+        return cached->ByteCode;
+    }
+
+    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+    if (ReadEntry(key, *entry) && IsUpToDate(*entry))
+    {
+        m_hits++;
+    }
+    else
+    {
+        // Compile without holding the lock so other shaders can compile in parallel.
+        entry->Includes.clear();
+        entry->ByteCode = m_compile(desc, m_includeDirectory, entry->Includes);
+        for (const ShaderInclude& include : entry->Includes)
+        {
+            m_includeHashes.Record(include.Name, include.ContentHash);
+        }
+        WriteEntry(key, *entry);
+        m_misses++;
+    }
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_entries[key] = entry;
+    return entry->ByteCode;
+}
+
+void ShaderCache::NotifyFilesChanged(const std::vector<std::wstring>& fileNames)
+{
+    for (const std::wstring& fileName : fileNames)
+    {
+        m_includeHashes.Invalidate(fileName);
+    }
+}
+
+std::vector<std::string> ShaderCache::GetIncludes(const ShaderCompileDesc& desc)
+{
+    const UINT64 key = ComputeKey(desc);
+    std::vector<std::string> includes;
+    std::lock_guard<std::mutex> lock(m_lock);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end())
+    {
+        for (const ShaderInclude& include : it->second->Includes)
+        {
+            includes.push_back(include.Name);
+        }
+    }
+    return includes;
+}
+
+bool ShaderCache::IsUpToDate(const Entry& entry)
+{
+    for (const ShaderInclude& include : entry.Includes)
+    {
+        if (m_includeHashes.GetHash(include.Name) != include.ContentHash)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::wstring ShaderCache::GetEntryPath(UINT64 key)const
+{
+    WCHAR name[32];
+    swprintf_s(name, L"%016llx.shc", key);
+    return m_cacheDirectory + name;
+}
+
+// Anything unexpected in the file is treated as a miss, it gets rewritten.
+bool ShaderCache::ReadEntry(UINT64 key, Entry& entry)const
+{
+    if (m_cacheDirectory.empty())
+    {
+        return false;
+    }
+
+    std::ifstream file(GetEntryPath(key), std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+
+    ShaderCacheFileHeader header = {};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.Magic != ShaderCacheMagic || header.Version != ShaderCacheVersion || header.Key != key)
+    {
+        return false;
+    }
+
+    // Counts and sizes have to fit in what is left of the file before anything is allocated for them.
+    const std::streamoff start = file.tellg();
+    file.seekg(0, std::ios::end);
+    UINT64 remaining = UINT64(file.tellg() - start);
+    file.seekg(start);
+    const UINT64 minIncludeSize = sizeof(ShaderInclude::ContentHash) + sizeof(UINT32);
+    if (header.IncludeCount > remaining / minIncludeSize)
+    {
+        return false;
+    }
+
+    entry.Includes.resize(header.IncludeCount);
+    for (ShaderInclude& include : entry.Includes)
+    {
+        UINT32 nameLength = 0;
+        file.read(reinterpret_cast<char*>(&include.ContentHash), sizeof(include.ContentHash));
+        file.read(reinterpret_cast<char*>(&nameLength), sizeof(nameLength));
+        if (!file || nameLength > MAX_PATH)
+        {
+            return false;
+        }
+        include.Name.resize(nameLength);
+        file.read(&include.Name[0], nameLength);
+    }
+
+    remaining -= UINT64(file.tellg() - start);
+    if (!file || header.ByteCodeSize > remaining || FAILED(D3DCreateBlob(header.ByteCodeSize, &entry.ByteCode)))
+    {
+        return false;
+    }
+    file.read(static_cast<char*>(entry.ByteCode->GetBufferPointer()), header.ByteCodeSize);
+    return static_cast<bool>(file);
+}
+
+// Written to a temporary file first so a crash or a concurrent reader
+// never sees a partial entry.
+void ShaderCache::WriteEntry(UINT64 key, const Entry& entry)const
+{
+    if (m_cacheDirectory.empty())
+    {
+        return;
+    }
+
+    ShaderCacheFileHeader header = {};
+    header.Magic = ShaderCacheMagic;
+    header.Version = ShaderCacheVersion;
+    header.Key = key;
+    header.IncludeCount = static_cast<UINT32>(entry.Includes.size());
+    header.ByteCodeSize = static_cast<UINT32>(entry.ByteCode->GetBufferSize());
+
+    std::vector<BYTE> data;
+    auto append = [&data](const void* bytes, SIZE_T size)
+    {
+        data.insert(data.end(), static_cast<const BYTE*>(bytes), static_cast<const BYTE*>(bytes) + size);
+    };
+    append(&header, sizeof(header));
+    for (const ShaderInclude& include : entry.Includes)
+    {
+        const UINT32 nameLength = static_cast<UINT32>(include.Name.size());
+        append(&include.ContentHash, sizeof(include.ContentHash));
+        append(&nameLength, sizeof(nameLength));
+        append(include.Name.data(), nameLength);
+    }
+    append(entry.ByteCode->GetBufferPointer(), header.ByteCodeSize);
+
+    // A read-only cache still works, it just never warms up.
+    WriteFileAtomic(GetEntryPath(key), data.data(), data.size());
@@ -0,0 +1,107 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include "IncludeHashCache.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+struct ShaderDefine
+{
+    std::string Name;
+    std::string Value;
+};
+
+// Everything that decides the bytecode a compile produces, apart from the
+// contents of the files it includes.
+struct ShaderCompileDesc
+{
+    std::string SourceName;             // Shown in compiler errors.
+    ByteSpan Source;
+    std::vector<ShaderDefine> Defines;
+    std::string EntryPoint;
+    std::string Target;
+    UINT Flags = 0;
+};
+
+// A file a compile included and the hash of the bytes it was served.
+struct ShaderInclude
+{
+    std::string Name;
+    UINT64 ContentHash;     // IncludeHashCache::HashContents of the contents.
+};
+
+// Compiles desc, resolving #include names against includeDirectory and adding
+// every file it included to includes, once each. Throws HrException on errors.
+typedef std::function<ComPtr<ID3DBlob>(const ShaderCompileDesc& desc, const std::wstring& includeDirectory, std::vector<ShaderInclude>& includes)> ShaderCompileFunction;
+
+ComPtr<ID3DBlob> CompileShaderWithD3DCompiler(const ShaderCompileDesc& desc, const std::wstring& includeDirectory, std::vector<ShaderInclude>& includes);
+
+// Debug info and no optimization in debug builds, as the samples always used.
+UINT GetDefaultShaderCompileFlags();
+
+// Persistent shader bytecode cache. Every compile is stored as
+// <cacheDirectory><key>.shc, key being a hash of the compile desc. The file
+// also records the includes used with a hash of their contents, so editing an
+// include invalidates every shader using it. Later runs, or AssetTools
+// precompile ahead of time, fill the directory so startup skips the compiler.
+//
+// Include contents are hashed once per run, not on every lookup. An edit
+// while running is only seen after NotifyFilesChanged, hot reload passes on
+// what the FileWatcher reports.
+//
+// The compiler is injected so the lookup and invalidation rules can be
+// exercised with a stub compile function.
+class ShaderCache
+{
+public:
+    // An empty cacheDirectory keeps compiles in memory only.
+    ShaderCache(const std::wstring& cacheDirectory, const std::wstring& includeDirectory,
+        ShaderCompileFunction compile = CompileShaderWithD3DCompiler);
+
+    ShaderCache(const ShaderCache& rhs) = delete;
+    ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+    // Cached bytecode if nothing that went into it changed, otherwise compiles
+    // and stores the result. Safe to call from several threads.
+    ComPtr<ID3DBlob> GetOrCompile(const ShaderCompileDesc& desc);
+
+    // Files the last compile of desc included, empty if it never went through
+    // GetOrCompile. Hot reload uses them to tell which shaders an edit affects.
+    std::vector<std::string> GetIncludes(const ShaderCompileDesc& desc);
+
+    // Files in the include directory changed on disk, names relative to it.
+    // "*" stands for any file.
+    void NotifyFilesChanged(const std::vector<std::wstring>& fileNames);
+
+    static UINT64 ComputeKey(const ShaderCompileDesc& desc);
+
+    UINT GetHitCount()const { return m_hits; }
+    UINT GetMissCount()const { return m_misses; }
+    // Include files read from disk to validate entries.
+    size_t GetIncludeReadCount()const { return m_includeHashes.GetReadCount(); }
+
+private:
+    struct Entry
+    {
+        ComPtr<ID3DBlob> ByteCode;
+        std::vector<ShaderInclude> Includes;
+    };
+
+    bool IsUpToDate(const Entry& entry);
+    std::wstring GetEntryPath(UINT64 key)const;
+    bool ReadEntry(UINT64 key, Entry& entry)const;
+    void WriteEntry(UINT64 key, const Entry& entry)const;
+
+    std::wstring m_cacheDirectory;
+    std::wstring m_includeDirectory;
+    ShaderCompileFunction m_compile;
+    IncludeHashCache m_includeHashes;
+
+    // Entries are immutable once added, so lookups only hold m_lock to find them.
+    std::unordered_map<UINT64, std::shared_ptr<const Entry>> m_entries;
+    std::mutex m_lock;
+
+    std::atomic<UINT> m_hits;
+    std::atomic<UINT> m_misses;
+};
@@ -0,0 +1,165 @@
+#include "stdafx.h"
+#include "ShaderPermutations.h"
+
+std::vector<std::string> ParseShaderKeywords(const ByteSpan& source)
+{
+    static const char Directive[] = "keywords:";
+    const std::string text(reinterpret_cast<const char*>(source.Data), static_cast<size_t>(source.Size));
+
+    std::vector<std::string> keywords;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        const size_t comment = line.find_first_not_of(" \t");
+        if (comment == std::string::npos || line.compare(comment, 2, "//") != 0)
+        {
+            continue;
+        }
+        const size_t directive = line.find_first_not_of(" \t", comment + 2);
+        if (directive == std::string::npos || line.compare(directive, sizeof(Directive) - 1, Directive) != 0)
+        {
+            continue;
+        }
+
+        std::istringstream names(line.substr(directive + sizeof(Directive) - 1));
+        std::string name;
+        while (names >> name)
+        {
+            if (std::find(keywords.begin(), keywords.end(), name) == keywords.end())
+            {
+                keywords.push_back(name);
+            }
+        }
+    }
+    return keywords;
+}
+
+ShaderPermutationSet::ShaderPermutationSet(const ShaderCompileDesc& base, const std::vector<std::string>& keywords) :
+    m_base(base),
+    m_keywords(keywords)
+{
+    if (m_keywords.size() > MaxKeywords)
+    {
+        ThrowIfFailed(E_INVALIDARG);
+    }
+    m_variants.resize(size_t(1) << m_keywords.size());
+}
+
+ShaderPermutationKey ShaderPermutationSet::GetKeywordBit(const std::string& keyword)const
+{
+    auto it = std::find(m_keywords.begin(), m_keywords.end(), keyword);
+    return it == m_keywords.end() ? 0 : 1u << (it - m_keywords.begin());
+}
+
+ShaderCompileDesc ShaderPermutationSet::GetPermutationDesc(ShaderPermutationKey key)const
+{
+    // Disabled keywords are defined too, so every variant has the same define
+    // names in the same order, and an #if on a misspelled keyword still fails.
+    ShaderCompileDesc desc = m_base;
+    for (size_t i = 0; i < m_keywords.size(); i++)
+    {
+        desc.Defines.push_back({ m_keywords[i], (key >> i) & 1 ? "1" : "0" });
+    }
+    return desc;
+}
+
+void ShaderPermutationSet::Compile(ShaderCache& cache, ThreadPool* pool, const std::vector<ShaderPermutationKey>& keys)
+{
+    std::vector<ShaderPermutationKey> batch = keys;
+    if (batch.empty())
+    {
+        for (UINT key = 0; key < GetPermutationCount(); key++)
+        {
+            batch.push_back(key);
+        }
+    }
+    for (ShaderPermutationKey key : batch)
+    {
+        if (key >= GetPermutationCount())
+        {
+            ThrowIfFailed(E_INVALIDARG);
+        }
+    }
+
+    // Each task writes its own slot, a key listed twice just hits the cache.
+    std::vector<ComPtr<ID3DBlob>> results(batch.size());
+    auto compile = [&](UINT i) { results[i] = cache.GetOrCompile(GetPermutationDesc(batch[i])); };
+    if (pool)
+    {
+        pool->ParallelFor(static_cast<UINT>(batch.size()), compile);
+    }
+    else
+    {
+        for (UINT i = 0; i < batch.size(); i++)
+        {
+            compile(i);
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        m_variants[batch[i]] = results[i];
+    }
+    ShareIdenticalVariants();
+
+    // Permutations can include different files, #if around an #include.
+    if (m_dependencies.empty())
+    {
+        m_dependencies.push_back(AnsiToWString(m_base.SourceName));
+    }
+    for (ShaderPermutationKey key : batch)
+    {
+        for (const std::string& include : cache.GetIncludes(GetPermutationDesc(key)))
+        {
+            const std::wstring name = AnsiToWString(include);
+            if (!DependsOn(name))
+            {
+                m_dependencies.push_back(name);
+            }
+        }
+    }
+}
+
+bool ShaderPermutationSet::DependsOn(const std::wstring& fileName)const
+{
+    if (fileName == L"*")
+    {
+        return true;
+    }
+    return std::any_of(m_dependencies.begin(), m_dependencies.end(), [&fileName](const std::wstring& dependency)
+    {
+        return _wcsicmp(dependency.c_str(), fileName.c_str()) == 0;
+    });
+}
+
+void ShaderPermutationSet::ShareIdenticalVariants()
+{
+    std::unordered_map<UINT64, std::vector<ID3DBlob*>> blobs;
+    m_uniqueCount = 0;
+    for (ComPtr<ID3DBlob>& variant : m_variants)
+    {
+        if (!variant)
+        {
+            continue;
+        }
+
+        // Compared in full, equal hashes alone are not proof.
+        const UINT64 hash = HashBytes(variant->GetBufferPointer(), variant->GetBufferSize());
+        std::vector<ID3DBlob*>& candidates = blobs[hash];
+        auto same = std::find_if(candidates.begin(), candidates.end(), [&variant](ID3DBlob* blob)
+        {
+            return blob->GetBufferSize() == variant->GetBufferSize() &&
+                memcmp(blob->GetBufferPointer(), variant->GetBufferPointer(), blob->GetBufferSize()) == 0;
+        });
+        if (same != candidates.end())
+        {
+            variant = *same;
+        }
+        else
+        {
+            candidates.push_back(variant.Get());
+            m_uniqueCount++;
+        }
+    }
+}
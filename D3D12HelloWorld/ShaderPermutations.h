@@ -0,0 +1,60 @@
+#pragma once
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+
+// Bit i set enables the i-th keyword of a permutation set.
+typedef UINT ShaderPermutationKey;
+
+// Feature keywords a shader source declares, in order, on lines like
+//     // keywords: GRAYSCALE ALPHA_TEST
+// Every permutation defines each keyword as 0 or 1, so shaders test them with #if.
+std::vector<std::string> ParseShaderKeywords(const ByteSpan& source);
+
+// All variants of one entry point over a set of keywords. Variants are
+// compiled through the shader cache as a parallel batch and looked up by key
+// in constant time. Variants that compile to identical bytecode, because the
+// entry point never reads a keyword, share one blob, which in turn lets them
+// share pipelines.
+class ShaderPermutationSet
+{
+public:
+    // Keeps the lookup table at 2^12 entries at most.
+    static const UINT MaxKeywords = 12;
+
+    // base.Source must stay valid while Compile runs.
+    ShaderPermutationSet(const ShaderCompileDesc& base, const std::vector<std::string>& keywords);
+
+    // 0 for keywords the set does not have, so asking for them selects nothing.
+    ShaderPermutationKey GetKeywordBit(const std::string& keyword)const;
+    const std::vector<std::string>& GetKeywords()const { return m_keywords; }
+    UINT GetPermutationCount()const { return static_cast<UINT>(m_variants.size()); }
+    ShaderCompileDesc GetPermutationDesc(ShaderPermutationKey key)const;
+
+    // Compiles keys, every permutation when empty, and returns once all are
+    // done. A null pool compiles on the calling thread. The first compile
+    // error is rethrown as HrException.
+    void Compile(ShaderCache& cache, ThreadPool* pool, const std::vector<ShaderPermutationKey>& keys = {});
+
+    // Null for permutations that were not compiled.
+    ID3DBlob* Get(ShaderPermutationKey key)const
+    {
+        return key < m_variants.size() ? m_variants[key].Get() : nullptr;
+    }
+
+    // Distinct blobs among the compiled permutations.
+    UINT GetUniqueCount()const { return m_uniqueCount; }
+
+    // Whether a change to the file, named relative to the asset directory,
+    // affects compiled permutations: the source itself or anything they
+    // included. "*" matches every set.
+    bool DependsOn(const std::wstring& fileName)const;
+
+private:
+    void ShareIdenticalVariants();
+
+    ShaderCompileDesc m_base;
+    std::vector<std::string> m_keywords;
+    std::vector<ComPtr<ID3DBlob>> m_variants;
+    UINT m_uniqueCount = 0;
+    std::vector<std::wstring> m_dependencies;
+};
@@ -0,0 +1,237 @@
+#include "stdafx.h"
+#include "ShaderReflection.h"
+
+static ComPtr<ID3D12ShaderReflection> ReflectShader(ID3DBlob* shader)
+{
+    ComPtr<ID3D12ShaderReflection> reflection;
+    ThrowIfFailed(D3DReflect(shader->GetBufferPointer(), shader->GetBufferSize(), IID_PPV_ARGS(&reflection)));
+    return reflection;
+}
+
+static UINT GetFormatComponentCount(DXGI_FORMAT format, D3D_REGISTER_COMPONENT_TYPE& type)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R32_FLOAT:             type = D3D_REGISTER_COMPONENT_FLOAT32; return 1;
+    case DXGI_FORMAT_R32G32_FLOAT:          type = D3D_REGISTER_COMPONENT_FLOAT32; return 2;
+    case DXGI_FORMAT_R32G32B32_FLOAT:       type = D3D_REGISTER_COMPONENT_FLOAT32; return 3;
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:    type = D3D_REGISTER_COMPONENT_FLOAT32; return 4;
+    case DXGI_FORMAT_R32_UINT:              type = D3D_REGISTER_COMPONENT_UINT32; return 1;
+    case DXGI_FORMAT_R32G32_UINT:           type = D3D_REGISTER_COMPONENT_UINT32; return 2;
+    case DXGI_FORMAT_R32G32B32_UINT:        type = D3D_REGISTER_COMPONENT_UINT32; return 3;
+    case DXGI_FORMAT_R32G32B32A32_UINT:     type = D3D_REGISTER_COMPONENT_UINT32; return 4;
+    default:                                type = D3D_REGISTER_COMPONENT_UNKNOWN; return 0;
+    }
+}
+
+static UINT CountBits(BYTE mask)
+{
+    UINT count = 0;
+    for (; mask; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+static void ThrowLayoutMismatch(const std::string& message)
+{
+    OutputDebugStringA(("Input layout mismatch: " + message + "\n").c_str());
+    ThrowIfFailed(E_INVALIDARG);
+}
+
+std::vector<D3D12_INPUT_ELEMENT_DESC> BuildInputLayout(ID3DBlob* vertexShader,
+    const VertexAttribute* attributes, UINT attributeCount, UINT inputSlot)
+{
+    ComPtr<ID3D12ShaderReflection> reflection = ReflectShader(vertexShader);
+    D3D12_SHADER_DESC shaderDesc;
+    ThrowIfFailed(reflection->GetDesc(&shaderDesc));
+
+    std::vector<D3D12_INPUT_ELEMENT_DESC> layout;
+    for (UINT i = 0; i < shaderDesc.InputParameters; i++)
+    {
+        D3D12_SIGNATURE_PARAMETER_DESC input;
+        ThrowIfFailed(reflection->GetInputParameterDesc(i, &input));
+        if (input.SystemValueType != D3D_NAME_UNDEFINED)
+        {
+            continue;
+        }
+
+        const std::string semantic = std::string(input.SemanticName) + std::to_string(input.SemanticIndex);
+        const VertexAttribute* attribute = std::find_if(attributes, attributes + attributeCount, [&input](const VertexAttribute& a)
+        {
+            return _stricmp(a.SemanticName, input.SemanticName) == 0 && a.SemanticIndex == input.SemanticIndex;
+        });
+        if (attribute == attributes + attributeCount)
+        {
+            ThrowLayoutMismatch("the shader reads " + semantic + ", the vertex has no such member");
+        }
+
+        D3D_REGISTER_COMPONENT_TYPE componentType;
+        const UINT componentCount = GetFormatComponentCount(attribute->Format, componentType);
+        if (componentType != input.ComponentType)
+        {
+            ThrowLayoutMismatch(semantic + " has a different component type in the shader");
+        }
+        if (CountBits(input.Mask) > componentCount)
+        {
+            ThrowLayoutMismatch("the shader reads more components of " + semantic + " than the vertex has");
+        }
+
+        layout.push_back({ attribute->SemanticName, attribute->SemanticIndex, attribute->Format, inputSlot,
+            attribute->Offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+    }
+    return layout;
+}
+
+static D3D12_SHADER_VISIBILITY GetVisibility(UINT version)
+{
+    switch (D3D12_SHVER_GET_TYPE(version))
+    {
+    case D3D12_SHVER_VERTEX_SHADER:     return D3D12_SHADER_VISIBILITY_VERTEX;
+    case D3D12_SHVER_HULL_SHADER:       return D3D12_SHADER_VISIBILITY_HULL;
+    case D3D12_SHVER_DOMAIN_SHADER:     return D3D12_SHADER_VISIBILITY_DOMAIN;
+    case D3D12_SHVER_GEOMETRY_SHADER:   return D3D12_SHADER_VISIBILITY_GEOMETRY;
+    case D3D12_SHVER_PIXEL_SHADER:      return D3D12_SHADER_VISIBILITY_PIXEL;
+    default:                            return D3D12_SHADER_VISIBILITY_ALL;
+    }
+}
+
+static D3D12_DESCRIPTOR_RANGE_TYPE GetRangeType(D3D_SHADER_INPUT_TYPE type)
+{
+    switch (type)
+    {
+    case D3D_SIT_CBUFFER:
+        return D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+    case D3D_SIT_SAMPLER:
+        return D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+    case D3D_SIT_UAV_RWTYPED:
+    case D3D_SIT_UAV_RWSTRUCTURED:
+    case D3D_SIT_UAV_RWBYTEADDRESS:
+    case D3D_SIT_UAV_APPEND_STRUCTURED:
+    case D3D_SIT_UAV_CONSUME_STRUCTURED:
+    case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+        return D3D12_DESCRIPTOR_RANGE_TYPE_UAV;
+    default:
+        return D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    }
+}
+
+void ShaderBindingLayout::AddShader(ID3DBlob* shader)
+{
+    ComPtr<ID3D12ShaderReflection> reflection = ReflectShader(shader);
+    D3D12_SHADER_DESC shaderDesc;
+    ThrowIfFailed(reflection->GetDesc(&shaderDesc));
+    const D3D12_SHADER_VISIBILITY visibility = GetVisibility(shaderDesc.Version);
+
+    for (UINT i = 0; i < shaderDesc.BoundResources; i++)
+    {
+        D3D12_SHADER_INPUT_BIND_DESC bind;
+        ThrowIfFailed(reflection->GetResourceBindingDesc(i, &bind));
+
+        Binding binding;
+        binding.Name = bind.Name;
+        binding.Type = GetRangeType(bind.Type);
+        binding.Register = bind.BindPoint;
+        binding.Space = bind.Space;
+        binding.Count = bind.BindCount ? bind.BindCount : UINT_MAX;     // 0 is an unbounded array.
+        binding.Visibility = visibility;
+
+        auto same = std::find_if(m_bindings.begin(), m_bindings.end(), [&binding](const Binding& b)
+        {
+            return b.Type == binding.Type && b.Register == binding.Register && b.Space == binding.Space;
+        });
+        if (same == m_bindings.end())
+        {
+            m_bindings.push_back(binding);
+        }
+        else if (same->Visibility != visibility)
+        {
+            same->Visibility = D3D12_SHADER_VISIBILITY_ALL;
+        }
+    }
+
+    // Samplers last, the rest by the order of the range type enum.
+    std::sort(m_bindings.begin(), m_bindings.end(), [](const Binding& a, const Binding& b)
+    {
+        const bool aSampler = a.Type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+        const bool bSampler = b.Type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER;
+        if (aSampler != bSampler)
+        {
+            return bSampler;
+        }
+        if (a.Type != b.Type)
+        {
+            return a.Type < b.Type;
+        }
+        return a.Space != b.Space ? a.Space < b.Space : a.Register < b.Register;
+    });
+}
+
+D3D12_VERSIONED_ROOT_SIGNATURE_DESC ShaderBindingLayout::GetRootSignatureDesc(D3D12_ROOT_SIGNATURE_FLAGS flags)
+{
+    m_ranges.clear();
+    m_parameters.clear();
+    m_ranges.reserve(m_bindings.size());
+
+    size_t tableStart = 0;
+    for (size_t i = 0; i <= m_bindings.size(); i++)
+    {
+        const bool endOfTable = i == m_bindings.size() ||
+            (i > tableStart && (m_bindings[i].Type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER) !=
+                (m_bindings[tableStart].Type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER));
+        if (endOfTable && i > tableStart)
+        {
+            D3D12_SHADER_VISIBILITY visibility = m_bindings[tableStart].Visibility;
+            for (size_t j = tableStart; j < i; j++)
+            {
+                if (m_bindings[j].Visibility != visibility)
+                {
+                    visibility = D3D12_SHADER_VISIBILITY_ALL;
+                }
+            }
+
+            CD3DX12_ROOT_PARAMETER parameter;
+            parameter.InitAsDescriptorTable(static_cast<UINT>(i - tableStart), m_ranges.data() + tableStart, visibility);
+            m_parameters.push_back(parameter);
+            tableStart = i;
+        }
+        if (i < m_bindings.size())
+        {
+            const Binding& binding = m_bindings[i];
+            m_ranges.push_back(CD3DX12_DESCRIPTOR_RANGE(binding.Type, binding.Count, binding.Register, binding.Space));
+        }
+    }
+
+    CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC desc;
+    desc.Init_1_0(static_cast<UINT>(m_parameters.size()), m_parameters.data(), 0, nullptr, flags);
+    return desc;
+}
+
+bool ShaderBindingLayout::FindBinding(const std::string& name, UINT& rootParameterIndex, UINT& tableOffset)const
+{
+    rootParameterIndex = 0;
+    tableOffset = 0;
+    bool unbounded = false;
+    for (size_t i = 0; i < m_bindings.size(); i++)
+    {
+        if (i > 0 && (m_bindings[i].Type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER) !=
+            (m_bindings[i - 1].Type == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER))
+        {
+            rootParameterIndex++;
+            tableOffset = 0;
+            unbounded = false;
+        }
+        if (m_bindings[i].Name == name)
+        {
+            // Ranges after an unbounded array in the same table have no fixed offset.
+            return !unbounded;
+        }
+        unbounded = unbounded || m_bindings[i].Count == UINT_MAX;
+        if (!unbounded)
+        {
+            tableOffset += m_bindings[i].Count;
+        }
+    }
+    return false;
+}
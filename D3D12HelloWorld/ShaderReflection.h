@@ -0,0 +1,96 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include <d3d12shader.h>
+
+// Format the input assembler reads a vertex member type as. Member types
+// without a specialization do not compile as vertex attributes.
+template<class T> struct VertexAttributeFormat;
+template<> struct VertexAttributeFormat<float> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32_FLOAT; };
+template<> struct VertexAttributeFormat<DirectX::XMFLOAT2> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32G32_FLOAT; };
+template<> struct VertexAttributeFormat<DirectX::XMFLOAT3> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32G32B32_FLOAT; };
+template<> struct VertexAttributeFormat<DirectX::XMFLOAT4> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32G32B32A32_FLOAT; };
+template<> struct VertexAttributeFormat<UINT> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32_UINT; };
+template<> struct VertexAttributeFormat<DirectX::XMUINT2> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32G32_UINT; };
+template<> struct VertexAttributeFormat<DirectX::XMUINT3> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32G32B32_UINT; };
+template<> struct VertexAttributeFormat<DirectX::XMUINT4> { static constexpr DXGI_FORMAT Value = DXGI_FORMAT_R32G32B32A32_UINT; };
+
+// One member of a C++ vertex struct and the semantic it feeds.
+struct VertexAttribute
+{
+    LPCSTR SemanticName;
+    UINT SemanticIndex;
+    DXGI_FORMAT Format;
+    UINT Offset;
+    UINT Size;
+};
+
+// Format, offset and size come from the member itself, so they can not drift
+// from the struct.
+#define VERTEX_ATTRIBUTE(vertexType, member, semanticName, semanticIndex) \
+    VertexAttribute{ semanticName, semanticIndex, VertexAttributeFormat<decltype(vertexType::member)>::Value, \
+        static_cast<UINT>(offsetof(vertexType, member)), static_cast<UINT>(sizeof(vertexType::member)) }
+
+// For a static_assert next to the struct: attributes in member order, no
+// member left out and no padding between them.
+template<size_t N>
+constexpr bool IsTightlyPacked(const VertexAttribute(&attributes)[N], size_t vertexSize)
+{
+    size_t end = 0;
+    for (size_t i = 0; i < N; i++)
+    {
+        if (attributes[i].Offset != end)
+        {
+            return false;
+        }
+        end += attributes[i].Size;
+    }
+    return end == vertexSize;
+}
+
+// Input layout for what the vertex shader's input signature reads, formats
+// and offsets taken from the attributes. System values are skipped. Throws
+// HrException with E_INVALIDARG, and says why in the debugger output, when
+// the shader reads a semantic the vertex lacks or reads it as another
+// component type or with more components than the attribute has.
+std::vector<D3D12_INPUT_ELEMENT_DESC> BuildInputLayout(ID3DBlob* vertexShader,
+    const VertexAttribute* attributes, UINT attributeCount, UINT inputSlot = 0);
+
+template<size_t N>
+std::vector<D3D12_INPUT_ELEMENT_DESC> BuildInputLayout(ID3DBlob* vertexShader, const VertexAttribute(&attributes)[N], UINT inputSlot = 0)
+{
+    return BuildInputLayout(vertexShader, attributes, static_cast<UINT>(N), inputSlot);
+}
+
+// Resource bindings of a set of shaders, merged into a root signature with
+// one descriptor table holding every CBV, SRV and UAV, followed by one with
+// the samplers. Bindings are ordered by type, space and register, so the
+// same shaders always give the same root signature.
+class ShaderBindingLayout
+{
+public:
+    // Bindings used by several stages become visible to all of them.
+    void AddShader(ID3DBlob* shader);
+
+    // Points into the layout, valid until it changes or goes away.
+    D3D12_VERSIONED_ROOT_SIGNATURE_DESC GetRootSignatureDesc(D3D12_ROOT_SIGNATURE_FLAGS flags);
+
+    // Root parameter of the table holding the named binding and its
+    // descriptor offset in that table. False if no shader binds it, or if it
+    // follows an unbounded array in its table.
+    bool FindBinding(const std::string& name, UINT& rootParameterIndex, UINT& tableOffset)const;
+
+private:
+    struct Binding
+    {
+        std::string Name;
+        D3D12_DESCRIPTOR_RANGE_TYPE Type;
+        UINT Register;
+        UINT Space;
+        UINT Count;
+        D3D12_SHADER_VISIBILITY Visibility;
+    };
+
+    std::vector<Binding> m_bindings;
+    std::vector<D3D12_DESCRIPTOR_RANGE> m_ranges;
+    std::vector<D3D12_ROOT_PARAMETER> m_parameters;
+};
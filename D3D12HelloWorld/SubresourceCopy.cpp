@@ -0,0 +1,196 @@
+#include "stdafx.h"
+#include "SubresourceCopy.h"
+#if defined(_M_IX86) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Below this a plain memcpy is cheaper than the fence.
+static const size_t MinStreamingCopySize = 256;
+
+// Uploads are split into bands of about this many bytes across the pool,
+// uploads smaller than ParallelCopyThreshold are not split at all.
+static const UINT64 CopyBandSize = 1024 * 1024;
+static const UINT64 ParallelCopyThreshold = 4 * 1024 * 1024;
+
+void StreamingCopy(void* destination, const void* source, size_t byteSize)
+{
+#if defined(_M_IX86) || defined(_M_X64)
+    if (byteSize < MinStreamingCopySize)
+    {
+        memcpy(destination, source, byteSize);
+        return;
+    }
+
+    BYTE* dst = static_cast<BYTE*>(destination);
+    const BYTE* src = static_cast<const BYTE*>(source);
+
+    // Streaming stores need an aligned destination, the source may be anywhere.
+    const size_t head = (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    byteSize -= head;
+
+    for (; byteSize >= 64; byteSize -= 64, dst += 64, src += 64)
+    {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+    }
+    memcpy(dst, src, byteSize);
+
+    // Make the streamed data visible before the buffer is unmapped.
+    _mm_sfence();
+#else
+    memcpy(destination, source, byteSize);
+#endif
+}
+
+void CopySubresource(
+    const D3D12_MEMCPY_DEST* dest,
+    const D3D12_SUBRESOURCE_DATA* src,
+    SIZE_T rowSizeInBytes,
+    UINT numRows,
+    UINT numSlices)
+{
+    const bool contiguousRows = dest->RowPitch == rowSizeInBytes && static_cast<SIZE_T>(src->RowPitch) == rowSizeInBytes;
+    const SIZE_T sliceSize = rowSizeInBytes * numRows;
+
+    if (contiguousRows && dest->SlicePitch == sliceSize && static_cast<SIZE_T>(src->SlicePitch) == sliceSize)
+    {
+        StreamingCopy(dest->pData, src->pData, sliceSize * numSlices);
+        return;
+    }
+
+    for (UINT z = 0; z < numSlices; ++z)
+    {
+        BYTE* pDestSlice = reinterpret_cast<BYTE*>(dest->pData) + dest->SlicePitch * z;
+        const BYTE* pSrcSlice = reinterpret_cast<const BYTE*>(src->pData) + src->SlicePitch * z;
+        if (contiguousRows)
+        {
+            StreamingCopy(pDestSlice, pSrcSlice, sliceSize);
+            continue;
+        }
+        for (UINT y = 0; y < numRows; ++y)
+        {
+            StreamingCopy(pDestSlice + dest->RowPitch * y, pSrcSlice + src->RowPitch * y, rowSizeInBytes);
+        }
+    }
+}
+
+UINT64 UpdateSubresourcesParallel(
+    ID3D12GraphicsCommandList* cmdList,
+    ID3D12Resource* destinationResource,
+    ID3D12Resource* intermediate,
+    UINT64 intermediateOffset,
+    UINT firstSubresource,
+    UINT numSubresources,
+    const D3D12_SUBRESOURCE_DATA* srcData,
+    ThreadPool* pool)
+{
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(numSubresources);
+    std::vector<UINT> numRows(numSubresources);
+    std::vector<UINT64> rowSizesInBytes(numSubresources);
+    UINT64 requiredSize = 0;
+
+    const D3D12_RESOURCE_DESC desc = destinationResource->GetDesc();
+    ComPtr<ID3D12Device> device;
+    destinationResource->GetDevice(IID_PPV_ARGS(&device));
+    device->GetCopyableFootprints(&desc, firstSubresource, numSubresources, intermediateOffset,
+        layouts.data(), numRows.data(), rowSizesInBytes.data(), &requiredSize);
+
+    // Same validation as UpdateSubresources.
+    const D3D12_RESOURCE_DESC intermediateDesc = intermediate->GetDesc();
+    if (intermediateDesc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER ||
+        intermediateDesc.Width < requiredSize + layouts[0].Offset ||
+        requiredSize > SIZE_T(-1) ||
+        (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER &&
+        (firstSubresource != 0 || numSubresources != 1)))
+    {
+        return 0;
+    }
+
+    // Split every slice of every subresource into bands of whole rows.
+    struct CopyBand
+    {
+        UINT Subresource;
+        UINT Slice;
+        UINT FirstRow;
+        UINT NumRows;
+    };
+    std::vector<CopyBand> bands;
+    for (UINT i = 0; i < numSubresources; ++i)
+    {
+        if (rowSizesInBytes[i] > SIZE_T(-1))
+        {
+            return 0;
+        }
+        const UINT rowsPerBand = static_cast<UINT>(std::max<UINT64>(1, CopyBandSize / std::max<UINT64>(1, rowSizesInBytes[i])));
+        for (UINT z = 0; z < layouts[i].Footprint.Depth; ++z)
+        {
+            for (UINT y = 0; y < numRows[i]; y += rowsPerBand)
+            {
+                bands.push_back({ i, z, y, std::min(rowsPerBand, numRows[i] - y) });
+            }
+        }
+    }
+
+    BYTE* pData;
+    if (FAILED(intermediate->Map(0, nullptr, reinterpret_cast<void**>(&pData))))
+    {
+        return 0;
+    }
+
+    auto copyBand = [&](UINT b)
+    {
+        const CopyBand& band = bands[b];
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = layouts[band.Subresource];
+        const D3D12_SUBRESOURCE_DATA& src = srcData[band.Subresource];
+        const SIZE_T destRowPitch = layout.Footprint.RowPitch;
+        const SIZE_T destSlicePitch = destRowPitch * numRows[band.Subresource];
+
+        D3D12_MEMCPY_DEST dest = {
+            pData + layout.Offset + destSlicePitch * band.Slice + destRowPitch * band.FirstRow,
+            destRowPitch,
+            destSlicePitch };
+        D3D12_SUBRESOURCE_DATA source = {
+            static_cast<const BYTE*>(src.pData) + src.SlicePitch * band.Slice + src.RowPitch * band.FirstRow,
+            src.RowPitch,
+            src.SlicePitch };
+        CopySubresource(&dest, &source, static_cast<SIZE_T>(rowSizesInBytes[band.Subresource]), band.NumRows, 1);
+    };
+
+    if (pool && requiredSize >= ParallelCopyThreshold)
+    {
+        pool->ParallelFor(static_cast<UINT>(bands.size()), copyBand);
+    }
+    else
+    {
+        for (UINT b = 0; b < bands.size(); ++b)
+        {
+            copyBand(b);
+        }
+    }
+    intermediate->Unmap(0, nullptr);
+
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        cmdList->CopyBufferRegion(
+            destinationResource, 0, intermediate, layouts[0].Offset, layouts[0].Footprint.Width);
+    }
+    else
+    {
+        for (UINT i = 0; i < numSubresources; ++i)
+        {
+            CD3DX12_TEXTURE_COPY_LOCATION dst(destinationResource, i + firstSubresource);
+            CD3DX12_TEXTURE_COPY_LOCATION src(intermediate, layouts[i]);
+            cmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        }
+    }
+    return requiredSize;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include "ThreadPool.h"
+
+// Copies into mapped upload heap memory. That memory is write-combined, so it
+// should be written sequentially in large blocks and never read back.
+
+// memcpy with non-temporal stores, the destination does not pollute the cache.
+void StreamingCopy(void* destination, const void* source, size_t byteSize);
+
+// Replacement for MemcpySubresource from d3dx12.h. Rows that are contiguous
+// on both sides are copied in one go instead of row by row.
+void CopySubresource(
+    const D3D12_MEMCPY_DEST* dest,
+    const D3D12_SUBRESOURCE_DATA* src,
+    SIZE_T rowSizeInBytes,
+    UINT numRows,
+    UINT numSlices
+);
+
+// Replacement for the heap allocating UpdateSubresources from d3dx12.h.
+// Large uploads are split into bands of rows and copied on the pool.
+// Returns the required intermediate size, or 0 on failure like the original.
+UINT64 UpdateSubresourcesParallel(
+    ID3D12GraphicsCommandList* cmdList,
+    ID3D12Resource* destinationResource,
+    ID3D12Resource* intermediate,
+    UINT64 intermediateOffset,
+    UINT firstSubresource,
+    UINT numSubresources,
+    const D3D12_SUBRESOURCE_DATA* srcData,
+    ThreadPool* pool = nullptr
+);
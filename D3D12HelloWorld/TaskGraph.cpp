@@ -0,0 +1,196 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#endif
+#include "TaskGraph.h"
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <sstream>
+
+// Shared with the pool tasks, which may only get to run after Run returned.
+// By then the ready queue is empty and they return without touching Tasks.
+struct TaskGraph::RunState
+{
+    std::vector<Task>* Tasks;
+    ThreadPool* Pool;
+    std::chrono::steady_clock::time_point Start;
+
+    std::vector<uint32_t> Remaining;
+    std::deque<TaskGraphNode> Ready;
+    uint32_t Done = 0;
+    std::exception_ptr Error;
+    std::mutex Lock;
+    std::condition_variable Progress;
+};
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+TaskGraphNode TaskGraph::Add(const wchar_t* name, std::function<void()> work, std::initializer_list<TaskGraphNode> dependencies)
+{
+    const TaskGraphNode node = static_cast<TaskGraphNode>(m_tasks.size());
+    for (TaskGraphNode dependency : dependencies)
+    {
+        assert(dependency < node);
+        m_tasks[dependency].Dependents.push_back(node);
+    }
+
+    Task task;
+    task.Name = name;
+    task.Work = std::move(work);
+    task.DependencyCount = static_cast<uint32_t>(dependencies.size());
+    m_tasks.push_back(std::move(task));
+    return node;
+}
+
+void TaskGraph::Run(ThreadPool* pool)
+{
+    std::shared_ptr<RunState> state = std::make_shared<RunState>();
+    state->Tasks = &m_tasks;
+    state->Pool = pool;
+    state->Start = std::chrono::steady_clock::now();
+    for (TaskGraphNode node = 0; node < m_tasks.size(); node++)
+    {
+        state->Remaining.push_back(m_tasks[node].DependencyCount);
+    }
+
+    if (!pool)
+    {
+        // Insertion order already respects the dependencies.
+        for (TaskGraphNode node = 0; node < m_tasks.size(); node++)
+        {
+            Execute(state, node);
+        }
+    }
+    else
+    {
+        for (TaskGraphNode node = 0; node < m_tasks.size(); node++)
+        {
+            if (m_tasks[node].DependencyCount == 0)
+            {
+                state->Ready.push_back(node);
+            }
+        }
+
+        // The calling thread takes one of the roots itself.
+        const size_t rootCount = state->Ready.size();
+        for (size_t i = 1; i < rootCount; i++)
+        {
+            pool->Submit([state]() { ExecuteReady(state); });
+        }
+
+        // Help out instead of just waiting, so a graph run from a pool task can not starve.
+        std::unique_lock<std::mutex> lock(state->Lock);
+        while (state->Done < m_tasks.size())
+        {
+            if (state->Ready.empty())
+            {
+                state->Progress.wait(lock);
+                continue;
+            }
+
+            const TaskGraphNode node = state->Ready.front();
+            state->Ready.pop_front();
+            lock.unlock();
+            Execute(state, node);
+            lock.lock();
+        }
+    }
+
+    m_elapsedMilliseconds = MillisecondsSince(state->Start);
+
+    // Taken out of the state, which a late pool task may end up destroying.
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(state->Lock);
+        std::swap(error, state->Error);
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGraph::ExecuteReady(const std::shared_ptr<RunState>& state)
+{
+    TaskGraphNode node;
+    {
+        std::lock_guard<std::mutex> lock(state->Lock);
+        if (state->Ready.empty())
+        {
+            // The calling thread got to it first.
+            return;
+        }
+        node = state->Ready.front();
+        state->Ready.pop_front();
+    }
+    Execute(state, node);
+}
+
+void TaskGraph::Execute(const std::shared_ptr<RunState>& state, TaskGraphNode node)
+{
+    Task& task = (*state->Tasks)[node];
+    bool skip;
+    {
+        std::lock_guard<std::mutex> lock(state->Lock);
+        skip = static_cast<bool>(state->Error);
+    }
+
+    const double start = MillisecondsSince(state->Start);
+    std::exception_ptr error;
+    if (!skip)
+    {
+        try
+        {
+            task.Work();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+    const double end = MillisecondsSince(state->Start);
+
+    uint32_t readyCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(state->Lock);
+        task.StartMilliseconds = start;
+        task.DurationMilliseconds = end - start;
+        if (error && !state->Error)
+        {
+            state->Error = error;
+        }
+        for (TaskGraphNode dependent : task.Dependents)
+        {
+            if (--state->Remaining[dependent] == 0 && state->Pool)
+            {
+                state->Ready.push_back(dependent);
+                readyCount++;
+            }
+        }
+        state->Done++;
+    }
+    state->Progress.notify_all();
+
+    for (uint32_t i = 0; i < readyCount; i++)
+    {
+        state->Pool->Submit([state]() { ExecuteReady(state); });
+    }
+}
+
+std::wstring TaskGraph::GetTimingReport()const
+{
+    std::wstringstream report;
+    report.precision(2);
+    report << std::fixed;
+    double totalMilliseconds = 0.0;
+    for (const Task& task : m_tasks)
+    {
+        report << L"  " << task.Name << L": start " << task.StartMilliseconds << L" ms, took " << task.DurationMilliseconds << L" ms\n";
+        totalMilliseconds += task.DurationMilliseconds;
+    }
+    report << L"  " << m_elapsedMilliseconds << L" ms elapsed for " << totalMilliseconds << L" ms of work\n";
+    return report.str();
+}
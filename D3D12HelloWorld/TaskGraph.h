@@ -0,0 +1,43 @@
+#pragma once
+#include "ThreadPool.h"
+#include <string>
+
+typedef uint32_t TaskGraphNode;
+
+// One-shot dependency graph of work items, used for initialization stages.
+// A task starts as soon as all tasks it depends on have finished, so
+// independent stages run concurrently on the pool and the calling thread.
+class TaskGraph
+{
+public:
+    // Dependencies must have been added before, which rules out cycles.
+    TaskGraphNode Add(const wchar_t* name, std::function<void()> work, std::initializer_list<TaskGraphNode> dependencies = {});
+
+    // Returns once every task ran. Without a pool tasks run one after the
+    // other in the order they were added, handy to compare timings. The first
+    // exception thrown by a task is rethrown here, tasks that had not
+    // started by then are skipped.
+    void Run(ThreadPool* pool);
+
+    // Start and duration of every task in the last Run, one line each.
+    std::wstring GetTimingReport()const;
+    double GetElapsedMilliseconds()const { return m_elapsedMilliseconds; }
+
+private:
+    struct Task
+    {
+        std::wstring Name;
+        std::function<void()> Work;
+        std::vector<TaskGraphNode> Dependents;
+        uint32_t DependencyCount = 0;
+        double StartMilliseconds = 0.0;
+        double DurationMilliseconds = 0.0;
+    };
+
+    struct RunState;
+    static void Execute(const std::shared_ptr<RunState>& state, TaskGraphNode node);
+    static void ExecuteReady(const std::shared_ptr<RunState>& state);
+
+    std::vector<Task> m_tasks;
+    double m_elapsedMilliseconds = 0.0;
+};
@@ -0,0 +1,140 @@
+#include "stdafx.h"
+#include "TextureStreamer.h"
+
+TextureStreamer::TextureStreamer(ID3D12Device* device, UploadEngine* uploadEngine, UINT64 bytesPerFrame) :
+    m_device(device),
+    m_uploadEngine(uploadEngine),
+    m_bytesPerFrame(bytesPerFrame)
+{
+}
+
+StreamedTextureId TextureStreamer::Add(ID3D12Resource* texture, std::vector<TextureMipData> mips, D3D12_CPU_DESCRIPTOR_HANDLE srvHandle)
+{
+    StreamedTexture streamed;
+    streamed.Texture = texture;
+    streamed.Desc = texture->GetDesc();
+    streamed.Srv = srvHandle;
+    if (streamed.Desc.Dimension != D3D12_RESOURCE_DIMENSION_TEXTURE2D ||
+        streamed.Desc.DepthOrArraySize != 1 ||
+        streamed.Desc.MipLevels != mips.size())
+    {
+        ThrowIfFailed(E_INVALIDARG);
+    }
+    streamed.Mips = std::move(mips);
+    streamed.MipTickets.resize(streamed.Mips.size());
+    streamed.UnissuedMips = streamed.Desc.MipLevels;
+    streamed.NextRow = 0;
+    streamed.ResidentMip = streamed.Desc.MipLevels;
+
+    m_textures.push_back(std::move(streamed));
+    return static_cast<StreamedTextureId>(m_textures.size() - 1);
+}
+
+// Issue bands of the texture until it is done or the budget is spent.
+// Returns false when the budget ran out.
+bool TextureStreamer::IssueUploads(StreamedTexture& texture, UINT64& budget)
+{
+    while (texture.UnissuedMips > 0)
+    {
+        const UINT mip = texture.UnissuedMips - 1;
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+        UINT numRows;
+        UINT64 rowSize;
+        m_device->GetCopyableFootprints(&texture.Desc, mip, 1, 0, &layout, &numRows, &rowSize, nullptr);
+
+        const TextureMipData& data = texture.Mips[mip];
+        const UINT rowBytes = layout.Footprint.RowPitch;
+        const UINT bandRows = static_cast<UINT>(std::max<UINT64>(1, (budget < MaxBandBytes ? budget : MaxBandBytes) / rowBytes));
+        const UINT rows = std::min(bandRows, numRows - texture.NextRow);
+
+        // Always let one band through so a tiny budget still makes progress.
+        const UINT64 bandBytes = UINT64(rows) * rowBytes;
+        if (bandBytes > budget && budget != m_bytesPerFrame)
+        {
+            return false;
+        }
+        budget -= std::min(budget, bandBytes);
+
+        D3D12_SUBRESOURCE_DATA rowData = {};
+        rowData.pData = data.Pixels.data() + SIZE_T(data.RowPitch) * texture.NextRow;
+        rowData.RowPitch = data.RowPitch;
+        texture.MipTickets[mip] = m_uploadEngine->EnqueueTextureRowsUpload(texture.Texture.Get(), mip, texture.NextRow, rows, rowData);
+
+        texture.NextRow += rows;
+        if (texture.NextRow == numRows)
+        {
+            texture.UnissuedMips--;
+            texture.NextRow = 0;
+        }
+        if (budget == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextureStreamer::Update()
+{
+    UINT64 budget = m_bytesPerFrame;
+    bool issued = false;
+    for (StreamedTexture& texture : m_textures)
+    {
+        if (texture.UnissuedMips == 0)
+        {
+            continue;
+        }
+        issued = true;
+        if (!IssueUploads(texture, budget))
+        {
+            break;
+        }
+    }
+    if (issued)
+    {
+        m_uploadEngine->Flush();
+    }
+
+    // Swap in every finer mip that has fully landed.
+    for (StreamedTexture& texture : m_textures)
+    {
+        const UINT residentMip = texture.ResidentMip;
+        while (texture.ResidentMip > 0 &&
+            texture.ResidentMip - 1 >= texture.UnissuedMips &&
+            m_uploadEngine->IsComplete(texture.MipTickets[texture.ResidentMip - 1]))
+        {
+            texture.ResidentMip--;
+            std::vector<UINT8>().swap(texture.Mips[texture.ResidentMip].Pixels);
+        }
+        if (texture.ResidentMip != residentMip)
+        {
+            CreateView(texture);
+        }
+    }
+}
+
+void TextureStreamer::CreateView(const StreamedTexture& texture)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.Format = texture.Desc.Format;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MostDetailedMip = texture.ResidentMip;
+    srvDesc.Texture2D.MipLevels = texture.Desc.MipLevels - texture.ResidentMip;
+    m_device->CreateShaderResourceView(texture.Texture.Get(), &srvDesc, texture.Srv);
+}
+
+bool TextureStreamer::IsResident(StreamedTextureId id)const
+{
+    return m_textures[id].ResidentMip < m_textures[id].Desc.MipLevels;
+}
+
+bool TextureStreamer::IsComplete(StreamedTextureId id)const
+{
+    return m_textures[id].ResidentMip == 0;
+}
+
+UINT TextureStreamer::GetResidentMip(StreamedTextureId id)const
+{
+    return m_textures[id].ResidentMip;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "UploadEngine.h"
+
+// CPU copy of one mip level, rows back to back RowPitch bytes apart.
+struct TextureMipData
+{
+    std::vector<UINT8> Pixels;
+    UINT RowPitch = 0;
+};
+
+typedef UINT StreamedTextureId;
+
+// Streams textures in over several frames without exceeding a per frame
+// upload budget. Mips go up smallest first, large mips in bands of rows, and
+// the shader resource view is widened to each finer mip once it has landed.
+// The view only ever covers resident mips, so the graphics queue never touches
+// subresources the copy queue is still writing.
+class TextureStreamer
+{
+public:
+    static const UINT64 DefaultBytesPerFrame = 4 * 1024 * 1024;
+
+    TextureStreamer(ID3D12Device* device, UploadEngine* uploadEngine, UINT64 bytesPerFrame = DefaultBytesPerFrame);
+
+    TextureStreamer(const TextureStreamer& rhs) = delete;
+    TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+
+    // texture must be a 2D texture in the COMMON state with one mip level per
+    // entry of mips. The streamer writes the view for it into srvHandle.
+    StreamedTextureId Add(ID3D12Resource* texture, std::vector<TextureMipData> mips, D3D12_CPU_DESCRIPTOR_HANDLE srvHandle);
+
+    // Call once per frame while the GPU does not read the views, e.g. right
+    // after waiting for the previous frame. Issues this frame's uploads and
+    // swaps in mips that have landed.
+    void Update();
+
+    // True once the texture has at least one resident mip and may be sampled.
+    bool IsResident(StreamedTextureId id)const;
+    bool IsComplete(StreamedTextureId id)const;
+    UINT GetResidentMip(StreamedTextureId id)const;
+
+    void SetBytesPerFrame(UINT64 bytesPerFrame) { m_bytesPerFrame = bytesPerFrame; }
+    UINT64 GetBytesPerFrame()const { return m_bytesPerFrame; }
+
+private:
+    // Rows of large mips are split into bands of about this size.
+    static const UINT64 MaxBandBytes = 256 * 1024;
+
+    struct StreamedTexture
+    {
+        ComPtr<ID3D12Resource> Texture;
+        D3D12_RESOURCE_DESC Desc;
+        D3D12_CPU_DESCRIPTOR_HANDLE Srv;
+        std::vector<TextureMipData> Mips;
+
+        // Ticket of the last band of every mip.
+        std::vector<UploadTicket> MipTickets;
+
+        // Mips at or above UnissuedMips are fully issued, NextRow is the next
+        // band of mip UnissuedMips - 1.
+        UINT UnissuedMips;
+        UINT NextRow;
+
+        // Finest mip that landed, MipLevels while none has.
+        UINT ResidentMip;
+    };
+
+    bool IssueUploads(StreamedTexture& texture, UINT64& budget);
+    void CreateView(const StreamedTexture& texture);
+
+    ID3D12Device* m_device;
+    UploadEngine* m_uploadEngine;
+    UINT64 m_bytesPerFrame;
+    std::vector<StreamedTexture> m_textures;
+};
@@ -0,0 +1,134 @@
+#ifdef _WIN32
+#include "stdafx.h"
+#endif
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; i++)
+    {
+        m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+
+    // Workers drain the queue before they exit.
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task, int priority)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        Task entry;
+        entry.Priority = priority;
+        entry.Sequence = m_nextSequence++;
+        entry.Function = std::move(task);
+        m_tasks.push(std::move(entry));
+    }
+    m_taskAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body, int priority)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Shared with the helper tasks, which may only start after this returned.
+    // They touch body only for indices they claimed, and those are waited for.
+    struct State
+    {
+        std::atomic<uint32_t> Next;
+        uint32_t Count;
+        uint32_t Done = 0;
+        const std::function<void(uint32_t)>* Body;
+        std::exception_ptr Error;
+        std::mutex Lock;
+        std::condition_variable Finished;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->Next = 0;
+    state->Count = count;
+    state->Body = &body;
+
+    auto run = [state]()
+    {
+        for (uint32_t i = state->Next++; i < state->Count; i = state->Next++)
+        {
+            std::exception_ptr error;
+            try
+            {
+                (*state->Body)(i);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state->Lock);
+            if (error && !state->Error)
+            {
+                state->Error = error;
+            }
+            if (++state->Done == state->Count)
+            {
+                state->Finished.notify_all();
+            }
+        }
+    };
+
+    const uint32_t helpers = std::min(GetThreadCount(), count - 1);
+    for (uint32_t i = 0; i < helpers; i++)
+    {
+        Submit(run, priority);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->Lock);
+    state->Finished.wait(lock, [&state] { return state->Done == state->Count; });
+    if (state->Error)
+    {
+        std::rethrow_exception(state->Error);
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_taskAvailable.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty())
+            {
+                return;
+            }
+
+            // priority_queue::top is const, the task is moved out before pop.
+            task = std::move(const_cast<Task&>(m_tasks.top()).Function);
+            m_tasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing tasks by priority.
+// Higher priorities run first, tasks of equal priority run in submission order.
+class ThreadPool
+{
+public:
+    // threadCount 0 uses one thread per hardware thread but the calling one.
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& rhs) = delete;
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+    void Submit(std::function<void()> task, int priority = 0);
+
+    // Run body(0) .. body(count - 1) on the workers and the calling thread and
+    // return once all are done. The first exception thrown by body is rethrown here.
+    // Safe to call from a task of another pool, the caller never just waits.
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& body, int priority = 0);
+
+    uint32_t GetThreadCount()const { return static_cast<uint32_t>(m_threads.size()); }
+
+private:
+    struct Task
+    {
+        int Priority;
+        uint64_t Sequence;
+        std::function<void()> Function;
+    };
+
+    struct TaskOrder
+    {
+        bool operator()(const Task& a, const Task& b)const
+        {
+            if (a.Priority != b.Priority)
+            {
+                return a.Priority < b.Priority;
+            }
+            return a.Sequence > b.Sequence;
+        }
+    };
+
+    void WorkerLoop();
+
+    std::vector<std::thread> m_threads;
+    std::priority_queue<Task, std::vector<Task>, TaskOrder> m_tasks;
+    uint64_t m_nextSequence = 0;
+    bool m_stopping = false;
+
+    std::mutex m_lock;
+    std::condition_variable m_taskAvailable;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "stdafx.h"
 #include "DXSampleHelper.h"
+#include "GpuMemoryTracker.h"
 
 template<typename T>
 class UploadBuffer
@@ -23,6 +24,9 @@ public:
             nullptr,
             IID_PPV_ARGS(&mUploadBuffer)
         ));
+        GpuMemoryTracker::TrackResource(mUploadBuffer.Get(), GpuMemoryCategory::Upload,
+            isConstantBuffer ? L"ConstantBuffer" : L"UploadBuffer");
+
         //	However,we must	not	write to the resource while	it is in use by			
         //	the	GPU	(so	we must use synchronization techniques).
         CD3DX12_RANGE readRange(0, 0);
@@ -0,0 +1,298 @@
+#include "stdafx.h"
+#include "UploadEngine.h"
+#include "GpuMemoryTracker.h"
+#include "SubresourceCopy.h"
+
+UploadEngine::UploadEngine(ID3D12Device* device, ThreadPool* copyWorkers) :
+    m_device(device),
+    m_copyWorkers(copyWorkers),
+    m_fenceSource(m_fence),
+    m_commandListPool(device, D3D12_COMMAND_LIST_TYPE_COPY, m_fenceSource)
+{
+    D3D12_COMMAND_QUEUE_DESC queueDesc = {};
+    queueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+    queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    ThrowIfFailed(m_device->CreateCommandQueue(&queueDesc, IID_PPV_ARGS(&m_copyQueue)));
+    NAME_D3D12_OBJECT(m_copyQueue);
+
+    ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+    m_fenceEvent = CreateEvent(nullptr, false, false, nullptr);
+    if (m_fenceEvent == nullptr)
+    {
+        ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+    }
+}
+
+UploadEngine::~UploadEngine()
+{
+    // Staging buffers and destinations must outlive the copies.
+    UploadTicket ticket;
+    ticket.FenceValue = Flush();
+    if (ticket.IsValid())
+    {
+        WaitOnCpu(ticket);
+    }
+    CloseHandle(m_fenceEvent);
+}
+
+ComPtr<ID3D12Resource> UploadEngine::CreateDefaultBuffer(
+    const void* initData,
+    UINT64 byteSize,
+    UploadTicket* ticket,
+    LPCWSTR name)
+{
+    ComPtr<ID3D12Resource> defaultBuffer = CreateDefaultBufferResource(m_device, byteSize, name);
+
+    UploadTicket uploadTicket = EnqueueBufferUpload(defaultBuffer.Get(), 0, initData, byteSize);
+    if (ticket)
+    {
+        *ticket = uploadTicket;
+    }
+    return defaultBuffer;
+}
+
+ComPtr<ID3D12Resource> UploadEngine::CreateStagingBuffer(UINT64 byteSize)
+{
+    ComPtr<ID3D12Resource> stagingBuffer;
+    ThrowIfFailed(m_device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&stagingBuffer)
+    ));
+    GpuMemoryTracker::TrackResource(stagingBuffer.Get(), GpuMemoryCategory::Upload, L"UploadEngineStaging");
+    return stagingBuffer;
+}
+
+ID3D12GraphicsCommandList* UploadEngine::BeginRecording()
+{
+    if (m_currentContext == nullptr)
+    {
+        m_currentContext = m_commandListPool.Acquire();
+    }
+    return m_currentContext->CommandList.Get();
+}
+
+UploadTicket UploadEngine::EndRecording(UINT64 byteSize)
+{
+    UploadTicket ticket;
+    ticket.FenceValue = m_nextFenceValue;
+
+    // Keep batches bounded so staging memory gets recycled while streaming.
+    m_currentBatchBytes += byteSize;
+    if (m_currentBatchBytes >= MaxBatchBytes)
+    {
+        FlushLocked();
+    }
+    return ticket;
+}
+
+UploadTicket UploadEngine::EnqueueBufferUpload(
+    ID3D12Resource* destination,
+    UINT64 destinationOffset,
+    const void* data,
+    UINT64 byteSize)
+{
+    BufferUpload upload;
+    upload.Destination = destination;
+    upload.DestinationOffset = destinationOffset;
+    upload.Data = data;
+    upload.ByteSize = byteSize;
+    return EnqueueBufferUploads(&upload, 1);
+}
+
+UploadTicket UploadEngine::EnqueueBufferUploads(const BufferUpload* uploads, UINT numUploads)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const UINT64 byteSize = GetBufferUploadsSize(uploads, numUploads);
+    if (byteSize == 0)
+    {
+        UploadTicket ticket;
+        ticket.FenceValue = m_nextFenceValue - 1;
+        return ticket;
+    }
+
+    ComPtr<ID3D12Resource> stagingBuffer = CreateStagingBuffer(byteSize);
+
+    // No barriers needed, the copy queue promotes the destinations from COMMON.
+    void* mappedData = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(stagingBuffer->Map(0, &readRange, &mappedData));
+    RecordBufferUploads(BeginRecording(), stagingBuffer.Get(), 0, mappedData, uploads, numUploads);
+    stagingBuffer->Unmap(0, nullptr);
+    m_currentStagingBuffers.push_back(stagingBuffer);
+
+    return EndRecording(byteSize);
+}
+
+UploadTicket UploadEngine::EnqueueAssetUpload(
+    ID3D12Resource* destination,
+    UINT64 destinationOffset,
+    const AssetArchive& archive,
+    const AssetArchiveEntry& entry)
+{
+    const UINT64 byteSize = entry.Size;
+    if (byteSize == 0)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        UploadTicket ticket;
+        ticket.FenceValue = m_nextFenceValue - 1;
+        return ticket;
+    }
+
+    ComPtr<ID3D12Resource> stagingBuffer = CreateStagingBuffer(byteSize);
+
+    void* mappedData = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(stagingBuffer->Map(0, &readRange, &mappedData));
+    archive.Decode(entry, mappedData, m_copyWorkers, true);
+    stagingBuffer->Unmap(0, nullptr);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    BeginRecording()->CopyBufferRegion(destination, destinationOffset, stagingBuffer.Get(), 0, byteSize);
+    m_currentStagingBuffers.push_back(stagingBuffer);
+
+    return EndRecording(byteSize);
+}
+
+UploadTicket UploadEngine::EnqueueTextureUpload(
+    ID3D12Resource* destination,
+    UINT firstSubresource,
+    UINT numSubresources,
+    const D3D12_SUBRESOURCE_DATA* subresourceData)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const UINT64 byteSize = GetRequiredIntermediateSize(destination, firstSubresource, numSubresources);
+    ComPtr<ID3D12Resource> stagingBuffer = CreateStagingBuffer(byteSize);
+
+    ID3D12GraphicsCommandList* commandList = BeginRecording();
+    if (UpdateSubresourcesParallel(commandList, destination, stagingBuffer.Get(), 0, firstSubresource, numSubresources, subresourceData, m_copyWorkers) == 0)
+    {
+        ThrowIfFailed(E_FAIL);
+    }
+    m_currentStagingBuffers.push_back(stagingBuffer);
+
+    return EndRecording(byteSize);
+}
+
+UploadTicket UploadEngine::EnqueueTextureRowsUpload(
+    ID3D12Resource* destination,
+    UINT subresource,
+    UINT firstRow,
+    UINT numRows,
+    const D3D12_SUBRESOURCE_DATA& rows)
+{
+    const D3D12_RESOURCE_DESC desc = destination->GetDesc();
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
+    UINT subresourceRows;
+    UINT64 rowSize;
+    m_device->GetCopyableFootprints(&desc, subresource, 1, 0, &layout, &subresourceRows, &rowSize, nullptr);
+    if (firstRow + numRows > subresourceRows)
+    {
+        ThrowIfFailed(E_INVALIDARG);
+    }
+
+    // The band is a smaller footprint with the same pitch, placed at its row.
+    const UINT pixelsPerRow = layout.Footprint.Height / subresourceRows;
+    layout.Footprint.Height = numRows * pixelsPerRow;
+    const UINT64 byteSize = UINT64(layout.Footprint.RowPitch) * numRows;
+
+    ComPtr<ID3D12Resource> stagingBuffer = CreateStagingBuffer(byteSize);
+    void* mappedData = nullptr;
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(stagingBuffer->Map(0, &readRange, &mappedData));
+    D3D12_MEMCPY_DEST dest = { mappedData, layout.Footprint.RowPitch, static_cast<SIZE_T>(byteSize) };
+    CopySubresource(&dest, &rows, static_cast<SIZE_T>(rowSize), numRows, 1);
+    stagingBuffer->Unmap(0, nullptr);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    CD3DX12_TEXTURE_COPY_LOCATION dst(destination, subresource);
+    CD3DX12_TEXTURE_COPY_LOCATION src(stagingBuffer.Get(), layout);
+    BeginRecording()->CopyTextureRegion(&dst, 0, firstRow * pixelsPerRow, 0, &src, nullptr);
+    m_currentStagingBuffers.push_back(stagingBuffer);
+
+    return EndRecording(byteSize);
+}
+
+UINT64 UploadEngine::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return FlushLocked();
+}
+
+UINT64 UploadEngine::FlushLocked()
+{
+    if (m_currentContext == nullptr)
+    {
+        return m_nextFenceValue - 1;
+    }
+
+    ThrowIfFailed(m_currentContext->CommandList->Close());
+    ID3D12CommandList* cmdLists[] = { m_currentContext->CommandList.Get() };
+    m_copyQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+
+    const UINT64 fenceValue = m_nextFenceValue++;
+    ThrowIfFailed(m_copyQueue->Signal(m_fence.Get(), fenceValue));
+
+    m_commandListPool.Release(m_currentContext, fenceValue);
+    m_currentContext = nullptr;
+
+    InFlightBatch batch;
+    batch.FenceValue = fenceValue;
+    batch.StagingBuffers.swap(m_currentStagingBuffers);
+    m_inFlightBatches.push_back(std::move(batch));
+    m_currentBatchBytes = 0;
+
+    return fenceValue;
+}
+
+bool UploadEngine::IsComplete(const UploadTicket& ticket)
+{
+    return m_fence->GetCompletedValue() >= ticket.FenceValue;
+}
+
+void UploadEngine::WaitOnQueue(ID3D12CommandQueue* queue, const UploadTicket& ticket)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (ticket.FenceValue >= m_nextFenceValue)
+        {
+            FlushLocked();
+        }
+    }
+
+    // Only the GPU waits, the CPU keeps recording.
+    ThrowIfFailed(queue->Wait(m_fence.Get(), ticket.FenceValue));
+}
+
+void UploadEngine::WaitOnCpu(const UploadTicket& ticket)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (ticket.FenceValue >= m_nextFenceValue)
+        {
+            FlushLocked();
+        }
+    }
+
+    if (m_fence->GetCompletedValue() < ticket.FenceValue)
+    {
+        ThrowIfFailed(m_fence->SetEventOnCompletion(ticket.FenceValue, m_fenceEvent));
+        WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+    }
+}
+
+void UploadEngine::RetireCompletedUploads()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const UINT64 completedValue = m_fence->GetCompletedValue();
+    while (!m_inFlightBatches.empty() && m_inFlightBatches.front().FenceValue <= completedValue)
+    {
+        m_inFlightBatches.pop_front();
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include "DXSampleHelper.h"
+#include "AssetArchive.h"
+#include "CommandListPool.h"
+#include "ThreadPool.h"
+#include <deque>
+#include <mutex>
+
+// Identifies the copy queue submission carrying an upload.
+struct UploadTicket
+{
+    UINT64 FenceValue = 0;
+
+    bool IsValid()const { return FenceValue != 0; }
+};
+
+// Streams data into default heap resources on a dedicated copy queue.
+// Uploads are batched into one command list until Flush() submits them, the
+// returned ticket tells when the data has landed. Consumers on another queue
+// only wait GPU-side with WaitOnQueue(), so the CPU never stalls on uploads.
+//
+// Destination resources must be in the COMMON state. Buffers and textures
+// are promoted to COPY_DEST on the copy queue and decay back to COMMON when
+// the submission completes, the graphics queue then promotes them to the
+// read state it needs without an explicit barrier.
+class UploadEngine
+{
+public:
+    // Large texture uploads are copied into staging memory on copyWorkers if given.
+    explicit UploadEngine(ID3D12Device* device, ThreadPool* copyWorkers = nullptr);
+    ~UploadEngine();
+
+    UploadEngine(const UploadEngine& rhs) = delete;
+    UploadEngine& operator=(const UploadEngine& rhs) = delete;
+
+    // Create a default heap buffer in the COMMON state and schedule its upload.
+    ComPtr<ID3D12Resource> CreateDefaultBuffer(
+        const void* initData,
+        UINT64 byteSize,
+        UploadTicket* ticket,
+        LPCWSTR name = L"DefaultBuffer"
+    );
+
+    UploadTicket EnqueueBufferUpload(
+        ID3D12Resource* destination,
+        UINT64 destinationOffset,
+        const void* data,
+        UINT64 byteSize
+    );
+
+    // Pack a whole batch of buffer uploads into one staging allocation.
+    // Contiguous uploads into the same destination share one copy.
+    UploadTicket EnqueueBufferUploads(const BufferUpload* uploads, UINT numUploads);
+
+    // Upload an archive asset into a buffer. Compressed assets are decoded
+    // straight into mapped staging memory, chunks in parallel on the copy
+    // workers, without a decoded copy on the heap. Decoding runs on the
+    // calling thread and its helpers without holding the engine lock.
+    UploadTicket EnqueueAssetUpload(
+        ID3D12Resource* destination,
+        UINT64 destinationOffset,
+        const AssetArchive& archive,
+        const AssetArchiveEntry& entry
+    );
+
+    UploadTicket EnqueueTextureUpload(
+        ID3D12Resource* destination,
+        UINT firstSubresource,
+        UINT numSubresources,
+        const D3D12_SUBRESOURCE_DATA* subresourceData
+    );
+
+    // Upload a band of rows into one subresource, rows being block rows for
+    // compressed formats. rows.pData points at the first row of the band and
+    // rows.RowPitch is its pitch, SlicePitch is unused.
+    UploadTicket EnqueueTextureRowsUpload(
+        ID3D12Resource* destination,
+        UINT subresource,
+        UINT firstRow,
+        UINT numRows,
+        const D3D12_SUBRESOURCE_DATA& rows
+    );
+
+    // Submit the current batch. Returns the fence value of the last submission.
+    UINT64 Flush();
+
+    bool IsComplete(const UploadTicket& ticket);
+
+    // Make the queue wait on the GPU until the ticket's data has landed.
+    // Submits the current batch first if the ticket is part of it.
+    void WaitOnQueue(ID3D12CommandQueue* queue, const UploadTicket& ticket);
+
+    // Block the calling thread until the ticket's data has landed.
+    void WaitOnCpu(const UploadTicket& ticket);
+
+    // Free staging memory of submissions the GPU has finished.
+    void RetireCompletedUploads();
+
+    ID3D12CommandQueue* GetCommandQueue()const { return m_copyQueue.Get(); }
+    ID3D12Fence* GetFence()const { return m_fence.Get(); }
+
+private:
+    // Upload batches grow up to this size before being submitted implicitly.
+    static const UINT64 MaxBatchBytes = 64 * 1024 * 1024;
+
+    struct InFlightBatch
+    {
+        UINT64 FenceValue;
+        std::vector<ComPtr<ID3D12Resource>> StagingBuffers;
+    };
+
+    ComPtr<ID3D12Resource> CreateStagingBuffer(UINT64 byteSize);
+    ID3D12GraphicsCommandList* BeginRecording();
+    UINT64 FlushLocked();
+    UploadTicket EndRecording(UINT64 byteSize);
+
+    ID3D12Device* m_device;
+    ThreadPool* m_copyWorkers;
+    ComPtr<ID3D12CommandQueue> m_copyQueue;
+    ComPtr<ID3D12Fence> m_fence;
+    D3D12FenceSource m_fenceSource;
+    HANDLE m_fenceEvent;
+
+    // Fence value the current batch will signal when submitted.
+    UINT64 m_nextFenceValue = 1;
+
+    CommandListPool m_commandListPool;
+    CommandContext* m_currentContext = nullptr;
+    UINT64 m_currentBatchBytes = 0;
+    std::vector<ComPtr<ID3D12Resource>> m_currentStagingBuffers;
+    std::deque<InFlightBatch> m_inFlightBatches;
+
+    std::mutex m_lock;
+};
@@ -53,7 +53,8 @@ int Win32Application::Run(DXSample* pSample, HINSTANCE hInstance, int nCmdShow)
     // Initialize the sample. OnInit is defined in each child-implementation of DXSample.
     pSample->OnInit();
 
-    ShowWindow(m_hwnd, nCmdShow);
+    // Headless runs keep the window hidden, it only serves the message loop.
+    ShowWindow(m_hwnd, pSample->IsHeadless() ? SW_HIDE : nCmdShow);
     UpdateWindow(m_hwnd);
 
     // Main sample loop.
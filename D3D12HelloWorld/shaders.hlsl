@@ -1,7 +1,6 @@
-cbuffer cbPerObject:register(b0)
-{
-    float4x4 gWorldViewProj;
-};
+// keywords: GRAYSCALE
+
+#include "ObjectConstants.hlsli"
 
 struct VSInput
 {
@@ -20,12 +19,17 @@ PSInput VSMain(VSInput vin)
     PSInput result;
 
     // Transform to homogeneous clip spaces.
-    result.posH = mul(float4(vin.posL, 1.0f), gWorldViewProj);
+    result.posH = mul(float4(vin.posL, 1.0f), WorldViewProj);
     result.color = vin.color;
     return result;
 }
 
 float4 PSMain(PSInput input) : SV_TARGET
 {
+#if GRAYSCALE
+    float luminance = dot(input.color.rgb, float3(0.2126f, 0.7152f, 0.0722f));
+    return float4(luminance.xxx, input.color.a);
+#else
     return input.color;
+#endif
 }
\ No newline at end of file
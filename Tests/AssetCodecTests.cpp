@@ -0,0 +1,169 @@
+#include "TestFramework.h"
+#include "AssetCodec.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::vector<uint8_t> RandomBytes(size_t size, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& b : bytes)
+    {
+        b = static_cast<uint8_t>(random());
+    }
+    return bytes;
+}
+
+// Compresses with the archive writer's rule: only keep it if it is smaller.
+static std::vector<uint8_t> Compress(const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> compressed(data.size());
+    compressed.resize(CompressAssetChunk(data.data(), data.size(), compressed.data(), compressed.size()));
+    return compressed;
+}
+
+static bool RoundTrips(const std::vector<uint8_t>& data)
+{
+    const std::vector<uint8_t> compressed = Compress(data);
+    if (compressed.empty())
+    {
+        return false;
+    }
+    std::vector<uint8_t> decoded(data.size());
+    return DecompressAssetChunk(compressed.data(), compressed.size(), decoded.data(), decoded.size()) &&
+        decoded == data;
+}
+
+TEST(ZerosCompressWell)
+{
+    const std::vector<uint8_t> zeros(AssetChunkSize, 0);
+    const std::vector<uint8_t> compressed = Compress(zeros);
+    CHECK(!compressed.empty());
+    CHECK(compressed.size() < 512);
+    CHECK(RoundTrips(zeros));
+}
+
+TEST(RepetitiveTextRoundTrips)
+{
+    std::string text;
+    while (text.size() < AssetChunkSize)
+    {
+        text += "float4 PSMain(PSInput input) : SV_TARGET { return input.color; }\n";
+        text += std::to_string(text.size());
+    }
+    text.resize(AssetChunkSize);
+    CHECK(RoundTrips(std::vector<uint8_t>(text.begin(), text.end())));
+}
+
+TEST(LongLiteralRunsRoundTrip)
+{
+    // Literal counts and match lengths beyond 15 + 255 need several length bytes.
+    std::vector<uint8_t> data = RandomBytes(1000, 1);
+    data.resize(data.size() + 5000, 7);
+    const std::vector<uint8_t> tail = RandomBytes(600, 2);
+    data.insert(data.end(), tail.begin(), tail.end());
+    data.insert(data.end(), data.begin(), data.begin() + 3000);
+    CHECK(RoundTrips(data));
+}
+
+TEST(SmallSizesRoundTrip)
+{
+    for (size_t size = 1; size < 200; size++)
+    {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            data[i] = static_cast<uint8_t>(i % 5);
+        }
+        std::vector<uint8_t> compressed(size + 16);
+        compressed.resize(CompressAssetChunk(data.data(), size, compressed.data(), compressed.size()));
+        CHECK(!compressed.empty());
+        std::vector<uint8_t> decoded(size);
+        CHECK(DecompressAssetChunk(compressed.data(), compressed.size(), decoded.data(), size));
+        CHECK(decoded == data);
+    }
+}
+
+TEST(IncompressibleDataIsRejected)
+{
+    const std::vector<uint8_t> noise = RandomBytes(AssetChunkSize, 3);
+    CHECK(Compress(noise).empty());
+}
+
+TEST(EmptyChunkDecodesToNothing)
+{
+    uint8_t out = 0;
+    CHECK(DecompressAssetChunk(nullptr, 0, &out, 0));
+    CHECK(!DecompressAssetChunk(nullptr, 0, &out, 1));
+}
+
+TEST(WrongDecodedSizeIsRejected)
+{
+    const std::vector<uint8_t> data(4096, 9);
+    const std::vector<uint8_t> compressed = Compress(data);
+    std::vector<uint8_t> decoded(data.size() + 1);
+    CHECK(!DecompressAssetChunk(compressed.data(), compressed.size(), decoded.data(), data.size() - 1));
+    CHECK(!DecompressAssetChunk(compressed.data(), compressed.size(), decoded.data(), data.size() + 1));
+}
+
+TEST(TruncatedChunkIsRejected)
+{
+    std::string text;
+    for (int i = 0; i < 500; i++)
+    {
+        text += "abcabcabd" + std::to_string(i % 7);
+    }
+    const std::vector<uint8_t> data(text.begin(), text.end());
+    const std::vector<uint8_t> compressed = Compress(data);
+    // Dropping the empty closing token of a chunk that ends in a match loses
+    // nothing, any other cut has to fail.
+    std::vector<uint8_t> decoded(data.size());
+    for (size_t size = 0; size < compressed.size(); size++)
+    {
+        std::fill(decoded.begin(), decoded.end(), 0);
+        const bool decodes = DecompressAssetChunk(compressed.data(), size, decoded.data(), decoded.size());
+        CHECK(!decodes || (size == compressed.size() - 1 && compressed.back() == 0 && decoded == data));
+    }
+}
+
+TEST(BadOffsetsAreRejected)
+{
+    uint8_t decoded[16];
+    // One literal, then a match reaching before the start of the output.
+    const uint8_t beforeStart[] = { 0x10, 'a', 0x02, 0x00, 0x00, 'b' };
+    CHECK(!DecompressAssetChunk(beforeStart, sizeof(beforeStart), decoded, 6));
+    // Offset 0 would copy the byte being written.
+    const uint8_t zeroOffset[] = { 0x10, 'a', 0x00, 0x00, 0x00, 'b' };
+    CHECK(!DecompressAssetChunk(zeroOffset, sizeof(zeroOffset), decoded, 6));
+    // The same with offset 1 is valid: "a" + "aaaa" + "b".
+    const uint8_t valid[] = { 0x10, 'a', 0x01, 0x00, 0x10, 'b' };
+    CHECK(DecompressAssetChunk(valid, sizeof(valid), decoded, 6));
+    CHECK(std::string(decoded, decoded + 6) == "aaaaab");
+}
+
+TEST(CorruptChunksNeverWritePastTheEnd)
+{
+    std::vector<uint8_t> data = RandomBytes(2000, 4);
+    data.insert(data.end(), data.begin(), data.end());
+    data.resize(8000, 1);
+    const std::vector<uint8_t> compressed = Compress(data);
+    CHECK(!compressed.empty());
+
+    const size_t Guard = 64;
+    std::mt19937 random(5);
+    for (int i = 0; i < 2000; i++)
+    {
+        std::vector<uint8_t> corrupt = compressed;
+        corrupt[random() % corrupt.size()] = static_cast<uint8_t>(random());
+        std::vector<uint8_t> decoded(data.size() + Guard, 0xcd);
+        DecompressAssetChunk(corrupt.data(), corrupt.size(), decoded.data(), data.size());
+        bool guardIntact = true;
+        for (size_t g = data.size(); g < decoded.size(); g++)
+        {
+            guardIntact = guardIntact && decoded[g] == 0xcd;
+        }
+        CHECK(guardIntact);
+    }
+}
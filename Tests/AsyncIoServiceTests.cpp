@@ -0,0 +1,120 @@
+#include "TestFramework.h"
+#include "AsyncIoService.h"
+#include "TemporaryFile.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+// Runs completions the way the frame loop does until none are pending.
+static void DispatchAll(AsyncIoService& service)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (service.GetPendingCount() > 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        if (service.DispatchCompletions() == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+TEST(CompletionsRunOnDispatch)
+{
+    TemporaryFile file("AsyncIoServiceTests_read.bin", "contents");
+    AsyncIoService service(1);
+    IoResult result;
+    bool completed = false;
+    const IoRequestId id = service.ReadFile(file.GetPath(), IoPriority::Normal, [&](const IoResult& r)
+    {
+        result = r;
+        completed = true;
+    });
+
+    // Nothing runs on the caller's behalf until it dispatches.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!completed);
+    CHECK(service.GetPendingCount() == 1);
+
+    DispatchAll(service);
+    CHECK(completed);
+    CHECK(result.Id == id);
+    CHECK(result.Status == IoStatusOk);
+    CHECK(result.Data.Size == 8 && std::memcmp(result.Data.Data, "contents", 8) == 0);
+}
+
+TEST(FailuresCompleteInsteadOfThrowing)
+{
+    AsyncIoService service(1);
+    int32_t status = IoStatusOk;
+    service.ReadFile(L"AsyncIoServiceTests_missing.bin", IoPriority::Normal, [&](const IoResult& r) { status = r.Status; });
+    DispatchAll(service);
+    CHECK(status != IoStatusOk && status != IoStatusAborted);
+
+    CHECK(service.ReadNow(L"AsyncIoServiceTests_missing.bin").Status != IoStatusOk);
+}
+
+TEST(QueuedRequestsRunByPriority)
+{
+    // The first request keeps the only worker busy paging in a large file
+    // while the others queue up. It has the highest priority, so it goes
+    // first even if the worker only starts once all are queued.
+    TemporaryFile large("AsyncIoServiceTests_large.bin", std::string(64 << 20, 'x'));
+    TemporaryFile small("AsyncIoServiceTests_small.bin", "x");
+    AsyncIoService service(1);
+    std::vector<int> order;
+    auto record = [&order](int tag) { return [&order, tag](const IoResult&) { order.push_back(tag); }; };
+
+    service.ReadFile(large.GetPath(), IoPriority::High, record(0));
+    service.ReadFile(small.GetPath(), IoPriority::Low, record(1));
+    service.ReadFile(small.GetPath(), IoPriority::Normal, record(2));
+    service.ReadFile(small.GetPath(), IoPriority::High, record(3));
+    service.ReadFile(small.GetPath(), IoPriority::Low, record(4));
+    DispatchAll(service);
+
+    CHECK(order == std::vector<int>({ 0, 3, 2, 1, 4 }));
+}
+
+TEST(CancelBeforeDispatchAborts)
+{
+    // Queued behind a large read, the worker has not started on it yet.
+    TemporaryFile large("AsyncIoServiceTests_large.bin", std::string(64 << 20, 'x'));
+    TemporaryFile file("AsyncIoServiceTests_cancel.bin", "contents");
+    AsyncIoService service(1);
+    service.ReadFile(large.GetPath(), IoPriority::High, nullptr);
+    IoResult result;
+    const IoRequestId id = service.ReadFile(file.GetPath(), IoPriority::Normal, [&](const IoResult& r) { result = r; });
+
+    CHECK(service.Cancel(id));
+    DispatchAll(service);
+    CHECK(result.Status == IoStatusAborted);
+    CHECK(result.Data.Empty() && !result.File);
+}
+
+TEST(CancelAfterDispatchChangesNothing)
+{
+    TemporaryFile file("AsyncIoServiceTests_cancel.bin", "contents");
+    AsyncIoService service(1);
+    IoResult result;
+    const IoRequestId id = service.ReadFile(file.GetPath(), IoPriority::Normal, [&](const IoResult& r) { result = r; });
+    DispatchAll(service);
+
+    CHECK(!service.Cancel(id));
+    CHECK(result.Status == IoStatusOk);
+}
+
+TEST(CancelAgreesWithTheStatus)
+{
+    // Cancelled at every stage of the read: Cancel returns true exactly when
+    // the request completes with E_ABORT.
+    TemporaryFile file("AsyncIoServiceTests_race.bin", std::string(1 << 20, 'x'));
+    AsyncIoService service(1);
+    for (int i = 0; i < 200; i++)
+    {
+        int32_t status = IoStatusOk;
+        const IoRequestId id = service.ReadFile(file.GetPath(), IoPriority::Normal, [&status](const IoResult& r) { status = r.Status; });
+        std::this_thread::sleep_for(std::chrono::microseconds(i * 10));
+        const bool cancelled = service.Cancel(id);
+        DispatchAll(service);
+        CHECK(cancelled == (status == IoStatusAborted));
+    }
+}
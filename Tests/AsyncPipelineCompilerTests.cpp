@@ -0,0 +1,203 @@
+#include "TestFramework.h"
+#include "AsyncPipelineCompiler.h"
+#include <chrono>
+#include <future>
+#include <stdexcept>
+
+// Reference counted stand-in for a pipeline, the compiler only holds and
+// hands out pointers to it.
+class FakePipeline : public ID3D12PipelineState
+{
+public:
+    HRESULT __stdcall QueryInterface(REFIID, void** object) override { *object = nullptr; return E_NOINTERFACE; }
+    ULONG __stdcall AddRef() override { return ++m_references; }
+    ULONG __stdcall Release() override
+    {
+        const ULONG references = --m_references;
+        if (references == 0)
+        {
+            delete this;
+        }
+        return references;
+    }
+    HRESULT __stdcall GetPrivateData(REFGUID, UINT*, void*) override { return E_NOTIMPL; }
+    HRESULT __stdcall SetPrivateData(REFGUID, UINT, const void*) override { return E_NOTIMPL; }
+    HRESULT __stdcall SetPrivateDataInterface(REFGUID, const IUnknown*) override { return E_NOTIMPL; }
+    HRESULT __stdcall SetName(LPCWSTR) override { return E_NOTIMPL; }
+    HRESULT __stdcall GetDevice(REFIID, void** device) override { *device = nullptr; return E_NOTIMPL; }
+    HRESULT __stdcall GetCachedBlob(ID3DBlob** blob) override { *blob = nullptr; return E_NOTIMPL; }
+
+private:
+    std::atomic<ULONG> m_references{ 1 };
+};
+
+static ComPtr<ID3D12PipelineState> MakeFakePipeline()
+{
+    ComPtr<ID3D12PipelineState> pipeline;
+    pipeline.Attach(new FakePipeline());
+    return pipeline;
+}
+
+// Descs told apart by their sample mask, which is all the fake create looks at.
+static D3D12_GRAPHICS_PIPELINE_STATE_DESC MakeDesc(UINT id)
+{
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+    desc.SampleMask = id;
+    return desc;
+}
+
+// Holds the only worker of a pool until Open, so requests stay queued.
+class Gate
+{
+public:
+    explicit Gate(ThreadPool& pool) :
+        m_opened(m_open.get_future().share())
+    {
+        std::shared_future<void> opened = m_opened;
+        pool.Submit([opened] { opened.wait(); }, 1000);
+    }
+    ~Gate() { Open(); }
+
+    void Open()
+    {
+        if (!m_isOpen)
+        {
+            m_isOpen = true;
+            m_open.set_value();
+        }
+    }
+
+private:
+    std::promise<void> m_open;
+    std::shared_future<void> m_opened;
+    bool m_isOpen = false;
+};
+
+// Sleeps like a driver compile and records which descs it was asked for.
+struct FakeCreate
+{
+    std::vector<UINT> Created;
+    std::mutex Lock;
+
+    PipelineCreateFunction GetFunction()
+    {
+        return [this](const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            std::lock_guard<std::mutex> lock(Lock);
+            Created.push_back(desc.SampleMask);
+            return MakeFakePipeline();
+        };
+    }
+};
+
+TEST(PendingUntilCreatedThenReady)
+{
+    ThreadPool pool(1);
+    FakeCreate create;
+    AsyncPipelineCompiler compiler(&pool, create.GetFunction());
+    ComPtr<ID3D12PipelineState> fallback = MakeFakePipeline();
+
+    Gate gate(pool);
+    PipelineHandle handle = compiler.Compile(MakeDesc(1), fallback.Get());
+    CHECK(handle.GetStatus() == PipelineStatus::Pending);
+    CHECK(handle.Get() == fallback.Get());
+    CHECK(compiler.GetPendingCount() == 1);
+
+    gate.Open();
+    handle.Wait();
+    CHECK(handle.GetStatus() == PipelineStatus::Ready);
+    CHECK(handle.GetError() == S_OK);
+    CHECK(handle.Get() != nullptr && handle.Get() != fallback.Get());
+    CHECK(compiler.GetPendingCount() == 0);
+}
+
+TEST(FailuresKeepTheFallback)
+{
+    ThreadPool pool(1);
+    ComPtr<ID3D12PipelineState> fallback = MakeFakePipeline();
+    AsyncPipelineCompiler compiler(&pool, [](const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) -> ComPtr<ID3D12PipelineState>
+    {
+        switch (desc.SampleMask)
+        {
+        case 1:
+            ThrowIfFailed(E_OUTOFMEMORY);
+            break;
+        case 2:
+            throw std::runtime_error("not an HrException");
+        }
+        return nullptr;
+    });
+
+    PipelineHandle hrException = compiler.Compile(MakeDesc(1), fallback.Get());
+    PipelineHandle otherException = compiler.Compile(MakeDesc(2), fallback.Get());
+    PipelineHandle noPipeline = compiler.Compile(MakeDesc(3));
+    for (const PipelineHandle& handle : { hrException, otherException, noPipeline })
+    {
+        handle.Wait();
+        CHECK(handle.GetStatus() == PipelineStatus::Failed);
+    }
+    CHECK(hrException.GetError() == E_OUTOFMEMORY);
+    CHECK(hrException.Get() == fallback.Get());
+    CHECK(otherException.GetError() == E_FAIL);
+    CHECK(noPipeline.GetError() == E_FAIL);
+    CHECK(noPipeline.Get() == nullptr);
+    CHECK(compiler.GetPendingCount() == 0);
+}
+
+TEST(InFlightRequestsAreShared)
+{
+    ThreadPool pool(1);
+    FakeCreate create;
+    AsyncPipelineCompiler compiler(&pool, create.GetFunction());
+
+    Gate gate(pool);
+    PipelineHandle first = compiler.Compile(MakeDesc(1));
+    PipelineHandle second = compiler.Compile(MakeDesc(1));
+    CHECK(compiler.GetPendingCount() == 1);
+
+    gate.Open();
+    first.Wait();
+    second.Wait();
+    CHECK(first.Get() == second.Get());
+    CHECK(create.Created.size() == 1);
+}
+
+TEST(HigherPrioritiesAreCreatedFirst)
+{
+    ThreadPool pool(1);
+    FakeCreate create;
+    AsyncPipelineCompiler compiler(&pool, create.GetFunction());
+
+    Gate gate(pool);
+    std::vector<PipelineHandle> handles;
+    handles.push_back(compiler.Compile(MakeDesc(1), nullptr, 0));
+    handles.push_back(compiler.Compile(MakeDesc(2), nullptr, 10));
+    handles.push_back(compiler.Compile(MakeDesc(3), nullptr, 5));
+    handles.push_back(compiler.Compile(MakeDesc(4), nullptr, 10));
+
+    gate.Open();
+    for (const PipelineHandle& handle : handles)
+    {
+        handle.Wait();
+    }
+    CHECK(create.Created == std::vector<UINT>({ 2, 4, 3, 1 }));
+}
+
+TEST(QueuedRequestsAbortWithTheCompiler)
+{
+    ThreadPool pool(1);
+    FakeCreate create;
+    PipelineHandle handle;
+    Gate gate(pool);
+    {
+        AsyncPipelineCompiler compiler(&pool, create.GetFunction());
+        handle = compiler.Compile(MakeDesc(1));
+    }
+
+    gate.Open();
+    handle.Wait();
+    CHECK(handle.GetStatus() == PipelineStatus::Failed);
+    CHECK(handle.GetError() == E_ABORT);
+    CHECK(create.Created.empty());
+}
@@ -0,0 +1,160 @@
+#include "TestFramework.h"
+#include "FencedPool.h"
+#include <atomic>
+#include <thread>
+
+// Stands in for a queue and its fence: Signal hands out the value a
+// submission signals, Complete lets the GPU catch up.
+class SimulatedFence : public FenceSource
+{
+public:
+    uint64_t Signal() { return ++m_signaled; }
+    void Complete(uint64_t value) { m_completed = value; }
+    void CompleteAll() { m_completed = m_signaled; }
+
+    virtual uint64_t GetCompletedValue()const override { return m_completed; }
+
+private:
+    uint64_t m_signaled = 0;
+    std::atomic<uint64_t> m_completed{ 0 };
+};
+
+struct PooledObject
+{
+    int Resets = 0;
+};
+
+// What CommandListPool::Acquire does: recycle and reset, or create.
+static PooledObject* Acquire(FencedPool<PooledObject>& pool)
+{
+    PooledObject* object = pool.TryRecycle();
+    if (object)
+    {
+        object->Resets++;
+        return object;
+    }
+    return pool.Add(std::make_unique<PooledObject>());
+}
+
+TEST(GrowsWhileNothingCompleted)
+{
+    SimulatedFence fence;
+    FencedPool<PooledObject> pool(fence);
+    for (int i = 0; i < 3; i++)
+    {
+        pool.Release(Acquire(pool), fence.Signal());
+    }
+    CHECK(pool.GetCreatedCount() == 3);
+    CHECK(pool.GetRetiredCount() == 3);
+    CHECK(pool.TryRecycle() == nullptr);
+}
+
+TEST(RecyclesOnlyOnceTheFencePassed)
+{
+    SimulatedFence fence;
+    FencedPool<PooledObject> pool(fence);
+    PooledObject* first = Acquire(pool);
+    PooledObject* second = Acquire(pool);
+    pool.Release(first, fence.Signal());
+    pool.Release(second, fence.Signal());
+
+    fence.Complete(1);
+    PooledObject* recycled = Acquire(pool);
+    CHECK(recycled == first);
+    CHECK(recycled->Resets == 1);
+
+    // The second submission is still running.
+    CHECK(pool.TryRecycle() == nullptr);
+    CHECK(Acquire(pool) != second);
+    CHECK(pool.GetCreatedCount() == 3);
+
+    fence.Complete(2);
+    CHECK(pool.TryRecycle() == second);
+}
+
+TEST(RecyclesInSubmissionOrder)
+{
+    SimulatedFence fence;
+    FencedPool<PooledObject> pool(fence);
+    PooledObject* objects[4];
+    for (PooledObject*& object : objects)
+    {
+        object = Acquire(pool);
+    }
+    for (PooledObject* object : objects)
+    {
+        pool.Release(object, fence.Signal());
+    }
+
+    fence.CompleteAll();
+    for (PooledObject* object : objects)
+    {
+        CHECK(pool.TryRecycle() == object);
+    }
+    CHECK(pool.TryRecycle() == nullptr);
+}
+
+TEST(ObjectsReleasedAtZeroAreReadyAtOnce)
+{
+    // CommandListPool pre-creates its initial contexts this way.
+    SimulatedFence fence;
+    FencedPool<PooledObject> pool(fence);
+    PooledObject* object = pool.Add(std::make_unique<PooledObject>());
+    pool.Release(object, 0);
+    CHECK(Acquire(pool) == object);
+    CHECK(pool.GetCreatedCount() == 1);
+}
+
+TEST(SizeIsBoundedByFramesInFlight)
+{
+    // Two lists a frame and the GPU two frames behind: the lists of the two
+    // frames still running plus the ones being recorded.
+    const int ListsPerFrame = 2;
+    const uint64_t FramesInFlight = 2;
+    SimulatedFence fence;
+    FencedPool<PooledObject> pool(fence);
+    for (uint64_t frame = 1; frame <= 100; frame++)
+    {
+        if (frame > FramesInFlight)
+        {
+            fence.Complete(frame - FramesInFlight - 1);
+        }
+        PooledObject* lists[ListsPerFrame];
+        for (PooledObject*& list : lists)
+        {
+            list = Acquire(pool);
+        }
+        const uint64_t fenceValue = fence.Signal();
+        for (PooledObject* list : lists)
+        {
+            pool.Release(list, fenceValue);
+        }
+    }
+    CHECK(pool.GetCreatedCount() == ListsPerFrame * (FramesInFlight + 1));
+}
+
+TEST(ConcurrentAcquireAndRelease)
+{
+    // Fence value 0 is always complete, so no thread ever needs more than
+    // the one object it holds.
+    const int ThreadCount = 4;
+    SimulatedFence fence;
+    FencedPool<PooledObject> pool(fence);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&pool]()
+        {
+            for (int i = 0; i < 10000; i++)
+            {
+                pool.Release(Acquire(pool), 0);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(pool.GetCreatedCount() <= ThreadCount);
+    CHECK(pool.GetRetiredCount() == pool.GetCreatedCount());
+}
@@ -0,0 +1,117 @@
+#include "TestFramework.h"
+#include "IncludeHashCache.h"
+#include "TemporaryFile.h"
+#include <thread>
+#include <vector>
+
+static uint64_t HashOf(const std::string& contents)
+{
+    return IncludeHashCache::HashContents(contents.data(), contents.size());
+}
+
+TEST(ReadsEachFileOnce)
+{
+    TemporaryFile include("IncludeHashCacheTests_once.hlsli", "cbuffer A {};");
+    IncludeHashCache hashes(L"");
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("cbuffer A {};"));
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("cbuffer A {};"));
+    CHECK(hashes.GetReadCount() == 1);
+}
+
+TEST(EditsAreSeenAfterInvalidate)
+{
+    TemporaryFile include("IncludeHashCacheTests_edit.hlsli", "old");
+    IncludeHashCache hashes(L"");
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("old"));
+
+    // Until the watcher reports the edit, the known hash stands.
+    include.Write("new");
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("old"));
+
+    hashes.Invalidate(include.GetPath());
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("new"));
+    CHECK(hashes.GetReadCount() == 2);
+}
+
+TEST(InvalidateIgnoresCase)
+{
+    TemporaryFile include("IncludeHashCacheTests_case.hlsli", "old");
+    IncludeHashCache hashes(L"");
+    hashes.GetHash(include.GetName());
+    include.Write("new");
+    hashes.Invalidate(L"INCLUDEHASHCACHETESTS_CASE.HLSLI");
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("new"));
+}
+
+TEST(InvalidateLeavesOtherFiles)
+{
+    TemporaryFile first("IncludeHashCacheTests_first.hlsli", "first");
+    TemporaryFile second("IncludeHashCacheTests_second.hlsli", "second");
+    IncludeHashCache hashes(L"");
+    hashes.GetHash(first.GetName());
+    hashes.GetHash(second.GetName());
+    hashes.Invalidate(first.GetPath());
+    hashes.GetHash(first.GetName());
+    hashes.GetHash(second.GetName());
+    CHECK(hashes.GetReadCount() == 3);
+
+    // Changes were lost, everything is read again.
+    hashes.Invalidate(L"*");
+    hashes.GetHash(first.GetName());
+    hashes.GetHash(second.GetName());
+    CHECK(hashes.GetReadCount() == 5);
+}
+
+TEST(MissingFiles)
+{
+    IncludeHashCache hashes(L"");
+    const std::string name = "IncludeHashCacheTests_missing.hlsli";
+    CHECK(hashes.GetHash(name) == IncludeHashCache::MissingHash);
+
+    TemporaryFile include(name.c_str(), "");
+    hashes.Invalidate(include.GetPath());
+    CHECK(hashes.GetHash(name) == HashOf(""));
+    CHECK(HashOf("") != IncludeHashCache::MissingHash);
+}
+
+TEST(RecordedHashWinsOverTheDisk)
+{
+    // A compile read "served", the file was saved again before the watcher
+    // noticed. The recorded hash describes what the bytecode was built from.
+    TemporaryFile include("IncludeHashCacheTests_record.hlsli", "saved later");
+    IncludeHashCache hashes(L"");
+    hashes.Record(include.GetName(), HashOf("served"));
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("served"));
+    CHECK(hashes.GetReadCount() == 0);
+
+    hashes.Invalidate(include.GetPath());
+    CHECK(hashes.GetHash(include.GetName()) == HashOf("saved later"));
+}
+
+TEST(ConcurrentLookupsAgree)
+{
+    TemporaryFile include("IncludeHashCacheTests_threads.hlsli", "shared");
+    IncludeHashCache hashes(L"");
+    const int ThreadCount = 4;
+    std::vector<uint64_t> results(ThreadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < ThreadCount; t++)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (int i = 0; i < 1000; i++)
+            {
+                results[t] = hashes.GetHash(include.GetName());
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    for (uint64_t result : results)
+    {
+        CHECK(result == HashOf("shared"));
+    }
+    CHECK(hashes.GetReadCount() <= ThreadCount);
+}
@@ -0,0 +1,139 @@
+#include "TestFramework.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <stdexcept>
+
+TEST(ParallelForCoversEveryIndexOnce)
+{
+    JobSystem jobs(3);
+    std::vector<std::atomic<int>> hits(10000);
+    for (std::atomic<int>& hit : hits)
+    {
+        hit = 0;
+    }
+    jobs.ParallelFor(static_cast<uint32_t>(hits.size()), 7, [&hits](uint32_t begin, uint32_t end)
+    {
+        CHECK(end - begin <= 7);
+        for (uint32_t i = begin; i < end; i++)
+        {
+            hits[i]++;
+        }
+    });
+    CHECK(std::all_of(hits.begin(), hits.end(), [](const std::atomic<int>& hit) { return hit == 1; }));
+}
+
+TEST(EmptyParallelFor)
+{
+    JobSystem jobs(1);
+    bool called = false;
+    jobs.ParallelFor(0, 16, [&called](uint32_t, uint32_t) { called = true; });
+    CHECK(!called);
+}
+
+TEST(JobsWaitOnJobsTheySpawned)
+{
+    // Deeper than there are workers: waiting threads have to run jobs.
+    JobSystem jobs(2);
+    std::atomic<int> leaves(0);
+    std::function<void(int)> spawn = [&](int depth)
+    {
+        if (depth == 0)
+        {
+            leaves++;
+            return;
+        }
+        JobCounter children;
+        jobs.Run([&spawn, depth] { spawn(depth - 1); }, children);
+        jobs.Run([&spawn, depth] { spawn(depth - 1); }, children);
+        jobs.Wait(children);
+    };
+    JobCounter root;
+    jobs.Run([&spawn] { spawn(8); }, root);
+    jobs.Wait(root);
+    CHECK(leaves == 256);
+}
+
+TEST(FirstExceptionIsRethrownByWait)
+{
+    JobSystem jobs(2);
+    JobCounter counter;
+    std::atomic<int> finished(0);
+    for (int i = 0; i < 100; i++)
+    {
+        jobs.Run([i, &finished]
+        {
+            if (i == 50)
+            {
+                throw std::runtime_error("job failed");
+            }
+            finished++;
+        }, counter);
+    }
+    CHECK_THROWS(jobs.Wait(counter));
+    CHECK(counter.IsDone());
+    CHECK(finished == 99);
+
+    // The error was handed out, the counter can be used again.
+    jobs.Run([] {}, counter);
+    jobs.Wait(counter);
+}
+
+TEST(JobsFromManyThreads)
+{
+    // Run from outside the workers spreads jobs over every deque while the
+    // workers pop and steal, the queued count must stay consistent.
+    JobSystem jobs(3);
+    std::atomic<int> done(0);
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; t++)
+    {
+        producers.emplace_back([&jobs, &done]
+        {
+            for (int round = 0; round < 200; round++)
+            {
+                JobCounter counter;
+                for (int i = 0; i < 16; i++)
+                {
+                    jobs.Run([&done] { done++; }, counter);
+                }
+                jobs.Wait(counter);
+            }
+        });
+    }
+    for (std::thread& producer : producers)
+    {
+        producer.join();
+    }
+    CHECK(done == 4 * 200 * 16);
+}
+
+TEST(IdleWorkersSteal)
+{
+    // A single job spawning many puts them all on one deque.
+    JobSystem jobs(3);
+    JobCounter root;
+    jobs.Run([&jobs]
+    {
+        jobs.ParallelFor(256, 1, [](uint32_t, uint32_t)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        });
+    }, root);
+    jobs.Wait(root);
+    CHECK(jobs.GetStealCount() > 0);
+}
+
+TEST(DestructorRunsQueuedJobs)
+{
+    std::atomic<int> done(0);
+    JobCounter counter;
+    {
+        JobSystem jobs(2);
+        for (int i = 0; i < 100; i++)
+        {
+            jobs.Run([&done] { done++; }, counter);
+        }
+    }
+    CHECK(done == 100);
+    CHECK(counter.IsDone());
+}
@@ -0,0 +1,73 @@
+#include "TestFramework.h"
+#include "MappedFile.h"
+#include "TemporaryFile.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST(MapsTheWholeFile)
+{
+    std::string contents;
+    for (int i = 0; i < 100000; i++)
+    {
+        contents += static_cast<char>(i * 31);
+    }
+    TemporaryFile temporary("MappedFileTests_contents.bin", contents);
+
+    MappedFile file(temporary.GetPath());
+    CHECK(file.IsOpen());
+    CHECK(file.Size() == contents.size());
+    CHECK(std::memcmp(file.Data(), contents.data(), contents.size()) == 0);
+
+    const ByteSpan span = file.GetSpan().Slice(10, 20);
+    CHECK(span.Size == 20);
+    CHECK(std::memcmp(span.Data, contents.data() + 10, 20) == 0);
+}
+
+TEST(EmptyFileIsOpenWithoutData)
+{
+    TemporaryFile temporary("MappedFileTests_empty.bin", std::string());
+    MappedFile file(temporary.GetPath());
+    CHECK(file.IsOpen());
+    CHECK(file.Size() == 0);
+    CHECK(file.GetSpan().Empty());
+}
+
+TEST(MissingFileThrows)
+{
+    MappedFile file;
+    CHECK_THROWS(file.Open(L"MappedFileTests_missing.bin"));
+    CHECK(!file.IsOpen());
+}
+
+TEST(MoveTransfersTheMapping)
+{
+    TemporaryFile temporary("MappedFileTests_move.bin", "mapped");
+    MappedFile first(temporary.GetPath());
+    const uint8_t* data = first.Data();
+
+    MappedFile second(std::move(first));
+    CHECK(!first.IsOpen());
+    CHECK(first.Data() == nullptr);
+    CHECK(second.Data() == data);
+    CHECK(second.Size() == 6);
+
+    MappedFile third;
+    third = std::move(second);
+    CHECK(third.Data() == data);
+    CHECK(!second.IsOpen());
+
+    third.Close();
+    CHECK(!third.IsOpen());
+    CHECK(third.Size() == 0);
+}
+
+#ifndef _WIN32
+TEST(NonAsciiFileName)
+{
+    // POSIX file systems store the name as UTF-8.
+    TemporaryFile temporary("MappedFileTests_\xC3\xA9\xF0\x9F\x98\x80.bin", "x");
+    MappedFile file(L"MappedFileTests_\u00E9\U0001F600.bin");
+    CHECK(file.Size() == 1);
+}
+#endif
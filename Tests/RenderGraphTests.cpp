@@ -0,0 +1,198 @@
+#include "TestFramework.h"
+#include "RenderGraph.h"
+
+static RenderGraphTextureDesc TextureDesc(uint32_t width, uint32_t height)
+{
+    RenderGraphTextureDesc desc;
+    desc.Width = width;
+    desc.Height = height;
+    desc.Format = 10;   // DXGI_FORMAT_R16G16B16A16_FLOAT, the graph does not look at it.
+    return desc;
+}
+
+static bool IsBarrier(const RenderGraphBarrier& barrier, RenderGraphResource resource, uint32_t before, uint32_t after)
+{
+    return barrier.Resource == resource && barrier.Before == before && barrier.After == after;
+}
+
+TEST(PassesNothingNeedsAreCulled)
+{
+    RenderGraph graph;
+    const RenderGraphResource backBuffer = graph.ImportResource(L"BackBuffer", RenderGraphUsage_Present, RenderGraphUsage_Present);
+    const RenderGraphResource unused = graph.CreateTexture(L"Unused", TextureDesc(64, 64));
+    const RenderGraphResource scene = graph.CreateTexture(L"Scene", TextureDesc(64, 64));
+
+    const RenderGraphPass unusedPass = graph.AddPass(L"Unused");
+    graph.Write(unusedPass, unused, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass scenePass = graph.AddPass(L"Scene");
+    graph.Write(scenePass, scene, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass postPass = graph.AddPass(L"Post");
+    graph.Read(postPass, scene, RenderGraphUsage_ShaderResource);
+    graph.Write(postPass, backBuffer, RenderGraphUsage_RenderTarget);
+    graph.Compile();
+
+    CHECK(graph.IsCulled(unusedPass));
+    CHECK(!graph.IsCulled(scenePass));
+    CHECK(graph.GetExecutionOrder() == std::vector<RenderGraphPass>({ scenePass, postPass }));
+    CHECK(graph.GetLifetime(unused).First == RenderGraphInvalid);
+    CHECK(graph.GetTextureSlot(unused) == RenderGraphInvalid);
+}
+
+TEST(SideEffectsKeepAPassAndItsProducers)
+{
+    RenderGraph graph;
+    const RenderGraphResource scene = graph.CreateTexture(L"Scene", TextureDesc(64, 64));
+    const RenderGraphPass scenePass = graph.AddPass(L"Scene");
+    graph.Write(scenePass, scene, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass readbackPass = graph.AddPass(L"Readback", true);
+    graph.Read(readbackPass, scene, RenderGraphUsage_CopySource);
+    graph.Compile();
+
+    CHECK(graph.GetExecutionOrder() == std::vector<RenderGraphPass>({ scenePass, readbackPass }));
+}
+
+TEST(WritesDependOnThePreviousWriter)
+{
+    // The overlay draws on top of the scene, so the scene pass stays.
+    RenderGraph graph;
+    const RenderGraphResource backBuffer = graph.ImportResource(L"BackBuffer", RenderGraphUsage_None, RenderGraphUsage_None);
+    const RenderGraphResource target = graph.CreateTexture(L"Target", TextureDesc(64, 64));
+    const RenderGraphPass scenePass = graph.AddPass(L"Scene");
+    graph.Write(scenePass, target, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass overlayPass = graph.AddPass(L"Overlay");
+    graph.Write(overlayPass, target, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass copyPass = graph.AddPass(L"Copy");
+    graph.Read(copyPass, target, RenderGraphUsage_CopySource);
+    graph.Write(copyPass, backBuffer, RenderGraphUsage_CopyDest);
+    graph.Compile();
+
+    CHECK(graph.GetExecutionOrder().size() == 3);
+}
+
+TEST(BarriersFollowChangesOfUsage)
+{
+    RenderGraph graph;
+    const RenderGraphResource backBuffer = graph.ImportResource(L"BackBuffer", RenderGraphUsage_Present, RenderGraphUsage_Present);
+    const RenderGraphPass pass = graph.AddPass(L"Scene");
+    graph.Write(pass, backBuffer, RenderGraphUsage_RenderTarget);
+    graph.Compile();
+
+    CHECK(graph.GetBarriers(pass).size() == 1);
+    CHECK(IsBarrier(graph.GetBarriers(pass)[0], backBuffer, RenderGraphUsage_Present, RenderGraphUsage_RenderTarget));
+    CHECK(graph.GetFinalBarriers().size() == 1);
+    CHECK(IsBarrier(graph.GetFinalBarriers()[0], backBuffer, RenderGraphUsage_RenderTarget, RenderGraphUsage_Present));
+    CHECK(graph.GetBarrierCount() == 2);
+}
+
+TEST(ReadsShareOneTransition)
+{
+    RenderGraph graph;
+    const RenderGraphResource scene = graph.CreateTexture(L"Scene", TextureDesc(64, 64));
+    const RenderGraphPass scenePass = graph.AddPass(L"Scene");
+    graph.Write(scenePass, scene, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass blurPass = graph.AddPass(L"Blur", true);
+    graph.Read(blurPass, scene, RenderGraphUsage_ShaderResource);
+    const RenderGraphPass readbackPass = graph.AddPass(L"Readback", true);
+    graph.Read(readbackPass, scene, RenderGraphUsage_CopySource);
+    graph.Compile();
+
+    // The transient starts undefined, the first write does not keep anything.
+    CHECK(IsBarrier(graph.GetBarriers(scenePass)[0], scene, RenderGraphUsage_None, RenderGraphUsage_RenderTarget));
+    CHECK(graph.GetBarriers(blurPass).size() == 1);
+    CHECK(IsBarrier(graph.GetBarriers(blurPass)[0], scene, RenderGraphUsage_RenderTarget,
+        RenderGraphUsage_ShaderResource | RenderGraphUsage_CopySource));
+    CHECK(graph.GetBarriers(readbackPass).empty());
+}
+
+TEST(UnorderedAccessWritesGetAUavBarrier)
+{
+    RenderGraph graph;
+    const RenderGraphResource buffer = graph.CreateTexture(L"Particles", TextureDesc(64, 1));
+    const RenderGraphPass emitPass = graph.AddPass(L"Emit");
+    graph.Write(emitPass, buffer, RenderGraphUsage_UnorderedAccess);
+    const RenderGraphPass simulatePass = graph.AddPass(L"Simulate");
+    graph.Write(simulatePass, buffer, RenderGraphUsage_UnorderedAccess);
+    const RenderGraphPass drawPass = graph.AddPass(L"Draw", true);
+    graph.Read(drawPass, buffer, RenderGraphUsage_ShaderResource);
+    graph.Compile();
+
+    CHECK(graph.GetBarriers(emitPass).size() == 1);
+    CHECK(IsBarrier(graph.GetBarriers(emitPass)[0], buffer, RenderGraphUsage_None, RenderGraphUsage_UnorderedAccess));
+    CHECK(graph.GetBarriers(simulatePass).size() == 1);
+    CHECK(IsBarrier(graph.GetBarriers(simulatePass)[0], buffer, RenderGraphUsage_UnorderedAccess, RenderGraphUsage_UnorderedAccess));
+    CHECK(IsBarrier(graph.GetBarriers(drawPass)[0], buffer, RenderGraphUsage_UnorderedAccess, RenderGraphUsage_ShaderResource));
+    CHECK(graph.GetBarrierCount() == 3);
+}
+
+TEST(RenderTargetWritesInARowNeedNoBarrier)
+{
+    RenderGraph graph;
+    const RenderGraphResource target = graph.ImportResource(L"Target", RenderGraphUsage_RenderTarget, RenderGraphUsage_None);
+    const RenderGraphPass scenePass = graph.AddPass(L"Scene");
+    graph.Write(scenePass, target, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass overlayPass = graph.AddPass(L"Overlay");
+    graph.Write(overlayPass, target, RenderGraphUsage_RenderTarget);
+    graph.Compile();
+
+    CHECK(graph.GetBarrierCount() == 0);
+}
+
+TEST(TransientsShareSlotsWhenLifetimesDoNotOverlap)
+{
+    // a lives in passes 0-1, b in 1-2 and c in 2-3: c takes a's slot. d has
+    // another size and gets a slot of its own.
+    RenderGraph graph;
+    const RenderGraphResource backBuffer = graph.ImportResource(L"BackBuffer", RenderGraphUsage_None, RenderGraphUsage_None);
+    const RenderGraphResource a = graph.CreateTexture(L"A", TextureDesc(64, 64));
+    const RenderGraphResource b = graph.CreateTexture(L"B", TextureDesc(64, 64));
+    const RenderGraphResource c = graph.CreateTexture(L"C", TextureDesc(64, 64));
+    const RenderGraphResource d = graph.CreateTexture(L"D", TextureDesc(32, 32));
+
+    const RenderGraphPass pass0 = graph.AddPass(L"0");
+    graph.Write(pass0, a, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass pass1 = graph.AddPass(L"1");
+    graph.Read(pass1, a, RenderGraphUsage_ShaderResource);
+    graph.Write(pass1, b, RenderGraphUsage_RenderTarget);
+    const RenderGraphPass pass2 = graph.AddPass(L"2");
+    graph.Read(pass2, b, RenderGraphUsage_ShaderResource);
+    graph.Write(pass2, c, RenderGraphUsage_UnorderedAccess);
+    const RenderGraphPass pass3 = graph.AddPass(L"3");
+    graph.Read(pass3, c, RenderGraphUsage_ShaderResource);
+    graph.Write(pass3, d, RenderGraphUsage_RenderTarget);
+    graph.Write(pass3, backBuffer, RenderGraphUsage_RenderTarget);
+    graph.Compile();
+
+    CHECK(graph.GetLifetime(a).First == 0 && graph.GetLifetime(a).Last == 1);
+    CHECK(graph.GetLifetime(c).First == 2 && graph.GetLifetime(c).Last == 3);
+    CHECK(graph.GetTextureSlotCount() == 3);
+    CHECK(graph.GetTextureSlot(a) == graph.GetTextureSlot(c));
+    CHECK(graph.GetTextureSlot(a) != graph.GetTextureSlot(b));
+    CHECK(graph.GetTextureSlot(d) != graph.GetTextureSlot(a) && graph.GetTextureSlot(d) != graph.GetTextureSlot(b));
+    CHECK(graph.GetSlotDesc(graph.GetTextureSlot(d)) == TextureDesc(32, 32));
+
+    // The shared texture has to allow what both transients do with it.
+    CHECK(graph.GetSlotUsage(graph.GetTextureSlot(a)) ==
+        (RenderGraphUsage_RenderTarget | RenderGraphUsage_ShaderResource | RenderGraphUsage_UnorderedAccess));
+}
+
+TEST(ClearStartsAFreshFrame)
+{
+    RenderGraph graph;
+    for (int frame = 0; frame < 2; frame++)
+    {
+        graph.Clear();
+        const RenderGraphResource backBuffer = graph.ImportResource(L"BackBuffer", RenderGraphUsage_Present, RenderGraphUsage_Present);
+        const RenderGraphResource scene = graph.CreateTexture(L"Scene", TextureDesc(64, 64));
+        const RenderGraphPass scenePass = graph.AddPass(L"Scene");
+        graph.Write(scenePass, scene, RenderGraphUsage_RenderTarget);
+        const RenderGraphPass postPass = graph.AddPass(L"Post");
+        graph.Read(postPass, scene, RenderGraphUsage_ShaderResource);
+        graph.Write(postPass, backBuffer, RenderGraphUsage_RenderTarget);
+        graph.Compile();
+
+        CHECK(graph.GetPassCount() == 2);
+        CHECK(graph.GetResourceCount() == 2);
+        CHECK(graph.GetBarrierCount() == 4);
+        CHECK(graph.GetTextureSlotCount() == 1);
+    }
+}
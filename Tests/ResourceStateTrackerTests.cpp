@@ -0,0 +1,157 @@
+#include "TestFramework.h"
+#include "ResourceStateTracker.h"
+
+// The tracker only uses resources as keys once their subresource count is
+// given, so made up pointers stand in for them.
+static ID3D12Resource* FakeResource(uintptr_t id)
+{
+    return reinterpret_cast<ID3D12Resource*>(id * 0x1000);
+}
+
+static bool IsTransition(const D3D12_RESOURCE_BARRIER& barrier, ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+{
+    return barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION &&
+        barrier.Transition.pResource == resource &&
+        barrier.Transition.StateBefore == before &&
+        barrier.Transition.StateAfter == after &&
+        barrier.Transition.Subresource == subresource;
+}
+
+TEST(TransitionTakesEffectAtFlush)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* target = FakeResource(1);
+    tracker.Register(target, D3D12_RESOURCE_STATE_PRESENT, 1);
+    tracker.Transition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    CHECK(tracker.GetState(target) == D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 1);
+    CHECK(IsTransition(barriers[0], target, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
+    CHECK(tracker.Flush(barriers) == 0);
+}
+
+TEST(RoundTripsRecordNothing)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* target = FakeResource(1);
+    tracker.Register(target, D3D12_RESOURCE_STATE_RENDER_TARGET, 1);
+    tracker.Transition(target, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    tracker.Transition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 0);
+}
+
+TEST(ChainsCollapse)
+{
+    // What a 4X MSAA frame does to the back buffer between two flushes.
+    ResourceStateTracker tracker;
+    ID3D12Resource* backBuffer = FakeResource(1);
+    tracker.Register(backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST, 1);
+    tracker.Transition(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    tracker.Transition(backBuffer, D3D12_RESOURCE_STATE_PRESENT);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 1);
+    CHECK(IsTransition(barriers[0], backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST, D3D12_RESOURCE_STATE_PRESENT));
+}
+
+TEST(CoveredReadStatesAreLeftAlone)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* texture = FakeResource(1);
+    tracker.Register(texture, D3D12_RESOURCE_STATE_GENERIC_READ, 1);
+    tracker.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    CHECK(tracker.GetState(texture) == D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    // A write state is never covered, neither is COMMON.
+    ID3D12Resource* target = FakeResource(2);
+    tracker.Register(target, D3D12_RESOURCE_STATE_RENDER_TARGET, 1);
+    tracker.Transition(target, D3D12_RESOURCE_STATE_COMMON);
+    CHECK(tracker.GetState(target) == D3D12_RESOURCE_STATE_COMMON);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 1);
+}
+
+TEST(BarriersFollowRequestOrder)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* msaaTarget = FakeResource(1);
+    ID3D12Resource* backBuffer = FakeResource(2);
+    tracker.Register(msaaTarget, D3D12_RESOURCE_STATE_RENDER_TARGET, 1);
+    tracker.Register(backBuffer, D3D12_RESOURCE_STATE_PRESENT, 1);
+    tracker.Transition(msaaTarget, D3D12_RESOURCE_STATE_RESOLVE_SOURCE);
+    tracker.Transition(backBuffer, D3D12_RESOURCE_STATE_RESOLVE_DEST);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 2);
+    CHECK(barriers[0].Transition.pResource == msaaTarget);
+    CHECK(barriers[1].Transition.pResource == backBuffer);
+}
+
+TEST(SubresourcesAreTrackedOnTheirOwn)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* texture = FakeResource(1);
+    tracker.Register(texture, D3D12_RESOURCE_STATE_COPY_DEST, 4);
+    tracker.Transition(texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 2);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 1);
+    CHECK(IsTransition(barriers[0], texture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 2));
+
+    // Every subresource moving the same way is one barrier for the resource,
+    // otherwise one per subresource that changed.
+    barriers.clear();
+    tracker.Transition(texture, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    CHECK(tracker.Flush(barriers) == 4);
+
+    barriers.clear();
+    tracker.Transition(texture, D3D12_RESOURCE_STATE_COPY_DEST);
+    CHECK(tracker.Flush(barriers) == 1);
+    CHECK(IsTransition(barriers[0], texture, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+}
+
+TEST(RegisterAgainDropsPendingTransitions)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* target = FakeResource(1);
+    tracker.Register(target, D3D12_RESOURCE_STATE_PRESENT, 1);
+    tracker.Transition(target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    tracker.Register(target, D3D12_RESOURCE_STATE_PRESENT, 1);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 0);
+    CHECK(tracker.GetState(target) == D3D12_RESOURCE_STATE_PRESENT);
+}
+
+TEST(UavBarrierBetweenWrites)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* buffer = FakeResource(1);
+    tracker.Register(buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 1);
+    tracker.Transition(buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    tracker.UavBarrier(buffer);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 1);
+    CHECK(barriers[0].Type == D3D12_RESOURCE_BARRIER_TYPE_UAV);
+    CHECK(barriers[0].UAV.pResource == buffer);
+    CHECK(tracker.Flush(barriers) == 0);
+}
+
+TEST(TransitionMakesTheUavBarrierRedundant)
+{
+    ResourceStateTracker tracker;
+    ID3D12Resource* buffer = FakeResource(1);
+    tracker.Register(buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 1);
+    tracker.UavBarrier(buffer);
+    tracker.Transition(buffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    CHECK(tracker.Flush(barriers) == 1);
+    CHECK(IsTransition(barriers[0], buffer, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+}
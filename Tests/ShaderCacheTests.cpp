@@ -0,0 +1,212 @@
+#include "TestFramework.h"
+#include "ShaderCache.h"
+#include "TemporaryFile.h"
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+// Stands in for the D3D compiler: the bytecode is the entry point, and the
+// includes are read like RecordingInclude does, or served from Overrides to
+// simulate a file saved again after the compiler read it.
+struct StubCompiler
+{
+    UINT Compiles = 0;
+    std::vector<std::string> Includes;
+    std::unordered_map<std::string, std::string> Overrides;
+
+    ShaderCompileFunction GetFunction()
+    {
+        return [this](const ShaderCompileDesc& desc, const std::wstring& includeDirectory, std::vector<ShaderInclude>& includes)
+        {
+            Compiles++;
+            for (const std::string& name : Includes)
+            {
+                std::string contents;
+                auto it = Overrides.find(name);
+                if (it != Overrides.end())
+                {
+                    contents = it->second;
+                }
+                else
+                {
+                    std::ifstream file(includeDirectory + AnsiToWString(name), std::ios::binary);
+                    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                }
+                includes.push_back({ name, IncludeHashCache::HashContents(contents.data(), contents.size()) });
+            }
+            ComPtr<ID3DBlob> byteCode;
+            ThrowIfFailed(D3DCreateBlob(desc.EntryPoint.size(), &byteCode));
+            memcpy(byteCode->GetBufferPointer(), desc.EntryPoint.data(), desc.EntryPoint.size());
+            return byteCode;
+        };
+    }
+};
+
+static const char Source[] = "#include \"ShaderCacheTests.hlsli\"\nfloat4 VSMain() : SV_POSITION { return 0; }";
+static const char IncludeName[] = "ShaderCacheTests.hlsli";
+
+static ShaderCompileDesc MakeDesc(const char* source = Source)
+{
+    ShaderCompileDesc desc;
+    desc.SourceName = "ShaderCacheTests.hlsl";
+    desc.Source.Data = reinterpret_cast<const uint8_t*>(source);
+    desc.Source.Size = strlen(source);
+    desc.EntryPoint = "VSMain";
+    desc.Target = "vs_5_0";
+    return desc;
+}
+
+// Removes what the tests persisted in cacheDirectory.
+static void RemoveEntries(const std::wstring& cacheDirectory, const std::vector<ShaderCompileDesc>& descs)
+{
+    for (const ShaderCompileDesc& desc : descs)
+    {
+        WCHAR name[32];
+        swprintf_s(name, L"%016llx.shc", ShaderCache::ComputeKey(desc));
+        DeleteFileW((cacheDirectory + name).c_str());
+    }
+    RemoveDirectoryW(cacheDirectory.c_str());
+}
+
+TEST(HitsDoNotReadIncludes)
+{
+    TemporaryFile include(IncludeName, "cbuffer A {};");
+    StubCompiler compiler;
+    compiler.Includes = { IncludeName };
+    ShaderCache cache(L"", L"", compiler.GetFunction());
+
+    cache.GetOrCompile(MakeDesc());
+    const size_t reads = cache.GetIncludeReadCount();
+    for (int i = 0; i < 100; i++)
+    {
+        cache.GetOrCompile(MakeDesc());
+    }
+    CHECK(compiler.Compiles == 1);
+    CHECK(cache.GetHitCount() == 100);
+    CHECK(cache.GetIncludeReadCount() == reads);
+    CHECK(cache.GetIncludes(MakeDesc()) == std::vector<std::string>{ IncludeName });
+}
+
+TEST(IncludeEditRecompilesOnceNotified)
+{
+    TemporaryFile include(IncludeName, "cbuffer A {};");
+    StubCompiler compiler;
+    compiler.Includes = { IncludeName };
+    ShaderCache cache(L"", L"", compiler.GetFunction());
+    cache.GetOrCompile(MakeDesc());
+
+    include.Write("cbuffer B {};");
+    cache.GetOrCompile(MakeDesc());
+    CHECK(compiler.Compiles == 1);
+
+    cache.NotifyFilesChanged({ L"shadercachetests.hlsli" });
+    cache.GetOrCompile(MakeDesc());
+    CHECK(compiler.Compiles == 2);
+    cache.GetOrCompile(MakeDesc());
+    CHECK(compiler.Compiles == 2);
+}
+
+TEST(UnrelatedChangesKeepTheEntry)
+{
+    TemporaryFile include(IncludeName, "cbuffer A {};");
+    StubCompiler compiler;
+    compiler.Includes = { IncludeName };
+    ShaderCache cache(L"", L"", compiler.GetFunction());
+    cache.GetOrCompile(MakeDesc());
+
+    cache.NotifyFilesChanged({ L"Other.hlsli" });
+    cache.GetOrCompile(MakeDesc());
+    CHECK(compiler.Compiles == 1);
+}
+
+TEST(SourceChangeIsANewKey)
+{
+    TemporaryFile include(IncludeName, "cbuffer A {};");
+    StubCompiler compiler;
+    ShaderCache cache(L"", L"", compiler.GetFunction());
+    cache.GetOrCompile(MakeDesc());
+    cache.GetOrCompile(MakeDesc("float4 VSMain() : SV_POSITION { return 1; }"));
+    CHECK(compiler.Compiles == 2);
+    CHECK(cache.GetMissCount() == 2);
+}
+
+TEST(PersistedEntriesAreCheckedAgainstIncludes)
+{
+    const std::wstring cacheDirectory = L"ShaderCacheTests\\";
+    TemporaryFile include(IncludeName, "cbuffer A {};");
+    StubCompiler compiler;
+    compiler.Includes = { IncludeName };
+    {
+        ShaderCache cache(cacheDirectory, L"", compiler.GetFunction());
+        cache.GetOrCompile(MakeDesc());
+    }
+    {
+        // A later run with nothing changed skips the compiler.
+        ShaderCache cache(cacheDirectory, L"", compiler.GetFunction());
+        ComPtr<ID3DBlob> byteCode = cache.GetOrCompile(MakeDesc());
+        CHECK(compiler.Compiles == 1);
+        CHECK(cache.GetHitCount() == 1);
+        CHECK(std::string(static_cast<const char*>(byteCode->GetBufferPointer()), byteCode->GetBufferSize()) == "VSMain");
+    }
+
+    include.Write("cbuffer B {};");
+    {
+        ShaderCache cache(cacheDirectory, L"", compiler.GetFunction());
+        cache.GetOrCompile(MakeDesc());
+        CHECK(compiler.Compiles == 2);
+    }
+    RemoveEntries(cacheDirectory, { MakeDesc() });
+}
+
+TEST(CorruptEntriesAreMisses)
+{
+    // Counts past the end of the file must not be allocated for.
+    const std::wstring cacheDirectory = L"ShaderCacheTests\\";
+    StubCompiler compiler;
+    {
+        ShaderCache cache(cacheDirectory, L"", compiler.GetFunction());
+        cache.GetOrCompile(MakeDesc());
+    }
+
+    WCHAR name[32];
+    swprintf_s(name, L"%016llx.shc", ShaderCache::ComputeKey(MakeDesc()));
+    const std::streamoff includeCountOffset = 16;
+    const std::streamoff byteCodeSizeOffset = 20;
+    UINT compiles = 1;
+    for (std::streamoff offset : { includeCountOffset, byteCodeSizeOffset })
+    {
+        {
+            std::fstream file(cacheDirectory + name, std::ios::in | std::ios::out | std::ios::binary);
+            const UINT32 huge = 0xffffffff;
+            file.seekp(offset);
+            file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+        }
+        ShaderCache cache(cacheDirectory, L"", compiler.GetFunction());
+        ComPtr<ID3DBlob> byteCode = cache.GetOrCompile(MakeDesc());
+        CHECK(compiler.Compiles == ++compiles);
+        CHECK(byteCode->GetBufferSize() == strlen("VSMain"));
+    }
+    RemoveEntries(cacheDirectory, { MakeDesc() });
+}
+
+TEST(EntriesRecordTheBytesTheCompilerRead)
+{
+    // The include was saved again while the compiler ran: the entry must not
+    // claim to match what is on disk now.
+    const std::wstring cacheDirectory = L"ShaderCacheTests\\";
+    TemporaryFile include(IncludeName, "saved after the compile");
+    StubCompiler compiler;
+    compiler.Includes = { IncludeName };
+    compiler.Overrides[IncludeName] = "read by the compile";
+    {
+        ShaderCache cache(cacheDirectory, L"", compiler.GetFunction());
+        cache.GetOrCompile(MakeDesc());
+    }
+    compiler.Overrides.clear();
+    {
+        ShaderCache cache(cacheDirectory, L"", compiler.GetFunction());
+        cache.GetOrCompile(MakeDesc());
+        CHECK(compiler.Compiles == 2);
+    }
+    RemoveEntries(cacheDirectory, { MakeDesc() });
+}
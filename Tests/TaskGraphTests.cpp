@@ -0,0 +1,133 @@
+#include "TestFramework.h"
+#include "TaskGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+
+// Appends to a shared log in the order tasks ran.
+struct RunLog
+{
+    std::vector<int> Order;
+    std::mutex Lock;
+
+    std::function<void()> Task(int id)
+    {
+        return [this, id]()
+        {
+            std::lock_guard<std::mutex> lock(Lock);
+            Order.push_back(id);
+        };
+    }
+
+    size_t PositionOf(int id)
+    {
+        return std::find(Order.begin(), Order.end(), id) - Order.begin();
+    }
+};
+
+TEST(SerialRunKeepsInsertionOrder)
+{
+    RunLog log;
+    TaskGraph graph;
+    const TaskGraphNode a = graph.Add(L"A", log.Task(0));
+    graph.Add(L"B", log.Task(1));
+    graph.Add(L"C", log.Task(2), { a });
+    graph.Run(nullptr);
+    CHECK(log.Order == std::vector<int>({ 0, 1, 2 }));
+}
+
+TEST(DependentsRunAfterTheirDependencies)
+{
+    // The shape of HelloWindow's init graph.
+    ThreadPool pool(3);
+    for (int run = 0; run < 100; run++)
+    {
+        RunLog log;
+        TaskGraph graph;
+        const TaskGraphNode heaps = graph.Add(L"Heaps", log.Task(0));
+        graph.Add(L"Buffers", log.Task(1), { heaps });
+        const TaskGraphNode shaders = graph.Add(L"Shaders", log.Task(2));
+        const TaskGraphNode rootSignature = graph.Add(L"RootSignature", log.Task(3), { shaders });
+        graph.Add(L"Geometry", log.Task(4));
+        graph.Add(L"PSO", log.Task(5), { rootSignature, shaders });
+        graph.Run(&pool);
+
+        CHECK(log.Order.size() == 6);
+        CHECK(log.PositionOf(0) < log.PositionOf(1));
+        CHECK(log.PositionOf(2) < log.PositionOf(3));
+        CHECK(log.PositionOf(3) < log.PositionOf(5));
+    }
+}
+
+TEST(IndependentTasksOverlap)
+{
+    // Each root waits for the other to start, which only finishes if both
+    // run at the same time: one on the calling thread, one on the worker.
+    ThreadPool pool(1);
+    std::mutex lock;
+    std::condition_variable started;
+    int running = 0;
+    bool overlapped[2] = {};
+    auto task = [&](int id)
+    {
+        return [&, id]()
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            running++;
+            started.notify_all();
+            overlapped[id] = started.wait_for(guard, std::chrono::seconds(10), [&] { return running == 2; });
+        };
+    };
+    TaskGraph graph;
+    graph.Add(L"A", task(0));
+    graph.Add(L"B", task(1));
+    graph.Run(&pool);
+    CHECK(overlapped[0] && overlapped[1]);
+}
+
+TEST(FirstErrorIsRethrownAndDependentsSkipped)
+{
+    ThreadPool pool(2);
+    RunLog log;
+    TaskGraph graph;
+    const TaskGraphNode failing = graph.Add(L"Failing", []() { throw std::runtime_error("stage failed"); });
+    graph.Add(L"Dependent", log.Task(1), { failing });
+    CHECK_THROWS(graph.Run(&pool));
+    CHECK(log.Order.empty());
+
+    CHECK_THROWS(graph.Run(nullptr));
+    CHECK(log.Order.empty());
+}
+
+TEST(RunFromAPoolTask)
+{
+    // Every worker is busy running the graph's caller, which has to run
+    // the tasks itself.
+    ThreadPool pool(1);
+    RunLog log;
+    std::promise<void> done;
+    pool.Submit([&]()
+    {
+        TaskGraph graph;
+        const TaskGraphNode a = graph.Add(L"A", log.Task(0));
+        graph.Add(L"B", log.Task(1), { a });
+        graph.Add(L"C", log.Task(2), { a });
+        graph.Run(&pool);
+        done.set_value();
+    });
+    CHECK(done.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    CHECK(log.Order.size() == 3);
+}
+
+TEST(TimingReportListsEveryTask)
+{
+    TaskGraph graph;
+    graph.Add(L"First", []() {});
+    graph.Add(L"Second", []() {});
+    graph.Run(nullptr);
+    const std::wstring report = graph.GetTimingReport();
+    CHECK(report.find(L"First: start") != std::wstring::npos);
+    CHECK(report.find(L"Second: start") != std::wstring::npos);
+    CHECK(graph.GetElapsedMilliseconds() >= 0.0);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+// A file in the working directory that is removed again at the end of a test.
+class TemporaryFile
+{
+public:
+    TemporaryFile(const char* name, const std::string& contents) :
+        m_name(name)
+    {
+        Write(contents);
+    }
+    ~TemporaryFile() { std::remove(m_name.c_str()); }
+
+    TemporaryFile(const TemporaryFile& rhs) = delete;
+    TemporaryFile& operator=(const TemporaryFile& rhs) = delete;
+
+    void Write(const std::string& contents)
+    {
+        std::ofstream file(m_name, std::ios::binary | std::ios::trunc);
+        file.write(contents.data(), contents.size());
+    }
+
+    const std::string& GetName()const { return m_name; }
+    std::wstring GetPath()const { return std::wstring(m_name.begin(), m_name.end()); }
+
+private:
+    std::string m_name;
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+// Just enough of a test framework. TEST registers a function, CHECK reports
+// a failed condition and carries on, CHECK_THROWS expects an exception.
+// TestMain.cpp runs every test of the executable in registration order.
+struct TestCase
+{
+    const char* Name;
+    void (*Function)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportTestFailure(const char* file, int line, const char* expression);
+
+struct TestRegistrar
+{
+    TestRegistrar(const char* name, void (*function)())
+    {
+        GetTestCases().push_back({ name, function });
+    }
+};
+
+#define TEST(name)                                              \
+    static void name();                                         \
+    static TestRegistrar name##Registrar(#name, name);          \
+    static void name()
+
+#define CHECK(condition)                                        \
+    do                                                          \
+    {                                                           \
+        if (!(condition))                                       \
+        {                                                       \
+            ReportTestFailure(__FILE__, __LINE__, #condition);  \
+        }                                                       \
+    } while (false)
+
+#define CHECK_THROWS(expression)                                \
+    do                                                          \
+    {                                                           \
+        bool thrown__ = false;                                  \
+        try                                                     \
+        {                                                       \
+            expression;                                         \
+        }                                                       \
+        catch (...)                                             \
+        {                                                       \
+            thrown__ = true;                                    \
+        }                                                       \
+        if (!thrown__)                                          \
+        {                                                       \
+            ReportTestFailure(__FILE__, __LINE__, "throws " #expression); \
+        }                                                       \
+    } while (false)
@@ -0,0 +1,46 @@
+#include "TestFramework.h"
+#include <exception>
+
+static int s_failures = 0;
+
+std::vector<TestCase>& GetTestCases()
+{
+    static std::vector<TestCase> testCases;
+    return testCases;
+}
+
+void ReportTestFailure(const char* file, int line, const char* expression)
+{
+    printf("%s(%d): check failed: %s\n", file, line, expression);
+    s_failures++;
+}
+
+int main()
+{
+    int failedTests = 0;
+    for (const TestCase& test : GetTestCases())
+    {
+        const int failuresBefore = s_failures;
+        try
+        {
+            test.Function();
+        }
+        catch (const std::exception& e)
+        {
+            printf("%s: unexpected exception: %s\n", test.Name, e.what());
+            s_failures++;
+        }
+        catch (...)
+        {
+            printf("%s: unexpected exception\n", test.Name);
+            s_failures++;
+        }
+
+        const bool passed = s_failures == failuresBefore;
+        failedTests += passed ? 0 : 1;
+        printf("%s %s\n", passed ? "[  PASSED  ]" : "[  FAILED  ]", test.Name);
+    }
+    printf("%d of %d tests passed\n", static_cast<int>(GetTestCases().size()) - failedTests,
+        static_cast<int>(GetTestCases().size()));
+    return failedTests == 0 ? 0 : 1;
+}